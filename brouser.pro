@@ -1,4 +1,4 @@
-QT += core gui network sql widgets webenginecore webenginewidgets webengine webchannel
+QT += core gui network sql concurrent widgets webenginecore webenginewidgets webengine webchannel
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -13,9 +13,17 @@ SOURCES += \
     src/mainwindow.cpp \
     src/adblocker.cpp \
     src/bookmarkmanager.cpp \
+    src/bookmarkindex.cpp \
+    src/bookmarkimporter.cpp \
+    src/linkchecker.cpp \
+    src/similarityindex.cpp \
+    src/faviconstore.cpp \
     src/extensionmanager.cpp \
     src/historymanager.cpp \
     src/syncmanager.cpp \
+    src/syncjournal.cpp \
+    src/merkletree.cpp \
+    src/syncuploader.cpp \
     src/tabwidget.cpp \
     src/webview.cpp \
     src/downloadmanager.cpp \
@@ -26,9 +34,17 @@ HEADERS += \
     src/mainwindow.h \
     src/adblocker.h \
     src/bookmarkmanager.h \
+    src/bookmarkindex.h \
+    src/bookmarkimporter.h \
+    src/linkchecker.h \
+    src/similarityindex.h \
+    src/faviconstore.h \
     src/extensionmanager.h \
     src/historymanager.h \
     src/syncmanager.h \
+    src/syncjournal.h \
+    src/merkletree.h \
+    src/syncuploader.h \
     src/tabwidget.h \
     src/webview.h \
     src/downloadmanager.h \
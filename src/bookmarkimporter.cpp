@@ -0,0 +1,835 @@
+#include "bookmarkimporter.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+
+BookmarkImporter::BookmarkImporter(QObject *parent)
+    : QObject(parent),
+      m_device(nullptr),
+      m_position(0),
+      m_batchSize(DEFAULT_BATCH_SIZE),
+      m_nextKey(ROOT_KEY + 1)
+{
+}
+
+BookmarkImporter::Format BookmarkImporter::detectFormat(const QString &path)
+{
+    if (path.endsWith(".sqlite", Qt::CaseInsensitive)) {
+        return FirefoxPlaces;
+    }
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return UnknownFormat;
+    }
+    
+    const QByteArray head = file.peek(4096);
+    if (head.contains("NETSCAPE-Bookmark-file") || head.toLower().contains("<dl")) {
+        return NetscapeHtml;
+    }
+    if (head.trimmed().startsWith('{')) {
+        return head.contains("\"roots\"") ? ChromiumJson : BrowserJson;
+    }
+    return UnknownFormat;
+}
+
+QString BookmarkImporter::profileBookmarksPath(const QString &browserName)
+{
+    const QString name = browserName.toLower();
+    const QString home = QDir::homePath();
+    
+    if (name == "firefox") {
+#if defined(Q_OS_WIN)
+        const QString profiles = qEnvironmentVariable("APPDATA") + "/Mozilla/Firefox/Profiles";
+#elif defined(Q_OS_MACOS)
+        const QString profiles = home + "/Library/Application Support/Firefox/Profiles";
+#else
+        const QString profiles = home + "/.mozilla/firefox";
+#endif
+        // Берём профиль, которым пользовались последним
+        QString result;
+        QDateTime newest;
+        const QFileInfoList dirs = QDir(profiles).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const QFileInfo &dir : dirs) {
+            QFileInfo places(dir.filePath() + "/places.sqlite");
+            if (places.exists() && (result.isEmpty() || places.lastModified() > newest)) {
+                result = places.absoluteFilePath();
+                newest = places.lastModified();
+            }
+        }
+        return result;
+    }
+    
+    QString profile;
+#if defined(Q_OS_WIN)
+    const QString local = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
+    if (name == "chrome") profile = local + "/Google/Chrome/User Data/Default";
+    else if (name == "chromium") profile = local + "/Chromium/User Data/Default";
+    else if (name == "edge") profile = local + "/Microsoft/Edge/User Data/Default";
+#elif defined(Q_OS_MACOS)
+    const QString support = home + "/Library/Application Support";
+    if (name == "chrome") profile = support + "/Google/Chrome/Default";
+    else if (name == "chromium") profile = support + "/Chromium/Default";
+    else if (name == "edge") profile = support + "/Microsoft Edge/Default";
+#else
+    const QString config = home + "/.config";
+    if (name == "chrome") profile = config + "/google-chrome/Default";
+    else if (name == "chromium") profile = config + "/chromium/Default";
+    else if (name == "edge") profile = config + "/microsoft-edge/Default";
+#endif
+    
+    if (profile.isEmpty() || !QFileInfo::exists(profile + "/Bookmarks")) {
+        return QString();
+    }
+    return profile + "/Bookmarks";
+}
+
+bool BookmarkImporter::importFile(const QString &path, Format format)
+{
+    m_error.clear();
+    m_folders.clear();
+    m_bookmarks.clear();
+    m_nextKey = ROOT_KEY + 1;
+    
+    if (format == UnknownFormat) {
+        format = detectFormat(path);
+    }
+    if (format == UnknownFormat) {
+        return fail(tr("Неизвестный формат файла закладок"));
+    }
+    if (format == FirefoxPlaces) {
+        return importFirefox(path);
+    }
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return fail(file.errorString());
+    }
+    
+    m_device = &file;
+    m_decoder = QStringDecoder(QStringDecoder::Utf8);
+    m_buffer.clear();
+    m_position = 0;
+    
+    bool ok = false;
+    switch (format) {
+    case NetscapeHtml:
+        ok = importNetscape();
+        break;
+    case ChromiumJson:
+        ok = importChromium();
+        break;
+    case BrowserJson:
+        ok = importBrowserJson();
+        break;
+    default:
+        break;
+    }
+    
+    if (ok) {
+        flushBatch();
+    }
+    m_device = nullptr;
+    m_buffer.clear();
+    return ok;
+}
+
+void BookmarkImporter::setBatchSize(int size)
+{
+    m_batchSize = qMax(1, size);
+}
+
+QString BookmarkImporter::errorString() const
+{
+    return m_error;
+}
+
+bool BookmarkImporter::fail(const QString &error)
+{
+    m_error = error;
+    m_folders.clear();
+    m_bookmarks.clear();
+    return false;
+}
+
+bool BookmarkImporter::fillBuffer()
+{
+    // Обработанная часть буфера больше не нужна
+    if (m_position > 0) {
+        m_buffer.remove(0, m_position);
+        m_position = 0;
+    }
+    if (!m_device || m_device->atEnd()) {
+        return false;
+    }
+    
+    const QByteArray chunk = m_device->read(CHUNK_SIZE);
+    if (chunk.isEmpty()) {
+        return false;
+    }
+    const QString decoded = m_decoder.decode(chunk);
+    m_buffer += decoded;
+    emit progress(m_device->pos(), m_device->size());
+    return true;
+}
+
+void BookmarkImporter::addFolder(const ImportedFolder &folder)
+{
+    m_folders.append(folder);
+    if (m_folders.size() + m_bookmarks.size() >= m_batchSize) {
+        flushBatch();
+    }
+}
+
+void BookmarkImporter::addBookmark(const ImportedBookmark &bookmark)
+{
+    // Служебные ссылки Firefox и букмарклеты не импортируем
+    if (bookmark.url.isEmpty() || bookmark.url.startsWith("place:")
+        || bookmark.url.startsWith("javascript:")) {
+        return;
+    }
+    m_bookmarks.append(bookmark);
+    if (m_folders.size() + m_bookmarks.size() >= m_batchSize) {
+        flushBatch();
+    }
+}
+
+void BookmarkImporter::flushBatch()
+{
+    if (m_folders.isEmpty() && m_bookmarks.isEmpty()) {
+        return;
+    }
+    emit batchReady(m_folders, m_bookmarks);
+    m_folders.clear();
+    m_bookmarks.clear();
+}
+
+// ---------------------------------------------------------------------------
+// Netscape HTML
+// ---------------------------------------------------------------------------
+
+bool BookmarkImporter::importNetscape()
+{
+    // <DT><H3>Папка</H3><DL><p> ... </DL><p> и <DT><A HREF=...>Закладка</A>
+    QList<int> folderStack{ROOT_KEY};
+    int pendingFolder = -1;
+    enum { CaptureNone, CaptureFolder, CaptureBookmark } capture = CaptureNone;
+    QString captured;
+    ImportedFolder folder{ROOT_KEY, ROOT_KEY, QString()};
+    ImportedBookmark bookmark{QString(), QString(), ROOT_KEY, QDateTime()};
+    HtmlToken token;
+    
+    while (readHtmlToken(token)) {
+        if (!token.isTag) {
+            if (capture != CaptureNone) {
+                captured += token.text;
+            }
+            continue;
+        }
+        
+        if (token.name == "h3") {
+            folder.key = m_nextKey++;
+            folder.parentKey = folderStack.last();
+            capture = CaptureFolder;
+            captured.clear();
+        } else if (token.name == "/h3" && capture == CaptureFolder) {
+            folder.name = captured.simplified();
+            addFolder(folder);
+            pendingFolder = folder.key;
+            capture = CaptureNone;
+        } else if (token.name == "a") {
+            bookmark.url = token.attributes.value("href");
+            bookmark.folderKey = folderStack.last();
+            const QString added = token.attributes.value("add_date");
+            bookmark.addedDate = added.isEmpty() ? QDateTime()
+                                                 : QDateTime::fromSecsSinceEpoch(added.toLongLong());
+            capture = CaptureBookmark;
+            captured.clear();
+        } else if (token.name == "/a" && capture == CaptureBookmark) {
+            bookmark.title = captured.simplified();
+            addBookmark(bookmark);
+            capture = CaptureNone;
+        } else if (token.name == "dl") {
+            // Список после <H3> - содержимое этой папки
+            folderStack.append(pendingFolder >= 0 ? pendingFolder : folderStack.last());
+            pendingFolder = -1;
+        } else if (token.name == "/dl") {
+            if (folderStack.size() > 1) {
+                folderStack.removeLast();
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool BookmarkImporter::readHtmlToken(HtmlToken &token)
+{
+    token.name.clear();
+    token.text.clear();
+    token.attributes.clear();
+    
+    forever {
+        if (m_position >= m_buffer.size() && !fillBuffer()) {
+            return false;
+        }
+        
+        if (m_buffer.at(m_position) == QLatin1Char('<')) {
+            int end = m_buffer.indexOf(QLatin1Char('>'), m_position);
+            while (end < 0) {
+                if (!fillBuffer()) {
+                    return false;
+                }
+                end = m_buffer.indexOf(QLatin1Char('>'), m_position);
+            }
+            
+            const QString tag = m_buffer.mid(m_position + 1, end - m_position - 1);
+            m_position = end + 1;
+            
+            // DOCTYPE и комментарии
+            if (tag.startsWith(QLatin1Char('!'))) {
+                continue;
+            }
+            token.isTag = true;
+            parseTag(tag, token);
+            return true;
+        }
+        
+        int next = m_buffer.indexOf(QLatin1Char('<'), m_position);
+        if (next < 0 && fillBuffer()) {
+            continue;
+        }
+        if (next < 0) {
+            next = m_buffer.size();
+        }
+        
+        token.isTag = false;
+        token.text = decodeEntities(m_buffer.mid(m_position, next - m_position));
+        m_position = next;
+        return true;
+    }
+}
+
+void BookmarkImporter::parseTag(const QString &tag, HtmlToken &token)
+{
+    const int length = tag.size();
+    int i = 0;
+    
+    while (i < length && !tag.at(i).isSpace()) {
+        ++i;
+    }
+    token.name = tag.left(i).toLower();
+    
+    while (i < length) {
+        while (i < length && tag.at(i).isSpace()) {
+            ++i;
+        }
+        const int nameStart = i;
+        while (i < length && !tag.at(i).isSpace() && tag.at(i) != QLatin1Char('=')) {
+            ++i;
+        }
+        const QString name = tag.mid(nameStart, i - nameStart).toLower();
+        if (name.isEmpty()) {
+            ++i;
+            continue;
+        }
+        
+        QString value;
+        if (i < length && tag.at(i) == QLatin1Char('=')) {
+            ++i;
+            if (i < length && (tag.at(i) == QLatin1Char('"') || tag.at(i) == QLatin1Char('\''))) {
+                const QChar quote = tag.at(i++);
+                int end = tag.indexOf(quote, i);
+                if (end < 0) {
+                    end = length;
+                }
+                value = tag.mid(i, end - i);
+                i = end + 1;
+            } else {
+                const int valueStart = i;
+                while (i < length && !tag.at(i).isSpace()) {
+                    ++i;
+                }
+                value = tag.mid(valueStart, i - valueStart);
+            }
+        }
+        token.attributes.insert(name, decodeEntities(value));
+    }
+}
+
+QString BookmarkImporter::decodeEntities(const QString &text)
+{
+    if (!text.contains(QLatin1Char('&'))) {
+        return text;
+    }
+    
+    QString result;
+    result.reserve(text.size());
+    
+    int i = 0;
+    while (i < text.size()) {
+        const int amp = text.indexOf(QLatin1Char('&'), i);
+        const int semicolon = amp < 0 ? -1 : text.indexOf(QLatin1Char(';'), amp);
+        if (amp < 0 || semicolon < 0 || semicolon - amp > 10) {
+            result += QStringView(text).mid(i, amp < 0 ? -1 : amp + 1 - i);
+            if (amp < 0) {
+                break;
+            }
+            i = amp + 1;
+            continue;
+        }
+        
+        result += QStringView(text).mid(i, amp - i);
+        const QString entity = text.mid(amp + 1, semicolon - amp - 1);
+        
+        if (entity == QLatin1String("amp")) result += QLatin1Char('&');
+        else if (entity == QLatin1String("lt")) result += QLatin1Char('<');
+        else if (entity == QLatin1String("gt")) result += QLatin1Char('>');
+        else if (entity == QLatin1String("quot")) result += QLatin1Char('"');
+        else if (entity == QLatin1String("apos") || entity == QLatin1String("#39")) result += QLatin1Char('\'');
+        else if (entity == QLatin1String("nbsp")) result += QChar(0x00A0);
+        else if (entity.startsWith(QLatin1Char('#'))) {
+            bool ok = false;
+            const char32_t code = entity.startsWith(QLatin1String("#x"), Qt::CaseInsensitive)
+                                  ? entity.mid(2).toUInt(&ok, 16)
+                                  : entity.mid(1).toUInt(&ok, 10);
+            if (ok && code > 0 && code <= 0x10FFFF) {
+                result += QString::fromUcs4(&code, 1);
+            } else {
+                result += QLatin1Char('&') + entity + QLatin1Char(';');
+            }
+        } else {
+            result += QLatin1Char('&') + entity + QLatin1Char(';');
+        }
+        i = semicolon + 1;
+    }
+    
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// JSON (Chromium и собственный формат)
+// ---------------------------------------------------------------------------
+
+BookmarkImporter::JsonToken BookmarkImporter::readJsonToken(QString &value)
+{
+    forever {
+        if (m_position >= m_buffer.size() && !fillBuffer()) {
+            return JsonEnd;
+        }
+        
+        const QChar c = m_buffer.at(m_position);
+        if (c.isSpace() || c == QLatin1Char(',') || c == QLatin1Char(':')) {
+            ++m_position;
+            continue;
+        }
+        
+        switch (c.unicode()) {
+        case '{':
+            ++m_position;
+            return JsonBeginObject;
+        case '}':
+            ++m_position;
+            return JsonEndObject;
+        case '[':
+            ++m_position;
+            return JsonBeginArray;
+        case ']':
+            ++m_position;
+            return JsonEndArray;
+        case '"':
+            ++m_position;
+            return readJsonString(value) ? JsonString : JsonError;
+        default:
+            return readJsonLiteral(value) ? JsonLiteral : JsonError;
+        }
+    }
+}
+
+bool BookmarkImporter::readJsonString(QString &value)
+{
+    value.clear();
+    
+    forever {
+        int i = m_position;
+        const int size = m_buffer.size();
+        while (i < size && m_buffer.at(i) != QLatin1Char('"') && m_buffer.at(i) != QLatin1Char('\\')) {
+            ++i;
+        }
+        value += QStringView(m_buffer).mid(m_position, i - m_position);
+        m_position = i;
+        
+        if (i == size) {
+            if (!fillBuffer()) {
+                return false;
+            }
+            continue;
+        }
+        
+        if (m_buffer.at(i) == QLatin1Char('"')) {
+            ++m_position;
+            return true;
+        }
+        
+        // Экранирование: \uXXXX занимает 6 символов
+        while (m_buffer.size() - m_position < 6 && fillBuffer()) {
+        }
+        if (m_buffer.size() - m_position < 2) {
+            return false;
+        }
+        
+        const QChar escaped = m_buffer.at(m_position + 1);
+        m_position += 2;
+        switch (escaped.unicode()) {
+        case 'b': value += QLatin1Char('\b'); break;
+        case 'f': value += QLatin1Char('\f'); break;
+        case 'n': value += QLatin1Char('\n'); break;
+        case 'r': value += QLatin1Char('\r'); break;
+        case 't': value += QLatin1Char('\t'); break;
+        case 'u': {
+            bool ok = false;
+            const ushort code = m_buffer.mid(m_position, 4).toUShort(&ok, 16);
+            if (!ok) {
+                return false;
+            }
+            // Суррогатные пары складываются сами: каждая половина - отдельный QChar
+            value += QChar(code);
+            m_position += 4;
+            break;
+        }
+        default:
+            value += escaped;
+            break;
+        }
+    }
+}
+
+bool BookmarkImporter::readJsonLiteral(QString &value)
+{
+    value.clear();
+    
+    forever {
+        int i = m_position;
+        const int size = m_buffer.size();
+        while (i < size) {
+            const QChar c = m_buffer.at(i);
+            if (c.isSpace() || c == QLatin1Char(',') || c == QLatin1Char('}') || c == QLatin1Char(']')) {
+                break;
+            }
+            ++i;
+        }
+        value += QStringView(m_buffer).mid(m_position, i - m_position);
+        m_position = i;
+        
+        if (i < size || !fillBuffer()) {
+            return !value.isEmpty();
+        }
+    }
+}
+
+bool BookmarkImporter::skipJsonValue(JsonToken token)
+{
+    if (token == JsonString || token == JsonLiteral) {
+        return true;
+    }
+    if (token != JsonBeginObject && token != JsonBeginArray) {
+        return false;
+    }
+    
+    QString value;
+    int depth = 1;
+    while (depth > 0) {
+        switch (readJsonToken(value)) {
+        case JsonBeginObject:
+        case JsonBeginArray:
+            ++depth;
+            break;
+        case JsonEndObject:
+        case JsonEndArray:
+            --depth;
+            break;
+        case JsonEnd:
+        case JsonError:
+            return false;
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+bool BookmarkImporter::importChromium()
+{
+    // {"checksum": ..., "roots": {"bookmark_bar": {...}, "other": {...}, ...}, ...}
+    QString value;
+    if (readJsonToken(value) != JsonBeginObject) {
+        return fail(tr("Некорректный файл закладок"));
+    }
+    
+    forever {
+        JsonToken token = readJsonToken(value);
+        if (token == JsonEndObject) {
+            return true;
+        }
+        if (token != JsonString) {
+            return fail(tr("Некорректный файл закладок"));
+        }
+        
+        const QString key = value;
+        token = readJsonToken(value);
+        if (key == QLatin1String("roots") && token == JsonBeginObject) {
+            forever {
+                token = readJsonToken(value);
+                if (token == JsonEndObject) {
+                    break;
+                }
+                if (token != JsonString) {
+                    return fail(tr("Некорректный файл закладок"));
+                }
+                
+                token = readJsonToken(value);
+                const bool ok = token == JsonBeginObject ? readChromiumNode(ROOT_KEY)
+                                                         : skipJsonValue(token);
+                if (!ok) {
+                    return fail(tr("Некорректный файл закладок"));
+                }
+            }
+        } else if (!skipJsonValue(token)) {
+            return fail(tr("Некорректный файл закладок"));
+        }
+    }
+}
+
+bool BookmarkImporter::readChromiumNode(int parentKey)
+{
+    // Ключи в файле Chromium отсортированы, поэтому "children" идёт раньше
+    // "name" и "type" - папка создаётся по закрытию узла
+    QString value;
+    QString type;
+    QString name;
+    QString url;
+    qint64 added = 0;
+    int folderKey = -1;
+    
+    forever {
+        JsonToken token = readJsonToken(value);
+        if (token == JsonEndObject) {
+            break;
+        }
+        if (token != JsonString) {
+            return false;
+        }
+        
+        const QString key = value;
+        token = readJsonToken(value);
+        if (key == QLatin1String("children") && token == JsonBeginArray) {
+            folderKey = m_nextKey++;
+            forever {
+                token = readJsonToken(value);
+                if (token == JsonEndArray) {
+                    break;
+                }
+                if (token != JsonBeginObject || !readChromiumNode(folderKey)) {
+                    return false;
+                }
+            }
+        } else if (token == JsonString || token == JsonLiteral) {
+            if (key == QLatin1String("type")) type = value;
+            else if (key == QLatin1String("name")) name = value;
+            else if (key == QLatin1String("url")) url = value;
+            else if (key == QLatin1String("date_added")) added = value.toLongLong();
+        } else if (!skipJsonValue(token)) {
+            return false;
+        }
+    }
+    
+    // date_added - микросекунды с 1601 года
+    const QDateTime addedDate = added > 0
+        ? QDateTime::fromMSecsSinceEpoch(added / 1000 - WEBKIT_EPOCH_OFFSET_MS)
+        : QDateTime();
+    
+    if (type == QLatin1String("folder")) {
+        if (folderKey < 0) {
+            folderKey = m_nextKey++;
+        }
+        addFolder({folderKey, parentKey, name});
+    } else if (type == QLatin1String("url")) {
+        addBookmark({url, name, parentKey, addedDate});
+    }
+    return true;
+}
+
+bool BookmarkImporter::importBrowserJson()
+{
+    // {"bookmarks": [...], "folders": [...]}: закладки идут раньше папок,
+    // поэтому строковые id папок отображаются в ключи по мере появления
+    QHash<QString, int> keys;
+    auto keyFor = [this, &keys](const QString &id) {
+        // "root" - корень нашего экспорта, он же корень импорта
+        if (id.isEmpty() || id == QLatin1String("root")) {
+            return int(ROOT_KEY);
+        }
+        auto it = keys.constFind(id);
+        if (it != keys.constEnd()) {
+            return it.value();
+        }
+        const int key = m_nextKey++;
+        keys.insert(id, key);
+        return key;
+    };
+    
+    QString value;
+    if (readJsonToken(value) != JsonBeginObject) {
+        return fail(tr("Некорректный файл закладок"));
+    }
+    
+    forever {
+        JsonToken token = readJsonToken(value);
+        if (token == JsonEndObject) {
+            return true;
+        }
+        if (token != JsonString) {
+            return fail(tr("Некорректный файл закладок"));
+        }
+        
+        const QString key = value;
+        token = readJsonToken(value);
+        const bool isBookmarks = key == QLatin1String("bookmarks");
+        if ((isBookmarks || key == QLatin1String("folders")) && token == JsonBeginArray) {
+            QHash<QString, QString> fields;
+            forever {
+                token = readJsonToken(value);
+                if (token == JsonEndArray) {
+                    break;
+                }
+                if (token != JsonBeginObject || !readFlatJsonObject(fields)) {
+                    return fail(tr("Некорректный файл закладок"));
+                }
+                
+                if (isBookmarks) {
+                    addBookmark({fields.value("url"), fields.value("title"),
+                                 keyFor(fields.value("folderId")),
+                                 QDateTime::fromString(fields.value("addedDate"), Qt::ISODate)});
+                } else {
+                    addFolder({keyFor(fields.value("id")), keyFor(fields.value("parentId")),
+                               fields.value("name")});
+                }
+            }
+        } else if (!skipJsonValue(token)) {
+            return fail(tr("Некорректный файл закладок"));
+        }
+    }
+}
+
+bool BookmarkImporter::readFlatJsonObject(QHash<QString, QString> &fields)
+{
+    fields.clear();
+    QString value;
+    
+    forever {
+        JsonToken token = readJsonToken(value);
+        if (token == JsonEndObject) {
+            return true;
+        }
+        if (token != JsonString) {
+            return false;
+        }
+        
+        const QString key = value;
+        token = readJsonToken(value);
+        if (token == JsonString || token == JsonLiteral) {
+            fields.insert(key, value);
+        } else if (!skipJsonValue(token)) {
+            return false;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Firefox places.sqlite
+// ---------------------------------------------------------------------------
+
+bool BookmarkImporter::importFirefox(const QString &path)
+{
+    // Запущенный Firefox держит базу заблокированной - читаем копию.
+    // Свежие изменения лежат в -wal, без него копия устаревшая или пустая.
+    QTemporaryDir tempDir;
+    const QString copyPath = tempDir.filePath("places.sqlite");
+    if (!tempDir.isValid() || !QFile::copy(path, copyPath)) {
+        return fail(tr("Не удалось скопировать %1").arg(path));
+    }
+    for (const QString &suffix : {QStringLiteral("-wal"), QStringLiteral("-shm")}) {
+        if (QFile::exists(path + suffix) && !QFile::copy(path + suffix, copyPath + suffix)) {
+            return fail(tr("Не удалось скопировать %1").arg(path + suffix));
+        }
+    }
+    
+    const QString connectionName = "bookmark_import_places";
+    QString error;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        // Копия открывается на запись: SQLite применит к ней журнал -wal
+        db.setDatabaseName(copyPath);
+        
+        if (!db.open()) {
+            error = db.lastError().text();
+        } else {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            
+            qint64 total = 0;
+            if (query.exec("SELECT COUNT(*) FROM moz_bookmarks") && query.next()) {
+                total = query.value(0).toLongLong();
+            }
+            
+            // type: 1 - закладка, 2 - папка; dateAdded в микросекундах.
+            // Поддерево меток повторяет закладки и в импорт не попадает.
+            query.prepare("WITH RECURSIVE tags(id) AS ("
+                          "SELECT ? UNION ALL "
+                          "SELECT b.id FROM moz_bookmarks b JOIN tags t ON b.parent = t.id) "
+                          "SELECT b.id, b.type, b.parent, b.title, p.url, b.dateAdded "
+                          "FROM moz_bookmarks b LEFT JOIN moz_places p ON p.id = b.fk "
+                          "WHERE b.id NOT IN (SELECT id FROM tags) "
+                          "ORDER BY b.parent, b.position");
+            query.addBindValue(int(FIREFOX_TAGS_ID));
+            if (!query.exec()) {
+                error = query.lastError().text();
+            } else {
+                qint64 processed = 0;
+                while (query.next()) {
+                    const int id = query.value(0).toInt();
+                    const int type = query.value(1).toInt();
+                    const int parent = query.value(2).toInt();
+                    const int parentKey = parent <= FIREFOX_ROOT_ID ? int(ROOT_KEY) : parent;
+                    
+                    if (type == 2 && id > FIREFOX_ROOT_ID) {
+                        addFolder({id, parentKey, query.value(3).toString()});
+                    } else if (type == 1) {
+                        const qint64 added = query.value(5).toLongLong();
+                        addBookmark({query.value(4).toString(), query.value(3).toString(), parentKey,
+                                     added > 0 ? QDateTime::fromMSecsSinceEpoch(added / 1000)
+                                               : QDateTime()});
+                    }
+                    
+                    if (++processed % m_batchSize == 0) {
+                        emit progress(processed, total);
+                    }
+                }
+                emit progress(total, total);
+            }
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    
+    if (!error.isEmpty()) {
+        return fail(error);
+    }
+    flushBatch();
+    return true;
+}
@@ -0,0 +1,120 @@
+#ifndef BOOKMARKIMPORTER_H
+#define BOOKMARKIMPORTER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QStringDecoder>
+#include <QHash>
+#include <QList>
+
+class QIODevice;
+
+// Папка в импортируемом файле. Ключи локальны для одного импорта,
+// родитель может встретиться позже своих потомков.
+struct ImportedFolder {
+    int key;
+    int parentKey;
+    QString name;
+};
+
+struct ImportedBookmark {
+    QString url;
+    QString title;
+    int folderKey;
+    QDateTime addedDate;
+};
+
+// Потоковый импорт закладок: файл читается порциями, найденные записи
+// отдаются пачками через batchReady, поэтому память не зависит от размера файла.
+class BookmarkImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format {
+        UnknownFormat,
+        NetscapeHtml,   // bookmarks.html, экспорт всех браузеров
+        ChromiumJson,   // файл Bookmarks профиля Chrome/Chromium/Edge
+        FirefoxPlaces,  // places.sqlite профиля Firefox
+        BrowserJson     // собственный формат exportBookmarks
+    };
+
+    explicit BookmarkImporter(QObject *parent = nullptr);
+
+    static Format detectFormat(const QString &path);
+    static QString profileBookmarksPath(const QString &browserName);
+    
+    bool importFile(const QString &path, Format format = UnknownFormat);
+    void setBatchSize(int size);
+    QString errorString() const;
+    
+    static const int ROOT_KEY = 0;
+
+signals:
+    void batchReady(const QList<ImportedFolder> &folders,
+                    const QList<ImportedBookmark> &bookmarks);
+    void progress(qint64 processed, qint64 total);
+
+private:
+    struct HtmlToken {
+        bool isTag;
+        QString name;
+        QHash<QString, QString> attributes;
+        QString text;
+    };
+    
+    enum JsonToken {
+        JsonEnd,
+        JsonError,
+        JsonBeginObject,
+        JsonEndObject,
+        JsonBeginArray,
+        JsonEndArray,
+        JsonString,
+        JsonLiteral
+    };
+    
+    bool importNetscape();
+    bool importChromium();
+    bool importBrowserJson();
+    bool importFirefox(const QString &path);
+    
+    // Чтение порциями
+    bool fillBuffer();
+    
+    // Разбор HTML
+    bool readHtmlToken(HtmlToken &token);
+    static void parseTag(const QString &tag, HtmlToken &token);
+    static QString decodeEntities(const QString &text);
+    
+    // Разбор JSON
+    JsonToken readJsonToken(QString &value);
+    bool readJsonString(QString &value);
+    bool readJsonLiteral(QString &value);
+    bool skipJsonValue(JsonToken token);
+    bool readChromiumNode(int parentKey);
+    bool readFlatJsonObject(QHash<QString, QString> &fields);
+    
+    void addFolder(const ImportedFolder &folder);
+    void addBookmark(const ImportedBookmark &bookmark);
+    void flushBatch();
+    bool fail(const QString &error);
+    
+    QIODevice *m_device;
+    QStringDecoder m_decoder;
+    QString m_buffer;
+    int m_position;
+    int m_batchSize;
+    int m_nextKey;
+    QList<ImportedFolder> m_folders;
+    QList<ImportedBookmark> m_bookmarks;
+    QString m_error;
+    
+    static const int CHUNK_SIZE = 64 * 1024;
+    static const int DEFAULT_BATCH_SIZE = 1000;
+    static const int FIREFOX_ROOT_ID = 1;
+    static const int FIREFOX_TAGS_ID = 4; // корень меток, не папка закладок
+    static const qint64 WEBKIT_EPOCH_OFFSET_MS = 11644473600000LL; // 1601 -> 1970
+};
+
+#endif // BOOKMARKIMPORTER_H
@@ -0,0 +1,122 @@
+#include "bookmarkindex.h"
+#include <QUrl>
+#include <QRegularExpression>
+#include <algorithm>
+
+void BookmarkIndex::insert(const QString &id, const QString &title, const QString &url,
+                           const QStringList &tags)
+{
+    remove(id);
+    
+    // Метки разбиваются так же, как запрос, иначе "machine-learning"
+    // или "два слова" не нашлись бы ни по целой метке, ни по слову
+    QStringList tokens = tokenize(title) + urlTokens(url);
+    for (const QString &tag : tags) {
+        tokens.append(tokenize(tag));
+    }
+    tokens.removeDuplicates();
+    
+    for (const QString &token : tokens) {
+        m_postings[token].insert(id);
+    }
+    m_documentTokens.insert(id, tokens);
+}
+
+void BookmarkIndex::remove(const QString &id)
+{
+    auto it = m_documentTokens.find(id);
+    if (it == m_documentTokens.end()) {
+        return;
+    }
+    
+    for (const QString &token : it.value()) {
+        auto posting = m_postings.find(token);
+        if (posting != m_postings.end()) {
+            posting->remove(id);
+            if (posting->isEmpty()) {
+                m_postings.erase(posting);
+            }
+        }
+    }
+    m_documentTokens.erase(it);
+}
+
+void BookmarkIndex::clear()
+{
+    m_postings.clear();
+    m_documentTokens.clear();
+}
+
+QSet<QString> BookmarkIndex::find(const QString &query) const
+{
+    QStringList terms = tokenize(query);
+    if (terms.isEmpty()) {
+        return QSet<QString>();
+    }
+    
+    QList<QSet<QString>> matches;
+    for (const QString &term : terms) {
+        QSet<QString> ids = findPrefix(term);
+        if (ids.isEmpty()) {
+            return QSet<QString>();
+        }
+        matches.append(ids);
+    }
+    
+    // Пересекаем начиная с самого короткого списка
+    std::sort(matches.begin(), matches.end(),
+              [](const QSet<QString> &a, const QSet<QString> &b) {
+        return a.size() < b.size();
+    });
+    
+    QSet<QString> result = matches.first();
+    for (int i = 1; i < matches.size() && !result.isEmpty(); ++i) {
+        result.intersect(matches[i]);
+    }
+    return result;
+}
+
+QSet<QString> BookmarkIndex::findPrefix(const QString &prefix) const
+{
+    // Токены в QMap упорядочены, все продолжения префикса идут подряд
+    QSet<QString> result;
+    for (auto it = m_postings.lowerBound(prefix);
+         it != m_postings.end() && it.key().startsWith(prefix); ++it) {
+        result.unite(it.value());
+    }
+    return result;
+}
+
+QStringList BookmarkIndex::tokenize(const QString &text)
+{
+    static const QRegularExpression separator("[^\\p{L}\\p{N}]+");
+    
+    QStringList tokens = text.toCaseFolded().split(separator, Qt::SkipEmptyParts);
+    tokens.removeDuplicates();
+    return tokens;
+}
+
+QStringList BookmarkIndex::urlTokens(const QString &url)
+{
+    QUrl parsed(url);
+    if (!parsed.isValid() || parsed.host().isEmpty()) {
+        return tokenize(url);
+    }
+    
+    QStringList tokens;
+    
+    // Метки домена без служебного www; составные метки (my-site) режутся
+    // так же, как запрос
+    const QStringList labels = parsed.host().toCaseFolded().split('.', Qt::SkipEmptyParts);
+    for (const QString &label : labels) {
+        if (label != "www") {
+            tokens.append(tokenize(label));
+        }
+    }
+    
+    // Сегменты пути
+    tokens.append(tokenize(parsed.path()));
+    
+    tokens.removeDuplicates();
+    return tokens;
+}
@@ -0,0 +1,36 @@
+#ifndef BOOKMARKINDEX_H
+#define BOOKMARKINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+
+// Инвертированный индекс токенов для поиска по закладкам.
+// Токены приводятся к единому регистру один раз при вставке.
+class BookmarkIndex
+{
+public:
+    // Обновление индекса
+    void insert(const QString &id, const QString &title, const QString &url,
+                const QStringList &tags = QStringList());
+    void remove(const QString &id);
+    void clear();
+    
+    // Поиск: каждый термин запроса сопоставляется как префикс токена,
+    // результаты по разным терминам пересекаются
+    QSet<QString> find(const QString &query) const;
+    
+    // Разбиение на токены
+    static QStringList tokenize(const QString &text);
+    static QStringList urlTokens(const QString &url);
+
+private:
+    QSet<QString> findPrefix(const QString &prefix) const;
+    
+    QMap<QString, QSet<QString>> m_postings;       // токен -> id закладок
+    QHash<QString, QStringList> m_documentTokens;  // id закладки -> токены
+};
+
+#endif // BOOKMARKINDEX_H
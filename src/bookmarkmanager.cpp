@@ -6,104 +6,716 @@
 #include <QDateTime>
 #include <QStandardPaths>
 #include <QDir>
+#include <QSaveFile>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QCborMap>
+#include <QCborValue>
+#include <QTimer>
+#include <QUuid>
+#include <algorithm>
+#include "faviconstore.h"
 
 const QString BookmarkManager::BOOKMARKS_FILE = "bookmarks.json";
+const QString BookmarkManager::BOOKMARKS_BACKUP_FILE = "bookmarks.json.bak";
+const QString BookmarkManager::SNAPSHOT_FILE = "bookmarks.snapshot";
+const QString BookmarkManager::SNAPSHOT_MAGIC = "BMKS";
+const QString BookmarkManager::JOURNAL_FILE = "bookmarks.journal";
+const QString BookmarkManager::COMPACTING_JOURNAL_FILE = "bookmarks.journal.compacting";
 
 BookmarkManager::BookmarkManager(QObject *parent)
     : QObject(parent)
+    , m_compacting(false)
+    , m_journalBatching(false)
+    , m_linkChecker(new LinkChecker(this))
+    , m_linkCheckTimer(new QTimer(this))
+    , m_fixRedirects(false)
+    , m_linkCheckCount(0)
+    , m_brokenLinkCount(0)
 {
+    m_dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(m_dataPath);
+    
     loadBookmarks();
+    openJournal();
+    
+    // Иконки сайтов с закладками не удаляются при чистке хранилища
+    FaviconStore::instance()->addUsageCheck(this, [this](const QSet<QString> &origins) {
+        QSet<QString> used;
+        for (const Bookmark &bookmark : std::as_const(m_bookmarks)) {
+            const QString origin = FaviconStore::originOf(QUrl(bookmark.url));
+            if (origins.contains(origin)) {
+                used.insert(origin);
+            }
+        }
+        return used;
+    });
+    
+    connect(m_linkChecker, &LinkChecker::checked, this, &BookmarkManager::handleLinkChecked);
+    connect(m_linkChecker, &LinkChecker::finished, this, [this]() {
+        emit linkCheckFinished(m_linkCheckCount, m_brokenLinkCount);
+    });
+    
+    // Периодическая проверка включается только по настройке пользователя
+    connect(m_linkCheckTimer, &QTimer::timeout, this, &BookmarkManager::checkUrls);
 }
 
 BookmarkManager::~BookmarkManager()
 {
+    // Дожидаемся фонового уплотнения, затем сохраняем итоговый снимок
+    m_compaction.waitForFinished();
     saveBookmarks();
 }
 
 void BookmarkManager::loadBookmarks()
 {
-    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QFile file(path + "/" + BOOKMARKS_FILE);
+    // Двоичный снимок; JSON читается только при первом запуске после обновления
+    if (!readSnapshot(m_dataPath + "/" + SNAPSHOT_FILE)) {
+        m_folders.clear();
+        m_bookmarks.clear();
+        readJsonBookmarks(m_dataPath + "/" + BOOKMARKS_FILE);
+    }
     
-    if (file.exists() && file.open(QIODevice::ReadOnly)) {
-        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-        file.close();
-        
-        if (doc.isObject()) {
-            QJsonObject root = doc.object();
-            
-            // Загрузка папок
-            QJsonArray folders = root["folders"].toArray();
-            for (const QJsonValue &val : folders) {
-                QJsonObject folderObj = val.toObject();
-                BookmarkFolder folder;
-                folder.id = folderObj["id"].toString();
-                folder.name = folderObj["name"].toString();
-                folder.parentId = folderObj["parentId"].toString();
-                m_folders[folder.id] = folder;
-            }
-            
-            // Загрузка закладок
-            QJsonArray bookmarks = root["bookmarks"].toArray();
-            for (const QJsonValue &val : bookmarks) {
-                QJsonObject bookmarkObj = val.toObject();
-                Bookmark bookmark;
-                bookmark.id = bookmarkObj["id"].toString();
-                bookmark.url = bookmarkObj["url"].toString();
-                bookmark.title = bookmarkObj["title"].toString();
-                bookmark.folderId = bookmarkObj["folderId"].toString();
-                bookmark.icon = bookmarkObj["icon"].toString();
-                bookmark.addedDate = QDateTime::fromString(
-                    bookmarkObj["addedDate"].toString(), Qt::ISODate);
-                bookmark.lastVisited = QDateTime::fromString(
-                    bookmarkObj["lastVisited"].toString(), Qt::ISODate);
-                
-                m_bookmarks[bookmark.id] = bookmark;
-            }
+    // Применяем изменения, не попавшие в снимок. Журнал, оставшийся от
+    // прерванного уплотнения, старше текущего и проигрывается первым.
+    replayJournal(m_dataPath + "/" + COMPACTING_JOURNAL_FILE);
+    replayJournal(m_dataPath + "/" + JOURNAL_FILE);
+    
+    rebuildChildrenIndex();
+    rebuildSearchIndex();
+}
+
+void BookmarkManager::rebuildSearchIndex()
+{
+    m_searchIndex.clear();
+    for (const Bookmark &bookmark : m_bookmarks) {
+        indexBookmark(bookmark);
+    }
+}
+
+void BookmarkManager::indexBookmark(const Bookmark &bookmark)
+{
+    m_searchIndex.insert(bookmark.id, bookmark.title, bookmark.url, bookmark.tags);
+    m_similarityIndex.insert(bookmark.id, bookmark.title, bookmark.url);
+}
+
+void BookmarkManager::unindexBookmark(const QString &id)
+{
+    m_searchIndex.remove(id);
+    m_similarityIndex.remove(id);
+}
+
+void BookmarkManager::rebuildChildrenIndex()
+{
+    m_folderBookmarks.clear();
+    m_childFolders.clear();
+    
+    // Старые записи без позиции упорядочиваем по дате добавления
+    QList<Bookmark> bookmarks = m_bookmarks.values();
+    std::sort(bookmarks.begin(), bookmarks.end(),
+              [](const Bookmark &a, const Bookmark &b) {
+        if (a.position != b.position) {
+            return a.position < b.position;
+        }
+        return a.addedDate < b.addedDate;
+    });
+    for (const Bookmark &bookmark : bookmarks) {
+        m_folderBookmarks[bookmark.folderId].append(bookmark.id);
+    }
+    
+    QList<BookmarkFolder> folders = m_folders.values();
+    std::sort(folders.begin(), folders.end(),
+              [](const BookmarkFolder &a, const BookmarkFolder &b) {
+        if (a.position != b.position) {
+            return a.position < b.position;
         }
+        return a.name < b.name;
+    });
+    for (const BookmarkFolder &folder : folders) {
+        m_childFolders[folder.parentId].append(folder.id);
+    }
+}
+
+void BookmarkManager::unindexChild(QHash<QString, QStringList> &index,
+                                   const QString &parentId, const QString &id)
+{
+    auto it = index.find(parentId);
+    if (it == index.end()) {
+        return;
+    }
+    
+    it->removeOne(id);
+    if (it->isEmpty()) {
+        index.erase(it);
+    }
+}
+
+int BookmarkManager::nextBookmarkPosition(const QString &folderId) const
+{
+    const QStringList children = m_folderBookmarks.value(folderId);
+    if (children.isEmpty()) {
+        return 0;
     }
+    return m_bookmarks.value(children.last()).position + 1;
+}
+
+int BookmarkManager::nextFolderPosition(const QString &parentId) const
+{
+    const QStringList children = m_childFolders.value(parentId);
+    if (children.isEmpty()) {
+        return 0;
+    }
+    return m_folders.value(children.last()).position + 1;
 }
 
 void BookmarkManager::saveBookmarks()
 {
-    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(path);
-    QFile file(path + "/" + BOOKMARKS_FILE);
+    m_journal.close();
     
+    if (writeSnapshot(m_dataPath + "/" + SNAPSHOT_FILE, m_folders, m_bookmarks)) {
+        // Снимок содержит все изменения, журналы больше не нужны
+        QFile::remove(m_dataPath + "/" + COMPACTING_JOURNAL_FILE);
+        QFile::remove(m_dataPath + "/" + JOURNAL_FILE);
+        retireJsonBookmarks();
+    }
+}
+
+void BookmarkManager::retireJsonBookmarks()
+{
+    // Прежний JSON больше не читается, но остаётся резервной копией
+    const QString jsonPath = m_dataPath + "/" + BOOKMARKS_FILE;
+    if (!QFile::exists(jsonPath)) {
+        return;
+    }
+    
+    const QString backupPath = m_dataPath + "/" + BOOKMARKS_BACKUP_FILE;
+    QFile::remove(backupPath);
+    QFile::rename(jsonPath, backupPath);
+}
+
+bool BookmarkManager::readJsonBookmarks(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    file.close();
+    
+    if (!doc.isObject()) {
+        return false;
+    }
+    
+    QJsonObject root = doc.object();
+    
+    // Загрузка папок
+    QJsonArray folders = root["folders"].toArray();
+    for (const QJsonValue &val : folders) {
+        BookmarkFolder folder = folderFromJson(val.toObject());
+        m_folders[folder.id] = folder;
+    }
+    
+    // Загрузка закладок
+    QJsonArray bookmarks = root["bookmarks"].toArray();
+    for (const QJsonValue &val : bookmarks) {
+        Bookmark bookmark = bookmarkFromJson(val.toObject());
+        m_bookmarks[bookmark.id] = bookmark;
+    }
+    
+    return true;
+}
+
+bool BookmarkManager::writeJsonBookmarks(const QString &filePath,
+                                         const QHash<QString, BookmarkFolder> &folders,
+                                         const QHash<QString, Bookmark> &bookmarks)
+{
     QJsonObject root;
     
     // Сохранение папок
-    QJsonArray folders;
-    for (const BookmarkFolder &folder : m_folders) {
-        QJsonObject folderObj;
-        folderObj["id"] = folder.id;
-        folderObj["name"] = folder.name;
-        folderObj["parentId"] = folder.parentId;
-        folders.append(folderObj);
+    QJsonArray foldersArray;
+    for (const BookmarkFolder &folder : folders) {
+        foldersArray.append(folderToJson(folder));
     }
-    root["folders"] = folders;
+    root["folders"] = foldersArray;
     
     // Сохранение закладок
-    QJsonArray bookmarks;
-    for (const Bookmark &bookmark : m_bookmarks) {
-        QJsonObject bookmarkObj;
-        bookmarkObj["id"] = bookmark.id;
-        bookmarkObj["url"] = bookmark.url;
-        bookmarkObj["title"] = bookmark.title;
-        bookmarkObj["folderId"] = bookmark.folderId;
-        bookmarkObj["icon"] = bookmark.icon;
-        bookmarkObj["addedDate"] = bookmark.addedDate.toString(Qt::ISODate);
-        bookmarkObj["lastVisited"] = bookmark.lastVisited.toString(Qt::ISODate);
-        bookmarks.append(bookmarkObj);
+    QJsonArray bookmarksArray;
+    for (const Bookmark &bookmark : bookmarks) {
+        bookmarksArray.append(bookmarkToJson(bookmark));
+    }
+    root["bookmarks"] = bookmarksArray;
+    
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
+
+// Формат снимка (CBOR, один массив верхнего уровня):
+//   [ "BMKS", версия, [таблица строк],
+//     [[id, name, parent#, position], ...],
+//     [[id, url, title, folder#, icon#, position, visitCount,
+//       addedMs, lastVisitedMs, [tag#, ...], {metadata}], ...] ]
+// Поля с # - индексы в таблице строк: папки, иконки и теги повторяются
+// у множества закладок и хранятся один раз. Даты - мс от эпохи, -1 если нет.
+// Снимки версии 1 не содержат metadata.
+bool BookmarkManager::writeSnapshot(const QString &filePath,
+                                    const QHash<QString, BookmarkFolder> &folders,
+                                    const QHash<QString, Bookmark> &bookmarks)
+{
+    QStringList strings;
+    QHash<QString, qint64> stringIds;
+    auto intern = [&strings, &stringIds](const QString &value) -> qint64 {
+        auto it = stringIds.constFind(value);
+        if (it != stringIds.constEnd()) {
+            return it.value();
+        }
+        qint64 id = strings.size();
+        strings.append(value);
+        stringIds.insert(value, id);
+        return id;
+    };
+    auto epochMs = [](const QDateTime &date) -> qint64 {
+        return date.isValid() ? date.toMSecsSinceEpoch() : -1;
+    };
+    
+    // Таблица строк должна предшествовать записям, поэтому сначала
+    // собираем индексы, а затем пишем всё одним проходом
+    for (const BookmarkFolder &folder : folders) {
+        intern(folder.parentId);
+    }
+    for (const Bookmark &bookmark : bookmarks) {
+        intern(bookmark.folderId);
+        intern(bookmark.icon);
+        for (const QString &tag : bookmark.tags) {
+            intern(tag);
+        }
+    }
+    
+    // QSaveFile заменяет файл атомарно: при сбое остаётся прежний снимок
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    QCborStreamWriter writer(&file);
+    writer.startArray(5);
+    writer.append(SNAPSHOT_MAGIC);
+    writer.append(qint64(SNAPSHOT_VERSION));
+    
+    writer.startArray(strings.size());
+    for (const QString &value : strings) {
+        writer.append(value);
+    }
+    writer.endArray();
+    
+    writer.startArray(folders.size());
+    for (const BookmarkFolder &folder : folders) {
+        writer.startArray(4);
+        writer.append(folder.id);
+        writer.append(folder.name);
+        writer.append(stringIds.value(folder.parentId));
+        writer.append(qint64(folder.position));
+        writer.endArray();
+    }
+    writer.endArray();
+    
+    writer.startArray(bookmarks.size());
+    for (const Bookmark &bookmark : bookmarks) {
+        writer.startArray(11);
+        writer.append(bookmark.id);
+        writer.append(bookmark.url);
+        writer.append(bookmark.title);
+        writer.append(stringIds.value(bookmark.folderId));
+        writer.append(stringIds.value(bookmark.icon));
+        writer.append(qint64(bookmark.position));
+        writer.append(qint64(bookmark.visitCount));
+        writer.append(epochMs(bookmark.addedDate));
+        writer.append(epochMs(bookmark.lastVisited));
+        writer.startArray(bookmark.tags.size());
+        for (const QString &tag : bookmark.tags) {
+            writer.append(stringIds.value(tag));
+        }
+        writer.endArray();
+        QCborMap::fromVariantHash(bookmark.metadata).toCbor(writer);
+        writer.endArray();
+    }
+    writer.endArray();
+    
+    writer.endArray();
+    return file.commit();
+}
+
+bool BookmarkManager::readSnapshot(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    // Чтение из памяти заметно быстрее, чем мелкими порциями из устройства
+    QCborStreamReader reader(file.readAll());
+    file.close();
+    
+    auto fromEpochMs = [](qint64 ms) {
+        return ms < 0 ? QDateTime() : QDateTime::fromMSecsSinceEpoch(ms);
+    };
+    
+    if (!reader.isArray() || !reader.enterContainer()) {
+        return false;
+    }
+    if (readCborString(reader) != SNAPSHOT_MAGIC) {
+        return false;
+    }
+    const qint64 version = readCborInteger(reader);
+    if (version < 1 || version > SNAPSHOT_VERSION) {
+        return false;
+    }
+    
+    // Таблица строк
+    // Длина массива доступна только до входа в него
+    QStringList strings;
+    if (!reader.isArray()) {
+        return false;
+    }
+    if (reader.isLengthKnown()) {
+        strings.reserve(reader.length());
+    }
+    if (!reader.enterContainer()) {
+        return false;
+    }
+    while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+        strings.append(readCborString(reader));
+    }
+    reader.leaveContainer();
+    
+    auto lookup = [&strings](qint64 index) {
+        return index >= 0 && index < strings.size() ? strings.at(index) : QString();
+    };
+    
+    // Папки
+    if (!reader.isArray()) {
+        return false;
+    }
+    if (reader.isLengthKnown()) {
+        m_folders.reserve(reader.length());
+    }
+    if (!reader.enterContainer()) {
+        return false;
+    }
+    while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+        if (!reader.isArray() || !reader.enterContainer()) {
+            return false;
+        }
+        BookmarkFolder folder;
+        folder.id = readCborString(reader);
+        folder.name = readCborString(reader);
+        folder.parentId = lookup(readCborInteger(reader));
+        folder.position = readCborInteger(reader);
+        reader.leaveContainer();
+        m_folders.insert(folder.id, folder);
+    }
+    reader.leaveContainer();
+    
+    // Закладки
+    if (!reader.isArray()) {
+        return false;
+    }
+    if (reader.isLengthKnown()) {
+        m_bookmarks.reserve(reader.length());
+    }
+    if (!reader.enterContainer()) {
+        return false;
+    }
+    while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+        if (!reader.isArray() || !reader.enterContainer()) {
+            return false;
+        }
+        Bookmark bookmark;
+        bookmark.id = readCborString(reader);
+        bookmark.url = readCborString(reader);
+        bookmark.title = readCborString(reader);
+        bookmark.folderId = lookup(readCborInteger(reader));
+        bookmark.icon = lookup(readCborInteger(reader));
+        bookmark.position = readCborInteger(reader);
+        bookmark.visitCount = readCborInteger(reader);
+        bookmark.addedDate = fromEpochMs(readCborInteger(reader));
+        bookmark.lastVisited = fromEpochMs(readCborInteger(reader));
+        
+        if (!reader.isArray() || !reader.enterContainer()) {
+            return false;
+        }
+        while (reader.hasNext() && reader.lastError() == QCborError::NoError) {
+            bookmark.tags.append(lookup(readCborInteger(reader)));
+        }
+        reader.leaveContainer();
+        
+        if (version >= 2 && reader.isMap()) {
+            bookmark.metadata = QCborValue::fromCbor(reader).toMap().toVariantHash();
+        }
+        
+        reader.leaveContainer();
+        m_bookmarks.insert(bookmark.id, bookmark);
+    }
+    reader.leaveContainer();
+    
+    return reader.lastError() == QCborError::NoError;
+}
+
+QString BookmarkManager::readCborString(QCborStreamReader &reader)
+{
+    QString result;
+    if (!reader.isString()) {
+        reader.next();
+        return result;
+    }
+    
+    // Строка может быть разбита на несколько фрагментов
+    auto chunk = reader.readString();
+    while (chunk.status == QCborStreamReader::Ok) {
+        result += chunk.data;
+        chunk = reader.readString();
+    }
+    return result;
+}
+
+qint64 BookmarkManager::readCborInteger(QCborStreamReader &reader)
+{
+    qint64 result = -1;
+    if (reader.isInteger()) {
+        result = reader.toInteger();
+    }
+    reader.next();
+    return result;
+}
+
+QJsonObject BookmarkManager::bookmarkToJson(const Bookmark &bookmark)
+{
+    QJsonObject bookmarkObj;
+    bookmarkObj["id"] = bookmark.id;
+    bookmarkObj["url"] = bookmark.url;
+    bookmarkObj["title"] = bookmark.title;
+    bookmarkObj["folderId"] = bookmark.folderId;
+    bookmarkObj["position"] = bookmark.position;
+    bookmarkObj["icon"] = bookmark.icon;
+    bookmarkObj["tags"] = QJsonArray::fromStringList(bookmark.tags);
+    bookmarkObj["visitCount"] = bookmark.visitCount;
+    bookmarkObj["addedDate"] = bookmark.addedDate.toString(Qt::ISODate);
+    bookmarkObj["lastVisited"] = bookmark.lastVisited.toString(Qt::ISODate);
+    if (!bookmark.metadata.isEmpty()) {
+        bookmarkObj["metadata"] = QJsonObject::fromVariantHash(bookmark.metadata);
+    }
+    return bookmarkObj;
+}
+
+Bookmark BookmarkManager::bookmarkFromJson(const QJsonObject &bookmarkObj)
+{
+    Bookmark bookmark;
+    bookmark.id = bookmarkObj["id"].toString();
+    bookmark.url = bookmarkObj["url"].toString();
+    bookmark.title = bookmarkObj["title"].toString();
+    bookmark.folderId = bookmarkObj["folderId"].toString();
+    bookmark.position = bookmarkObj["position"].toInt();
+    bookmark.icon = bookmarkObj["icon"].toString();
+    for (const QJsonValue &tag : bookmarkObj["tags"].toArray()) {
+        bookmark.tags.append(tag.toString());
+    }
+    bookmark.visitCount = bookmarkObj["visitCount"].toInt();
+    bookmark.addedDate = QDateTime::fromString(
+        bookmarkObj["addedDate"].toString(), Qt::ISODate);
+    bookmark.lastVisited = QDateTime::fromString(
+        bookmarkObj["lastVisited"].toString(), Qt::ISODate);
+    bookmark.metadata = bookmarkObj["metadata"].toObject().toVariantHash();
+    return bookmark;
+}
+
+QJsonObject BookmarkManager::folderToJson(const BookmarkFolder &folder)
+{
+    QJsonObject folderObj;
+    folderObj["id"] = folder.id;
+    folderObj["name"] = folder.name;
+    folderObj["parentId"] = folder.parentId;
+    folderObj["position"] = folder.position;
+    return folderObj;
+}
+
+BookmarkFolder BookmarkManager::folderFromJson(const QJsonObject &folderObj)
+{
+    BookmarkFolder folder;
+    folder.id = folderObj["id"].toString();
+    folder.name = folderObj["name"].toString();
+    folder.parentId = folderObj["parentId"].toString();
+    folder.position = folderObj["position"].toInt();
+    return folder;
+}
+
+void BookmarkManager::openJournal()
+{
+    m_journal.setFileName(m_dataPath + "/" + JOURNAL_FILE);
+    if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        emit databaseError(m_journal.errorString());
+    }
+}
+
+void BookmarkManager::replayJournal(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    // Каждая запись - одна строка JSON с полным состоянием объекта,
+    // поэтому повторное применение записи безопасно
+    qint64 validEnd = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!line.endsWith('\n') || !doc.isObject()) {
+            // Недописанная при сбое последняя строка
+            break;
+        }
+        validEnd = file.pos();
+        
+        QJsonObject record = doc.object();
+        QString op = record["op"].toString();
+        
+        if (op == "putBookmark") {
+            Bookmark bookmark = bookmarkFromJson(record["bookmark"].toObject());
+            m_bookmarks[bookmark.id] = bookmark;
+        } else if (op == "removeBookmark") {
+            m_bookmarks.remove(record["id"].toString());
+        } else if (op == "putFolder") {
+            BookmarkFolder folder = folderFromJson(record["folder"].toObject());
+            m_folders[folder.id] = folder;
+        } else if (op == "removeFolder") {
+            m_folders.remove(record["id"].toString());
+        }
+    }
+    
+    // Обрезаем журнал по последней целой записи: иначе следующая запись
+    // допишется к битой строке и потеряется при следующем чтении
+    const qint64 fileSize = file.size();
+    file.close();
+    if (validEnd < fileSize && !QFile::resize(filePath, validEnd)) {
+        emit databaseError(tr("Не удалось обрезать журнал %1").arg(filePath));
+    }
+}
+
+void BookmarkManager::appendJournal(const QJsonObject &record)
+{
+    if (!m_journal.isOpen()) {
+        openJournal();
+    }
+    
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    
+    if (m_journal.write(line) != line.size()) {
+        emit databaseError(m_journal.errorString());
+        return;
     }
-    root["bookmarks"] = bookmarks;
     
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(QJsonDocument(root).toJson());
-        file.close();
+    // Пакетные изменения сбрасываются на диск один раз в конце пакета
+    if (!m_journalBatching) {
+        flushJournal();
     }
 }
 
+void BookmarkManager::flushJournal()
+{
+    if (!m_journal.flush()) {
+        emit databaseError(m_journal.errorString());
+        return;
+    }
+    
+    if (m_journal.size() > JOURNAL_COMPACT_THRESHOLD) {
+        compactJournal();
+    }
+}
+
+void BookmarkManager::journalBookmark(const Bookmark &bookmark)
+{
+    QJsonObject record;
+    record["op"] = "putBookmark";
+    record["bookmark"] = bookmarkToJson(bookmark);
+    appendJournal(record);
+}
+
+void BookmarkManager::journalFolder(const BookmarkFolder &folder)
+{
+    QJsonObject record;
+    record["op"] = "putFolder";
+    record["folder"] = folderToJson(folder);
+    appendJournal(record);
+}
+
+void BookmarkManager::journalRemoval(const QString &op, const QString &id)
+{
+    QJsonObject record;
+    record["op"] = op;
+    record["id"] = id;
+    appendJournal(record);
+}
+
+void BookmarkManager::compactJournal()
+{
+    if (m_compacting) {
+        return;
+    }
+    
+    // Откладываем текущий журнал в сторону и начинаем новый: записи,
+    // появившиеся во время уплотнения, попадут уже в него
+    const QString journalPath = m_dataPath + "/" + JOURNAL_FILE;
+    const QString compactingPath = m_dataPath + "/" + COMPACTING_JOURNAL_FILE;
+    
+    m_journal.close();
+    if (QFile::exists(compactingPath)) {
+        // Прошлое уплотнение не завершилось: дописываем журнал к отложенному
+        QFile pending(compactingPath);
+        QFile current(journalPath);
+        if (!pending.open(QIODevice::WriteOnly | QIODevice::Append) ||
+            !current.open(QIODevice::ReadOnly) ||
+            pending.write(current.readAll()) < 0 || !pending.flush()) {
+            openJournal();
+            return;
+        }
+        current.close();
+        QFile::remove(journalPath);
+    } else if (!QFile::rename(journalPath, compactingPath)) {
+        openJournal();
+        return;
+    }
+    openJournal();
+    
+    m_compacting = true;
+    
+    // Копии контейнеров разделяют данные неявно и не меняются в фоне
+    const QString snapshotPath = m_dataPath + "/" + SNAPSHOT_FILE;
+    const QHash<QString, BookmarkFolder> folders = m_folders;
+    const QHash<QString, Bookmark> bookmarks = m_bookmarks;
+    
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, compactingPath]() {
+        if (watcher->result()) {
+            QFile::remove(compactingPath);
+            retireJsonBookmarks();
+        }
+        m_compacting = false;
+        watcher->deleteLater();
+    });
+    
+    m_compaction = QtConcurrent::run([snapshotPath, folders, bookmarks]() {
+        return writeSnapshot(snapshotPath, folders, bookmarks);
+    });
+    watcher->setFuture(m_compaction);
+}
+
 QString BookmarkManager::addBookmark(const QString &url, const QString &title,
                                    const QString &folderId)
 {
@@ -112,21 +724,30 @@ QString BookmarkManager::addBookmark(const QString &url, const QString &title,
     bookmark.url = url;
     bookmark.title = title;
     bookmark.folderId = folderId;
+    bookmark.position = nextBookmarkPosition(folderId);
+    bookmark.visitCount = 0;
     bookmark.addedDate = QDateTime::currentDateTime();
     bookmark.lastVisited = bookmark.addedDate;
     
     m_bookmarks[bookmark.id] = bookmark;
+    m_folderBookmarks[folderId].append(bookmark.id);
+    indexBookmark(bookmark);
     emit bookmarkAdded(bookmark);
-    saveBookmarks();
+    journalBookmark(bookmark);
     
     return bookmark.id;
 }
 
 bool BookmarkManager::removeBookmark(const QString &id)
 {
-    if (m_bookmarks.remove(id) > 0) {
+    auto it = m_bookmarks.find(id);
+    if (it != m_bookmarks.end()) {
+        unindexChild(m_folderBookmarks, it->folderId, id);
+        unindexBookmark(id);
+        FaviconStore::instance()->releaseUrl(QUrl(it->url));
+        m_bookmarks.erase(it);
         emit bookmarkRemoved(id);
-        saveBookmarks();
+        journalRemoval("removeBookmark", id);
         return true;
     }
     return false;
@@ -137,27 +758,71 @@ bool BookmarkManager::updateBookmark(const QString &id, const QString &url,
 {
     if (m_bookmarks.contains(id)) {
         Bookmark &bookmark = m_bookmarks[id];
+        const QString oldUrl = bookmark.url;
         bookmark.url = url;
         bookmark.title = title;
         bookmark.lastVisited = QDateTime::currentDateTime();
+        indexBookmark(bookmark);
         
         emit bookmarkUpdated(bookmark);
-        saveBookmarks();
+        journalBookmark(bookmark);
+        
+        // Иконка прежнего адреса может больше никому не понадобиться
+        if (oldUrl != url) {
+            FaviconStore::instance()->releaseUrl(QUrl(oldUrl));
+        }
         return true;
     }
     return false;
 }
 
+bool BookmarkManager::setTags(const QString &id, const QStringList &tags)
+{
+    auto it = m_bookmarks.find(id);
+    if (it == m_bookmarks.end()) {
+        return false;
+    }
+    
+    it->tags = tags;
+    it->tags.removeDuplicates();
+    indexBookmark(*it);
+    
+    emit bookmarkUpdated(*it);
+    journalBookmark(*it);
+    return true;
+}
+
+bool BookmarkManager::setMetadata(const QString &id, const QString &key, const QVariant &value)
+{
+    auto it = m_bookmarks.find(id);
+    if (it == m_bookmarks.end()) {
+        return false;
+    }
+    
+    // Пустое значение удаляет ключ
+    if (value.isValid()) {
+        it->metadata[key] = value;
+    } else {
+        it->metadata.remove(key);
+    }
+    
+    emit bookmarkUpdated(*it);
+    journalBookmark(*it);
+    return true;
+}
+
 QString BookmarkManager::createFolder(const QString &name, const QString &parentId)
 {
     BookmarkFolder folder;
     folder.id = QUuid::createUuid().toString();
     folder.name = name;
     folder.parentId = parentId;
+    folder.position = nextFolderPosition(parentId);
     
     m_folders[folder.id] = folder;
+    m_childFolders[parentId].append(folder.id);
     emit folderCreated(folder);
-    saveBookmarks();
+    journalFolder(folder);
     
     return folder.id;
 }
@@ -169,32 +834,24 @@ bool BookmarkManager::removeFolder(const QString &id)
     }
     
     // Удаляем все закладки в папке
-    QList<QString> bookmarksToRemove;
-    for (const Bookmark &bookmark : m_bookmarks) {
-        if (bookmark.folderId == id) {
-            bookmarksToRemove.append(bookmark.id);
-        }
-    }
-    
+    const QStringList bookmarksToRemove = m_folderBookmarks.take(id);
     for (const QString &bookmarkId : bookmarksToRemove) {
-        removeBookmark(bookmarkId);
+        FaviconStore::instance()->releaseUrl(QUrl(m_bookmarks.take(bookmarkId).url));
+        unindexBookmark(bookmarkId);
+        emit bookmarkRemoved(bookmarkId);
+        journalRemoval("removeBookmark", bookmarkId);
     }
     
     // Удаляем все подпапки
-    QList<QString> foldersToRemove;
-    for (const BookmarkFolder &folder : m_folders) {
-        if (folder.parentId == id) {
-            foldersToRemove.append(folder.id);
-        }
-    }
-    
+    const QStringList foldersToRemove = m_childFolders.take(id);
     for (const QString &folderId : foldersToRemove) {
         removeFolder(folderId);
     }
     
+    unindexChild(m_childFolders, m_folders.value(id).parentId, id);
     m_folders.remove(id);
     emit folderRemoved(id);
-    saveBookmarks();
+    journalRemoval("removeFolder", id);
     
     return true;
 }
@@ -206,7 +863,7 @@ bool BookmarkManager::updateFolder(const QString &id, const QString &name)
         folder.name = name;
         
         emit folderUpdated(folder);
-        saveBookmarks();
+        journalFolder(folder);
         return true;
     }
     return false;
@@ -216,10 +873,13 @@ bool BookmarkManager::moveBookmark(const QString &id, const QString &newFolderId
 {
     if (m_bookmarks.contains(id)) {
         Bookmark &bookmark = m_bookmarks[id];
+        unindexChild(m_folderBookmarks, bookmark.folderId, id);
         bookmark.folderId = newFolderId;
+        bookmark.position = nextBookmarkPosition(newFolderId);
+        m_folderBookmarks[newFolderId].append(id);
         
         emit bookmarkMoved(bookmark);
-        saveBookmarks();
+        journalBookmark(bookmark);
         return true;
     }
     return false;
@@ -241,10 +901,13 @@ bool BookmarkManager::moveFolder(const QString &id, const QString &newParentId)
         }
         
         BookmarkFolder &folder = m_folders[id];
+        unindexChild(m_childFolders, folder.parentId, id);
         folder.parentId = newParentId;
+        folder.position = nextFolderPosition(newParentId);
+        m_childFolders[newParentId].append(id);
         
         emit folderMoved(folder);
-        saveBookmarks();
+        journalFolder(folder);
         return true;
     }
     return false;
@@ -255,6 +918,16 @@ Bookmark BookmarkManager::getBookmark(const QString &id) const
     return m_bookmarks.value(id);
 }
 
+QIcon BookmarkManager::getBookmarkIcon(const QString &id) const
+{
+    // Иконки общие для всех закладок сайта и хранятся в FaviconStore
+    auto it = m_bookmarks.constFind(id);
+    if (it == m_bookmarks.constEnd()) {
+        return QIcon();
+    }
+    return FaviconStore::instance()->iconForUrl(QUrl(it->url));
+}
+
 BookmarkFolder BookmarkManager::getFolder(const QString &id) const
 {
     return m_folders.value(id);
@@ -263,10 +936,10 @@ BookmarkFolder BookmarkManager::getFolder(const QString &id) const
 QList<Bookmark> BookmarkManager::getBookmarksInFolder(const QString &folderId) const
 {
     QList<Bookmark> result;
-    for (const Bookmark &bookmark : m_bookmarks) {
-        if (bookmark.folderId == folderId) {
-            result.append(bookmark);
-        }
+    const QStringList children = m_folderBookmarks.value(folderId);
+    result.reserve(children.size());
+    for (const QString &id : children) {
+        result.append(m_bookmarks.value(id));
     }
     return result;
 }
@@ -274,10 +947,10 @@ QList<Bookmark> BookmarkManager::getBookmarksInFolder(const QString &folderId) c
 QList<BookmarkFolder> BookmarkManager::getSubfolders(const QString &parentId) const
 {
     QList<BookmarkFolder> result;
-    for (const BookmarkFolder &folder : m_folders) {
-        if (folder.parentId == parentId) {
-            result.append(folder);
-        }
+    const QStringList children = m_childFolders.value(parentId);
+    result.reserve(children.size());
+    for (const QString &id : children) {
+        result.append(m_folders.value(id));
     }
     return result;
 }
@@ -285,26 +958,289 @@ QList<BookmarkFolder> BookmarkManager::getSubfolders(const QString &parentId) co
 QList<Bookmark> BookmarkManager::searchBookmarks(const QString &query) const
 {
     QList<Bookmark> result;
-    QString lowerQuery = query.toLower();
     
-    for (const Bookmark &bookmark : m_bookmarks) {
-        if (bookmark.title.toLower().contains(lowerQuery) ||
-            bookmark.url.toLower().contains(lowerQuery)) {
-            result.append(bookmark);
+    const QSet<QString> ids = m_searchIndex.find(query);
+    result.reserve(ids.size());
+    for (const QString &id : ids) {
+        result.append(m_bookmarks.value(id));
+    }
+    
+    // Сначала часто и недавно посещаемые
+    std::sort(result.begin(), result.end(), [](const Bookmark &a, const Bookmark &b) {
+        if (a.visitCount != b.visitCount) {
+            return a.visitCount > b.visitCount;
         }
+        return a.lastVisited > b.lastVisited;
+    });
+    return result;
+}
+
+QList<Bookmark> BookmarkManager::getSimilarBookmarks(const QString &id) const
+{
+    QList<Bookmark> result;
+    const QList<QPair<QString, double>> similar = m_similarityIndex.similar(id, MAX_SIMILAR_BOOKMARKS);
+    result.reserve(similar.size());
+    for (const QPair<QString, double> &match : similar) {
+        result.append(m_bookmarks.value(match.first));
     }
     return result;
 }
 
-void BookmarkManager::importBookmarks(const QString &path)
+QStringList BookmarkManager::getSuggestedTags(const QString &id) const
 {
-    // TODO: Реализовать импорт закладок из HTML или JSON
+    auto it = m_bookmarks.constFind(id);
+    if (it == m_bookmarks.constEnd()) {
+        return QStringList();
+    }
+    
+    // Теги похожих закладок голосуют с весом, равным сходству
+    QHash<QString, double> scores;
+    const QList<QPair<QString, double>> similar = m_similarityIndex.similar(id, MAX_SIMILAR_BOOKMARKS);
+    for (const QPair<QString, double> &match : similar) {
+        for (const QString &tag : m_bookmarks.value(match.first).tags) {
+            if (!it->tags.contains(tag, Qt::CaseInsensitive)) {
+                scores[tag] += match.second;
+            }
+        }
+    }
+    
+    QStringList result = scores.keys();
+    std::sort(result.begin(), result.end(), [&scores](const QString &a, const QString &b) {
+        return scores.value(a) > scores.value(b);
+    });
+    return result.mid(0, MAX_SUGGESTED_TAGS);
+}
+
+QString BookmarkManager::normalizeUrl(const QString &url) const
+{
+    const QUrl parsed = QUrl::fromUserInput(url);
+    if (!parsed.isValid()) {
+        return url;
+    }
+    return parsed.adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash)
+                 .toString(QUrl::FullyEncoded);
+}
+
+bool BookmarkManager::importBookmarks(const QString &path, const QString &format)
+{
+    // "json" подходит и для файла Chromium, и для нашего экспорта - их различает detectFormat
+    BookmarkImporter::Format importFormat = BookmarkImporter::UnknownFormat;
+    if (format == "html") {
+        importFormat = BookmarkImporter::NetscapeHtml;
+    } else if (format == "chrome" || format == "chromium") {
+        importFormat = BookmarkImporter::ChromiumJson;
+    } else if (format == "firefox") {
+        importFormat = BookmarkImporter::FirefoxPlaces;
+    }
+    
+    return runImport(path, importFormat, tr("Импортированные"));
+}
+
+bool BookmarkManager::importFromBrowser(const QString &browserName)
+{
+    const QString path = BookmarkImporter::profileBookmarksPath(browserName);
+    if (path.isEmpty()) {
+        return false;
+    }
+    return runImport(path, BookmarkImporter::UnknownFormat, tr("Импорт из %1").arg(browserName));
+}
+
+bool BookmarkManager::runImport(const QString &path, BookmarkImporter::Format format,
+                                const QString &folderName)
+{
+    ImportSession session;
+    session.rootId = createFolder(folderName, "root");
+    session.folderIds.insert(BookmarkImporter::ROOT_KEY, session.rootId);
+    session.imported = 0;
+    
+    // Уже имеющиеся адреса не дублируем
+    session.knownUrls.reserve(m_bookmarks.size());
+    for (const Bookmark &bookmark : std::as_const(m_bookmarks)) {
+        session.knownUrls.insert(normalizeUrl(bookmark.url));
+    }
+    
+    BookmarkImporter importer;
+    connect(&importer, &BookmarkImporter::batchReady, this,
+            [this, &session](const QList<ImportedFolder> &folders,
+                             const QList<ImportedBookmark> &bookmarks) {
+        applyImportBatch(session, folders, bookmarks);
+    });
+    connect(&importer, &BookmarkImporter::progress, this, &BookmarkManager::importProgress);
+    
+    if (!importer.importFile(path, format)) {
+        // Откатываем уже применённые пачки вместе с папкой импорта
+        removeFolder(session.rootId);
+        emit databaseError(importer.errorString());
+        return false;
+    }
+    
+    emit importCompleted(session.imported);
+    return true;
+}
+
+QString BookmarkManager::importFolder(ImportSession &session, int key)
+{
+    auto it = session.folderIds.constFind(key);
+    if (it != session.folderIds.constEnd()) {
+        return it.value();
+    }
+    
+    // Потомок встретился раньше папки: заводим её в корне импорта,
+    // имя и родитель придут вместе с записью самой папки
+    BookmarkFolder folder;
+    folder.id = QUuid::createUuid().toString();
+    folder.parentId = session.rootId;
+    folder.position = nextFolderPosition(session.rootId);
+    
+    m_folders[folder.id] = folder;
+    m_childFolders[folder.parentId].append(folder.id);
+    session.folderIds.insert(key, folder.id);
+    return folder.id;
+}
+
+void BookmarkManager::applyImportBatch(ImportSession &session,
+                                       const QList<ImportedFolder> &folders,
+                                       const QList<ImportedBookmark> &bookmarks)
+{
+    // Сигналы на каждый элемент не отправляются: после импорта
+    // слушатели перечитывают дерево по importCompleted
+    m_journalBatching = true;
+    
+    for (const ImportedFolder &imported : folders) {
+        const QString id = importFolder(session, imported.key);
+        const QString parentId = importFolder(session, imported.parentKey);
+        
+        BookmarkFolder &folder = m_folders[id];
+        folder.name = imported.name;
+        if (folder.parentId != parentId && parentId != id) {
+            unindexChild(m_childFolders, folder.parentId, id);
+            folder.parentId = parentId;
+            folder.position = nextFolderPosition(parentId);
+            m_childFolders[parentId].append(id);
+        }
+        journalFolder(folder);
+    }
+    
+    for (const ImportedBookmark &imported : bookmarks) {
+        const QString key = normalizeUrl(imported.url);
+        if (session.knownUrls.contains(key)) {
+            continue;
+        }
+        session.knownUrls.insert(key);
+        
+        Bookmark bookmark;
+        bookmark.id = QUuid::createUuid().toString();
+        bookmark.url = imported.url;
+        bookmark.title = imported.title.isEmpty() ? imported.url : imported.title;
+        bookmark.folderId = importFolder(session, imported.folderKey);
+        bookmark.position = nextBookmarkPosition(bookmark.folderId);
+        bookmark.visitCount = 0;
+        bookmark.addedDate = imported.addedDate.isValid() ? imported.addedDate
+                                                          : QDateTime::currentDateTime();
+        bookmark.lastVisited = bookmark.addedDate;
+        
+        m_bookmarks[bookmark.id] = bookmark;
+        m_folderBookmarks[bookmark.folderId].append(bookmark.id);
+        indexBookmark(bookmark);
+        journalBookmark(bookmark);
+        ++session.imported;
+    }
+    
+    m_journalBatching = false;
+    flushJournal();
 }
 
 bool BookmarkManager::exportBookmarks(const QString &path)
 {
-    // TODO: Реализовать экспорт закладок в HTML или JSON
-    return false;
+    // Для обмена с другими программами используется JSON
+    if (!writeJsonBookmarks(path, m_folders, m_bookmarks)) {
+        return false;
+    }
+    
+    emit exportCompleted(m_bookmarks.size());
+    return true;
+}
+
+bool BookmarkManager::validateUrls(bool fix)
+{
+    if (m_linkChecker->isRunning()) {
+        return false;
+    }
+    
+    m_fixRedirects = fix;
+    m_linkCheckCount = 0;
+    m_brokenLinkCount = 0;
+    
+    // Проверяем только то, что не проверялось последние LINK_RECHECK_AGE
+    const qint64 staleBefore = QDateTime::currentMSecsSinceEpoch() - LINK_RECHECK_AGE;
+    int queued = 0;
+    for (const Bookmark &bookmark : std::as_const(m_bookmarks)) {
+        if (bookmark.metadata.value("linkCheckedAt").toLongLong() > staleBefore) {
+            continue;
+        }
+        const QUrl url(bookmark.url);
+        if (url.scheme() != "http" && url.scheme() != "https") {
+            continue;
+        }
+        m_linkChecker->enqueue(bookmark.id, url);
+        ++queued;
+    }
+    
+    return queued > 0;
+}
+
+void BookmarkManager::checkUrls()
+{
+    validateUrls(false);
+}
+
+void BookmarkManager::setPeriodicLinkCheck(bool enabled)
+{
+    // Раз в сутки перепроверяем ссылки, проверенные давно
+    if (enabled) {
+        m_linkCheckTimer->start(LINK_CHECK_INTERVAL);
+    } else {
+        m_linkCheckTimer->stop();
+    }
+}
+
+bool BookmarkManager::isPeriodicLinkCheckEnabled() const
+{
+    return m_linkCheckTimer->isActive();
+}
+
+void BookmarkManager::handleLinkChecked(const LinkCheckResult &result)
+{
+    auto it = m_bookmarks.find(result.id);
+    if (it == m_bookmarks.end() || it->url != result.url.toString()) {
+        return; // Закладку удалили или изменили во время проверки
+    }
+    
+    Bookmark &bookmark = *it;
+    bookmark.metadata["linkStatus"] = result.httpStatus;
+    bookmark.metadata["linkCheckedAt"] = QDateTime::currentMSecsSinceEpoch();
+    bookmark.metadata["linkBroken"] = result.isBroken();
+    if (result.errorString.isEmpty()) {
+        bookmark.metadata.remove("linkError");
+    } else {
+        bookmark.metadata["linkError"] = result.errorString;
+    }
+    
+    ++m_linkCheckCount;
+    if (result.isBroken()) {
+        ++m_brokenLinkCount;
+    }
+    
+    // Постоянный редирект: с fix адрес закладки заменяется новым
+    if (m_fixRedirects && result.permanentRedirect && result.redirectTarget.isValid()) {
+        bookmark.url = result.redirectTarget.toString();
+        bookmark.metadata.remove("linkCheckedAt");
+        indexBookmark(bookmark);
+        emit bookmarkUpdated(bookmark);
+    }
+    
+    journalBookmark(bookmark);
+    emit linkChecked(bookmark.id, result.httpStatus);
 }
 
 void BookmarkManager::updateIcon(const QString &id, const QString &iconUrl)
@@ -313,7 +1249,7 @@ void BookmarkManager::updateIcon(const QString &id, const QString &iconUrl)
         Bookmark &bookmark = m_bookmarks[id];
         bookmark.icon = iconUrl;
         emit bookmarkUpdated(bookmark);
-        saveBookmarks();
+        journalBookmark(bookmark);
     }
 }
 
@@ -322,7 +1258,8 @@ void BookmarkManager::updateLastVisited(const QString &id)
     if (m_bookmarks.contains(id)) {
         Bookmark &bookmark = m_bookmarks[id];
         bookmark.lastVisited = QDateTime::currentDateTime();
+        bookmark.visitCount++;
         emit bookmarkUpdated(bookmark);
-        saveBookmarks();
+        journalBookmark(bookmark);
     }
 } 
\ No newline at end of file
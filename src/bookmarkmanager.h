@@ -6,23 +6,36 @@
 #include <QUrl>
 #include <QIcon>
 #include <QJsonDocument>
-#include <QSqlDatabase>
+#include <QFile>
+#include <QFuture>
+#include <QJsonObject>
+#include <QCborStreamReader>
+#include "bookmarkindex.h"
+#include "bookmarkimporter.h"
+#include "linkchecker.h"
+#include "similarityindex.h"
 
-struct BookmarkItem {
-    qint64 id;
+class QTimer;
+
+struct BookmarkFolder {
+    QString id;
+    QString name;
+    QString parentId;
+    int position = 0; // порядок среди подпапок родителя
+};
+
+struct Bookmark {
+    QString id;
     QString url;
     QString title;
-    QString description;
-    QIcon favicon;
-    QDateTime added;
-    QDateTime lastVisited;
-    int visitCount;
+    QString folderId;
+    int position = 0; // порядок среди закладок папки
+    QString icon;
     QStringList tags;
-    QString folder;
-    int position;
-    bool isFolder;
-    QList<qint64> children;
-    QHash<QString, QVariant> metadata;
+    int visitCount = 0;
+    QDateTime addedDate;
+    QDateTime lastVisited;
+    QVariantHash metadata; // состояние проверки ссылки и прочее
 };
 
 class BookmarkManager : public QObject
@@ -34,94 +47,147 @@ public:
     ~BookmarkManager();
 
     // Основные операции с закладками
-    qint64 addBookmark(const QString &url, const QString &title, 
-                      const QString &folder = "root");
-    bool removeBookmark(qint64 id);
-    bool updateBookmark(qint64 id, const QHash<QString, QVariant> &properties);
-    BookmarkItem getBookmark(qint64 id) const;
+    QString addBookmark(const QString &url, const QString &title,
+                        const QString &folderId = "root");
+    bool removeBookmark(const QString &id);
+    bool updateBookmark(const QString &id, const QString &url, const QString &title);
+    bool setTags(const QString &id, const QStringList &tags);
+    bool setMetadata(const QString &id, const QString &key, const QVariant &value);
+    Bookmark getBookmark(const QString &id) const;
+    QIcon getBookmarkIcon(const QString &id) const;
+    void updateIcon(const QString &id, const QString &iconUrl);
+    void updateLastVisited(const QString &id);
     
     // Работа с папками
-    qint64 createFolder(const QString &name, const QString &parentFolder = "root");
-    bool removeFolder(qint64 id, bool removeContents = false);
-    bool moveBookmark(qint64 id, const QString &newFolder);
-    bool reorderBookmarks(const QString &folder, const QList<qint64> &newOrder);
+    QString createFolder(const QString &name, const QString &parentId = "root");
+    bool removeFolder(const QString &id);
+    bool updateFolder(const QString &id, const QString &name);
+    bool moveBookmark(const QString &id, const QString &newFolderId);
+    bool moveFolder(const QString &id, const QString &newParentId);
+    BookmarkFolder getFolder(const QString &id) const;
     
-    // Поиск и фильтрация
-    QList<BookmarkItem> searchBookmarks(const QString &query) const;
-    QList<BookmarkItem> getBookmarksByTag(const QString &tag) const;
-    QList<BookmarkItem> getBookmarksByFolder(const QString &folder) const;
-    QList<BookmarkItem> getRecentBookmarks(int limit = 10) const;
-    QList<BookmarkItem> getMostVisited(int limit = 10) const;
+    // Содержимое папок в порядке position
+    QList<Bookmark> getBookmarksInFolder(const QString &folderId) const;
+    QList<BookmarkFolder> getSubfolders(const QString &parentId) const;
     
-    // Теги и метаданные
-    bool addTag(qint64 id, const QString &tag);
-    bool removeTag(qint64 id, const QString &tag);
-    QStringList getAllTags() const;
-    bool setMetadata(qint64 id, const QString &key, const QVariant &value);
-    QVariant getMetadata(qint64 id, const QString &key) const;
+    // Поиск и рекомендации
+    QList<Bookmark> searchBookmarks(const QString &query) const;
+    QList<Bookmark> getSimilarBookmarks(const QString &id) const;
+    QStringList getSuggestedTags(const QString &id) const;
     
     // Импорт/Экспорт
-    bool exportBookmarks(const QString &filename, const QString &format = "json") const;
-    bool importBookmarks(const QString &filename, const QString &format = "json");
+    bool importBookmarks(const QString &path, const QString &format = "auto");
     bool importFromBrowser(const QString &browserName);
+    bool exportBookmarks(const QString &path);
     
-    // Синхронизация
-    bool syncWithCloud(const QString &account);
-    QDateTime getLastSyncTime() const;
-    bool enableAutoSync(bool enable);
-    
-    // Анализ и рекомендации
-    QList<BookmarkItem> getSimilarBookmarks(qint64 id) const;
-    QList<QString> getSuggestedTags(qint64 id) const;
-    QStringList getPopularDomains() const;
-    
-    // Управление
-    void vacuum();
-    void backup();
-    bool restore(const QString &backupFile);
+    // Проверка ссылок: только по действию или настройке пользователя
     bool validateUrls(bool fix = false);
+    void checkUrls();
+    void setPeriodicLinkCheck(bool enabled);
+    bool isPeriodicLinkCheckEnabled() const;
 
 signals:
-    void bookmarkAdded(const BookmarkItem &item);
-    void bookmarkRemoved(qint64 id);
-    void bookmarkUpdated(const BookmarkItem &item);
-    void folderCreated(qint64 id, const QString &name);
-    void folderRemoved(qint64 id);
-    void bookmarkMoved(qint64 id, const QString &newFolder);
-    void bookmarksReordered(const QString &folder);
-    void tagsChanged(qint64 id);
-    void metadataChanged(qint64 id, const QString &key);
-    void syncCompleted(bool success);
+    void bookmarkAdded(const Bookmark &bookmark);
+    void bookmarkRemoved(const QString &id);
+    void bookmarkUpdated(const Bookmark &bookmark);
+    void bookmarkMoved(const Bookmark &bookmark);
+    void folderCreated(const BookmarkFolder &folder);
+    void folderUpdated(const BookmarkFolder &folder);
+    void folderMoved(const BookmarkFolder &folder);
+    void folderRemoved(const QString &id);
+    void linkChecked(const QString &id, int httpStatus);
+    void linkCheckFinished(int checked, int broken);
+    void importProgress(qint64 processed, qint64 total);
     void importCompleted(int count);
     void exportCompleted(int count);
     void databaseError(const QString &error);
 
 private slots:
-    void handleDatabaseError(const QString &error);
-    void performAutoSync();
-    void checkUrls();
+    void handleLinkChecked(const LinkCheckResult &result);
 
 private:
-    bool initDatabase();
-    bool upgradeDatabase(int oldVersion, int newVersion);
-    void createDefaultFolders();
     QString normalizeUrl(const QString &url) const;
-    bool isUrlValid(const QString &url) const;
-    void updateVisitCount(qint64 id);
-    QJsonDocument bookmarksToJson() const;
-    bool jsonToBookmarks(const QJsonDocument &doc);
-    void indexBookmarkContent();
-    void cleanupOrphanedRecords();
     
-    QSqlDatabase m_db;
-    QDateTime m_lastSync;
-    bool m_autoSyncEnabled;
-    QHash<QString, qint64> m_folderCache;
-    QHash<QString, QIcon> m_faviconCache;
+    // Журнал изменений и снимки
+    void loadBookmarks();
+    void saveBookmarks();
+    void openJournal();
+    void replayJournal(const QString &filePath);
+    void appendJournal(const QJsonObject &record);
+    void journalBookmark(const Bookmark &bookmark);
+    void journalFolder(const BookmarkFolder &folder);
+    void journalRemoval(const QString &op, const QString &id);
+    void flushJournal();
+    void compactJournal();
+    static bool writeSnapshot(const QString &filePath,
+                              const QHash<QString, BookmarkFolder> &folders,
+                              const QHash<QString, Bookmark> &bookmarks);
+    bool readSnapshot(const QString &filePath);
+    static QString readCborString(QCborStreamReader &reader);
+    static qint64 readCborInteger(QCborStreamReader &reader);
+    bool readJsonBookmarks(const QString &filePath);
+    void retireJsonBookmarks();
+    static bool writeJsonBookmarks(const QString &filePath,
+                                   const QHash<QString, BookmarkFolder> &folders,
+                                   const QHash<QString, Bookmark> &bookmarks);
+    static QJsonObject bookmarkToJson(const Bookmark &bookmark);
+    static Bookmark bookmarkFromJson(const QJsonObject &bookmarkObj);
+    static QJsonObject folderToJson(const BookmarkFolder &folder);
+    static BookmarkFolder folderFromJson(const QJsonObject &folderObj);
+    
+    // Индекс дочерних элементов папок
+    void rebuildChildrenIndex();
+    static void unindexChild(QHash<QString, QStringList> &index,
+                             const QString &parentId, const QString &id);
+    int nextBookmarkPosition(const QString &folderId) const;
+    int nextFolderPosition(const QString &parentId) const;
+    void rebuildSearchIndex();
+    void indexBookmark(const Bookmark &bookmark);
+    void unindexBookmark(const QString &id);
+    
+    // Импорт
+    struct ImportSession {
+        QString rootId;
+        QHash<int, QString> folderIds; // ключ импортёра -> id папки
+        QSet<QString> knownUrls;
+        int imported;
+    };
+    bool runImport(const QString &path, BookmarkImporter::Format format,
+                   const QString &folderName);
+    QString importFolder(ImportSession &session, int key);
+    void applyImportBatch(ImportSession &session,
+                          const QList<ImportedFolder> &folders,
+                          const QList<ImportedBookmark> &bookmarks);
+    
+    QHash<QString, BookmarkFolder> m_folders;
+    QHash<QString, Bookmark> m_bookmarks;
+    QHash<QString, QStringList> m_folderBookmarks; // папка -> закладки по position
+    QHash<QString, QStringList> m_childFolders;    // папка -> подпапки по position
+    BookmarkIndex m_searchIndex;
+    SimilarityIndex m_similarityIndex;
+    QString m_dataPath;
+    QFile m_journal;
+    QFuture<bool> m_compaction;
+    bool m_compacting;
+    bool m_journalBatching;
+    LinkChecker *m_linkChecker;
+    QTimer *m_linkCheckTimer;
+    bool m_fixRedirects;
+    int m_linkCheckCount;
+    int m_brokenLinkCount;
     
-    static const int DATABASE_VERSION = 2;
-    static const QString DATABASE_NAME;
-    static const QStringList DEFAULT_FOLDERS;
+    static const QString BOOKMARKS_FILE;
+    static const QString BOOKMARKS_BACKUP_FILE;
+    static const QString SNAPSHOT_FILE;
+    static const QString SNAPSHOT_MAGIC;
+    static const int SNAPSHOT_VERSION = 2;
+    static const QString JOURNAL_FILE;
+    static const QString COMPACTING_JOURNAL_FILE;
+    static const qint64 JOURNAL_COMPACT_THRESHOLD = 512 * 1024;
+    static const qint64 LINK_RECHECK_AGE = 7LL * 24 * 60 * 60 * 1000; // мс
+    static const int MAX_SIMILAR_BOOKMARKS = 20;
+    static const int MAX_SUGGESTED_TAGS = 5;
+    static const int LINK_CHECK_INTERVAL = 24 * 60 * 60 * 1000;       // мс
 };
 
 #endif // BOOKMARKMANAGER_H 
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "breachcorpus.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QtEndian>
+#include <cstring>
+
+const QByteArray BreachCorpus::MAGIC = "BRPW";
+
+namespace {
+
+// Строка "HEX:COUNT"; hex-часть дописывается к prefix до полного хэша
+bool parseLine(const QByteArray &prefix, QByteArray line, uchar *record)
+{
+    line = line.trimmed();
+    const int colon = line.indexOf(':');
+    if (colon < 0 || prefix.size() + colon != BreachCorpus::HASH_SIZE * 2) {
+        return false;
+    }
+    
+    const QByteArray hex = prefix + line.left(colon);
+    for (int i = 0; i < BreachCorpus::HASH_SIZE; ++i) {
+        bool ok = false;
+        const uint byte = hex.mid(i * 2, 2).toUInt(&ok, 16);
+        if (!ok) {
+            return false;
+        }
+        record[i] = static_cast<uchar>(byte);
+    }
+    
+    bool ok = false;
+    const qulonglong count = line.mid(colon + 1).toULongLong(&ok);
+    if (!ok) {
+        return false;
+    }
+    qToLittleEndian<quint32>(static_cast<quint32>(qMin<qulonglong>(count, 0xFFFFFFFFu)),
+                             record + BreachCorpus::HASH_SIZE);
+    return true;
+}
+
+class CorpusWriter
+{
+public:
+    explicit CorpusWriter(const QString &fileName)
+        : m_file(fileName), m_count(0)
+    {
+        memset(m_last, 0, sizeof(m_last));
+    }
+    
+    bool open(const QByteArray &magic, quint32 version)
+    {
+        if (!m_file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+        // Число записей дописывается в заголовок в конце
+        uchar header[BreachCorpus::HEADER_SIZE] = {};
+        memcpy(header, magic.constData(), 4);
+        qToLittleEndian<quint32>(version, header + 4);
+        return m_file.write(reinterpret_cast<const char *>(header), sizeof(header)) == sizeof(header);
+    }
+    
+    bool readFile(const QString &fileName, const QByteArray &prefix)
+    {
+        QFile source(fileName);
+        if (!source.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        
+        uchar record[BreachCorpus::RECORD_SIZE];
+        while (!source.atEnd()) {
+            const QByteArray line = source.readLine();
+            if (line.trimmed().isEmpty()) {
+                continue;
+            }
+            if (!parseLine(prefix, line, record) || !append(record)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    
+    bool commit()
+    {
+        uchar count[8];
+        qToLittleEndian<quint64>(m_count, count);
+        if (!m_file.seek(8) || m_file.write(reinterpret_cast<const char *>(count), 8) != 8) {
+            m_file.cancelWriting();
+            return false;
+        }
+        return m_file.commit();
+    }
+    
+    void cancel() { m_file.cancelWriting(); }
+
+private:
+    bool append(const uchar *record)
+    {
+        // Поиск рассчитан на строгий порядок; дубликаты и беспорядок - ошибка
+        if (m_count > 0 && memcmp(record, m_last, BreachCorpus::HASH_SIZE) <= 0) {
+            return false;
+        }
+        memcpy(m_last, record, BreachCorpus::HASH_SIZE);
+        ++m_count;
+        return m_file.write(reinterpret_cast<const char *>(record), BreachCorpus::RECORD_SIZE)
+            == BreachCorpus::RECORD_SIZE;
+    }
+    
+    QSaveFile m_file;
+    uchar m_last[BreachCorpus::HASH_SIZE];
+    quint64 m_count;
+};
+
+}
+
+BreachCorpus::BreachCorpus()
+    : m_map(nullptr)
+    , m_records(nullptr)
+    , m_count(0)
+{
+}
+
+BreachCorpus::~BreachCorpus()
+{
+    close();
+}
+
+bool BreachCorpus::open(const QString &fileName)
+{
+    close();
+    
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HEADER_SIZE) {
+        close();
+        return false;
+    }
+    
+    // Страницы подгружаются системой по мере обращения
+    m_map = m_file.map(0, m_file.size());
+    if (!m_map || memcmp(m_map, MAGIC.constData(), 4) != 0 ||
+        qFromLittleEndian<quint32>(m_map + 4) != VERSION) {
+        close();
+        return false;
+    }
+    
+    const quint64 count = qFromLittleEndian<quint64>(m_map + 8);
+    if (count > quint64(m_file.size() - HEADER_SIZE) / RECORD_SIZE) {
+        close();
+        return false;
+    }
+    
+    m_count = count;
+    m_records = m_map + HEADER_SIZE;
+    return true;
+}
+
+void BreachCorpus::close()
+{
+    if (m_map) {
+        m_file.unmap(const_cast<uchar *>(m_map));
+    }
+    m_file.close();
+    m_map = nullptr;
+    m_records = nullptr;
+    m_count = 0;
+}
+
+quint32 BreachCorpus::lookup(const char *password, int size) const
+{
+    if (!isOpen()) {
+        return 0;
+    }
+    return lookupHash(QCryptographicHash::hash(QByteArray::fromRawData(password, size),
+                                               QCryptographicHash::Sha1));
+}
+
+quint64 BreachCorpus::keyAt(quint64 index) const
+{
+    return qFromBigEndian<quint64>(m_records + index * RECORD_SIZE);
+}
+
+quint32 BreachCorpus::lookupHash(const QByteArray &sha1) const
+{
+    if (!isOpen() || m_count == 0 || sha1.size() != HASH_SIZE) {
+        return 0;
+    }
+    
+    const uchar *target = reinterpret_cast<const uchar *>(sha1.constData());
+    const quint64 key = qFromBigEndian<quint64>(target);
+    quint64 low = 0;
+    quint64 high = m_count - 1;
+    
+    // SHA-1 распределены равномерно: по первым 8 байтам позиция угадывается
+    // за несколько шагов, каждый из которых затрагивает одну страницу
+    for (int step = 0; step < INTERPOLATION_STEPS && high - low > LINEAR_WINDOW; ++step) {
+        const quint64 lowKey = keyAt(low);
+        const quint64 highKey = keyAt(high);
+        if (key < lowKey || key > highKey) {
+            return 0;
+        }
+        if (highKey == lowKey) {
+            break;
+        }
+        
+        const long double fraction = static_cast<long double>(key - lowKey) / (highKey - lowKey);
+        const quint64 probe = low + static_cast<quint64>(fraction * (high - low));
+        const int cmp = memcmp(m_records + probe * RECORD_SIZE, target, HASH_SIZE);
+        if (cmp == 0) {
+            return qFromLittleEndian<quint32>(m_records + probe * RECORD_SIZE + HASH_SIZE);
+        }
+        if (cmp < 0) {
+            low = probe + 1;
+        } else {
+            if (probe == 0) {
+                return 0;
+            }
+            high = probe - 1;
+        }
+        if (low > high) {
+            return 0;
+        }
+    }
+    
+    // Оставшийся диапазон - обычный двоичный поиск
+    quint64 first = low;
+    quint64 last = high + 1;
+    while (first < last) {
+        const quint64 middle = first + (last - first) / 2;
+        const int cmp = memcmp(m_records + middle * RECORD_SIZE, target, HASH_SIZE);
+        if (cmp == 0) {
+            return qFromLittleEndian<quint32>(m_records + middle * RECORD_SIZE + HASH_SIZE);
+        }
+        if (cmp < 0) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return 0;
+}
+
+bool BreachCorpus::convert(const QString &source, const QString &target)
+{
+    CorpusWriter writer(target);
+    if (!writer.open(MAGIC, VERSION)) {
+        return false;
+    }
+    
+    const QFileInfo info(source);
+    if (info.isDir()) {
+        // Файлы диапазонов: имя - первые 5 hex-символов хэша; верхний
+        // регистр, чтобы порядок имён совпадал с порядком хэшей
+        QDir dir(source);
+        QMap<QString, QString> ranges;
+        const QFileInfoList files = dir.entryInfoList(QDir::Files);
+        for (const QFileInfo &file : files) {
+            const QString prefix = file.completeBaseName().toUpper();
+            bool ok = false;
+            prefix.toUInt(&ok, 16);
+            if (ok && prefix.size() == PREFIX_LENGTH) {
+                ranges.insert(prefix, file.filePath());
+            }
+        }
+        
+        for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+            if (!writer.readFile(it.value(), it.key().toLatin1())) {
+                writer.cancel();
+                return false;
+            }
+        }
+    } else if (!writer.readFile(source, QByteArray())) {
+        writer.cancel();
+        return false;
+    }
+    
+    return writer.commit();
+}
@@ -0,0 +1,57 @@
+#ifndef BREACHCORPUS_H
+#define BREACHCORPUS_H
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+
+// Локальная база утёкших паролей: отсортированные SHA-1 хэши с числом
+// появлений в утечках. Файл отображается в память и не читается целиком,
+// поиск - интерполяционный с переходом на двоичный.
+//
+// Формат файла: заголовок (магия, версия, число записей), затем записи
+// по 24 байта: SHA-1 (20 байт) и счётчик (uint32, little-endian).
+class BreachCorpus
+{
+public:
+    BreachCorpus();
+    ~BreachCorpus();
+    BreachCorpus(const BreachCorpus &) = delete;
+    BreachCorpus &operator=(const BreachCorpus &) = delete;
+    
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return m_records != nullptr; }
+    QString fileName() const { return m_file.fileName(); }
+    quint64 size() const { return m_count; }
+    
+    // Число появлений пароля в утечках, 0 - не найден.
+    // Можно вызывать из нескольких потоков одновременно.
+    quint32 lookup(const char *password, int size) const;
+    quint32 lookupHash(const QByteArray &sha1) const;
+    
+    // Преобразование выгрузки в формате k-anonymity (каталог файлов
+    // PREFIX.txt со строками SUFFIX:COUNT) или полного списка HASH:COUNT,
+    // отсортированного по хэшу
+    static bool convert(const QString &source, const QString &target);
+    
+    static const int HASH_SIZE = 20;
+    static const int RECORD_SIZE = HASH_SIZE + 4;
+    static const int HEADER_SIZE = 16;
+    static const int PREFIX_LENGTH = 5;
+
+private:
+    quint64 keyAt(quint64 index) const;
+    
+    QFile m_file;
+    const uchar *m_map;
+    const uchar *m_records;
+    quint64 m_count;
+    
+    static const QByteArray MAGIC;
+    static const quint32 VERSION = 1;
+    static const int INTERPOLATION_STEPS = 8;
+    static const int LINEAR_WINDOW = 32;
+};
+
+#endif // BREACHCORPUS_H
@@ -0,0 +1,194 @@
+#include "certificateindex.h"
+#include <QCryptographicHash>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <memory>
+
+namespace {
+
+struct X509Deleter {
+    void operator()(X509 *certificate) const { X509_free(certificate); }
+};
+using X509Ptr = std::unique_ptr<X509, X509Deleter>;
+
+X509Ptr parseCertificate(const QSslCertificate &certificate)
+{
+    const QByteArray der = certificate.toDer();
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(der.constData());
+    return X509Ptr(d2i_X509(nullptr, &data, der.size()));
+}
+
+QByteArray nameHash(const X509_NAME *name)
+{
+    const unsigned char *der = nullptr;
+    size_t length = 0;
+    if (!name || !X509_NAME_get0_der(const_cast<X509_NAME *>(name), &der, &length)) {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(der),
+                                                            static_cast<int>(length)),
+                                    QCryptographicHash::Sha256);
+}
+
+QByteArray octets(const ASN1_OCTET_STRING *string)
+{
+    if (!string) {
+        return QByteArray();
+    }
+    return QByteArray(reinterpret_cast<const char *>(ASN1_STRING_get0_data(string)),
+                      ASN1_STRING_length(string));
+}
+
+QByteArray fingerprintOf(const QSslCertificate &certificate)
+{
+    return certificate.digest(QCryptographicHash::Sha256);
+}
+
+}
+
+CertificateKeys CertificateKeys::fromCertificate(const QSslCertificate &certificate)
+{
+    CertificateKeys keys;
+    X509Ptr x509 = parseCertificate(certificate);
+    if (!x509) {
+        return keys;
+    }
+    
+    keys.subject = nameHash(X509_get_subject_name(x509.get()));
+    keys.issuer = nameHash(X509_get_issuer_name(x509.get()));
+    keys.subjectKeyId = octets(X509_get0_subject_key_id(x509.get()));
+    keys.authorityKeyId = octets(X509_get0_authority_key_id(x509.get()));
+    keys.serialNumber = octets(X509_get0_serialNumber(x509.get()));
+    keys.isCa = X509_check_ca(x509.get()) != 0;
+    return keys;
+}
+
+void CertificateIndex::clear()
+{
+    m_entries.clear();
+    m_bySubject.clear();
+    m_byKeyId.clear();
+}
+
+void CertificateIndex::insert(const QSslCertificate &certificate)
+{
+    if (certificate.isNull()) {
+        return;
+    }
+    const QByteArray fingerprint = fingerprintOf(certificate);
+    if (!m_entries.contains(fingerprint)) {
+        insert(fingerprint, CertificateKeys::fromCertificate(certificate), certificate);
+    }
+}
+
+void CertificateIndex::insert(const QByteArray &fingerprint, const CertificateKeys &keys,
+                              const QSslCertificate &certificate)
+{
+    if (!keys.isValid() || m_entries.contains(fingerprint)) {
+        return;
+    }
+    
+    Entry entry;
+    entry.certificate = certificate;
+    entry.keys = keys;
+    
+    m_bySubject.insert(entry.keys.subject, fingerprint);
+    if (!entry.keys.subjectKeyId.isEmpty()) {
+        m_byKeyId.insert(entry.keys.subjectKeyId, fingerprint);
+    }
+    m_entries.insert(fingerprint, entry);
+}
+
+void CertificateIndex::remove(const QSslCertificate &certificate)
+{
+    remove(fingerprintOf(certificate));
+}
+
+void CertificateIndex::remove(const QByteArray &fingerprint)
+{
+    auto it = m_entries.find(fingerprint);
+    if (it == m_entries.end()) {
+        return;
+    }
+    unlink(fingerprint, it.value());
+    m_entries.erase(it);
+}
+
+void CertificateIndex::unlink(const QByteArray &fingerprint, const Entry &entry)
+{
+    m_bySubject.remove(entry.keys.subject, fingerprint);
+    if (!entry.keys.subjectKeyId.isEmpty()) {
+        m_byKeyId.remove(entry.keys.subjectKeyId, fingerprint);
+    }
+}
+
+bool CertificateIndex::contains(const QSslCertificate &certificate) const
+{
+    return m_entries.contains(fingerprintOf(certificate));
+}
+
+QList<QByteArray> CertificateIndex::findIssuerFingerprints(const CertificateKeys &keys) const
+{
+    if (!keys.isValid()) {
+        return QList<QByteArray>();
+    }
+    return findIssuerFingerprints(keys.issuer, keys.authorityKeyId);
+}
+
+QList<QByteArray> CertificateIndex::findIssuerFingerprints(const QByteArray &issuer,
+                                                           const QByteArray &authorityKeyId) const
+{
+    QList<QByteArray> issuers;
+    if (issuer.isEmpty()) {
+        return issuers;
+    }
+    
+    // AKI однозначно указывает ключ издателя; имя всё равно должно совпасть
+    if (!authorityKeyId.isEmpty()) {
+        for (auto it = m_byKeyId.constFind(authorityKeyId);
+             it != m_byKeyId.constEnd() && it.key() == authorityKeyId; ++it) {
+            if (m_entries[it.value()].keys.subject == issuer) {
+                issuers.append(it.value());
+            }
+        }
+        if (!issuers.isEmpty()) {
+            return issuers;
+        }
+    }
+    
+    // Без AKI (или с ключом, которого нет в индексе) - все CA с таким именем
+    for (auto it = m_bySubject.constFind(issuer);
+         it != m_bySubject.constEnd() && it.key() == issuer; ++it) {
+        issuers.append(it.value());
+    }
+    return issuers;
+}
+
+QList<QSslCertificate> CertificateIndex::findIssuers(const CertificateKeys &keys) const
+{
+    QList<QSslCertificate> issuers;
+    const QList<QByteArray> fingerprints = findIssuerFingerprints(keys);
+    for (const QByteArray &fingerprint : fingerprints) {
+        const QSslCertificate &certificate = m_entries[fingerprint].certificate;
+        if (!certificate.isNull()) {
+            issuers.append(certificate);
+        }
+    }
+    return issuers;
+}
+
+bool CertificateIndex::isIssuedBy(const QSslCertificate &certificate, const QSslCertificate &issuer)
+{
+    X509Ptr subject = parseCertificate(certificate);
+    X509Ptr signer = parseCertificate(issuer);
+    if (!subject || !signer) {
+        return false;
+    }
+    
+    if (X509_NAME_cmp(X509_get_issuer_name(subject.get()), X509_get_subject_name(signer.get())) != 0) {
+        return false;
+    }
+    
+    EVP_PKEY *key = X509_get0_pubkey(signer.get());
+    return key && X509_verify(subject.get(), key) == 1;
+}
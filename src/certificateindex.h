@@ -0,0 +1,66 @@
+#ifndef CERTIFICATEINDEX_H
+#define CERTIFICATEINDEX_H
+
+#include <QSslCertificate>
+#include <QHash>
+#include <QMultiHash>
+#include <QByteArray>
+
+// Ключи для поиска издателя: хэши DER-кодировки имён (а не отображаемых
+// строк, которые у разных CA могут совпадать) и идентификаторы ключей
+struct CertificateKeys {
+    QByteArray subject;          // SHA-256 имени субъекта
+    QByteArray issuer;           // SHA-256 имени издателя
+    QByteArray subjectKeyId;     // SKI
+    QByteArray authorityKeyId;   // AKI
+    QByteArray serialNumber;     // содержимое INTEGER серийного номера
+    bool isCa = false;
+    
+    bool isValid() const { return !subject.isEmpty(); }
+    bool isSelfIssued() const { return subject == issuer; }
+    
+    static CertificateKeys fromCertificate(const QSslCertificate &certificate);
+};
+
+// Индекс возможных издателей. Строится один раз по хранилищу, поиск
+// кандидатов - по хэш-таблицам без перебора всех CA.
+class CertificateIndex
+{
+public:
+    void clear();
+    void insert(const QSslCertificate &certificate);
+    // Запись без разобранного сертификата: ключи берутся из индекса
+    // хранилища, сам сертификат загружает владелец по отпечатку
+    void insert(const QByteArray &fingerprint, const CertificateKeys &keys,
+                const QSslCertificate &certificate = QSslCertificate());
+    void remove(const QSslCertificate &certificate);
+    void remove(const QByteArray &fingerprint);
+    bool contains(const QSslCertificate &certificate) const;
+    int size() const { return m_entries.size(); }
+    
+    // Кандидаты отбираются по AKI/SKI, если AKI задан, иначе по имени
+    // издателя; подпись проверяет isIssuedBy()
+    QList<QByteArray> findIssuerFingerprints(const CertificateKeys &keys) const;
+    // То же по имени издателя и AKI без субъекта - для CRL
+    QList<QByteArray> findIssuerFingerprints(const QByteArray &issuer,
+                                             const QByteArray &authorityKeyId) const;
+    // Только записи с разобранным сертификатом
+    QList<QSslCertificate> findIssuers(const CertificateKeys &keys) const;
+    
+    // Имя издателя совпадает с субъектом issuer и подпись сходится
+    static bool isIssuedBy(const QSslCertificate &certificate, const QSslCertificate &issuer);
+
+private:
+    struct Entry {
+        QSslCertificate certificate;
+        CertificateKeys keys;
+    };
+    
+    void unlink(const QByteArray &fingerprint, const Entry &entry);
+    
+    QHash<QByteArray, Entry> m_entries;                // SHA-256 DER -> запись
+    QMultiHash<QByteArray, QByteArray> m_bySubject;    // хэш имени -> отпечатки
+    QMultiHash<QByteArray, QByteArray> m_byKeyId;      // SKI -> отпечатки
+};
+
+#endif // CERTIFICATEINDEX_H
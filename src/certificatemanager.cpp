@@ -8,6 +8,11 @@
 #include <QTimer>
 #include <QSslConfiguration>
 #include <QSslSocket>
+#include <QSet>
+#include <QtConcurrent>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <algorithm>
 #include <QProcess>
 
 const QString CertificateManager::STORE_FILENAME = "certificates.json";
@@ -15,6 +20,9 @@ const QString CertificateManager::BACKUP_FILENAME = "certificates.json.bak";
 
 CertificateManager::CertificateManager(QObject *parent)
     : QObject(parent)
+    , m_deadlineCounter(0)
+    , m_expiryTimer(new QTimer(this))
+    , m_revocation(new RevocationCache(this))
     , m_expiryWarningDays(DEFAULT_EXPIRY_WARNING_DAYS)
     , m_autoUpdateEnabled(false)
 {
@@ -27,22 +35,48 @@ CertificateManager::CertificateManager(QObject *parent)
     
     loadTrustedDomains();
     
-    // Настройка таймера для проверки истекающих сертификатов
-    QTimer *expiryTimer = new QTimer(this);
-    connect(expiryTimer, &QTimer::timeout, this, &CertificateManager::checkExpiringCertificates);
-    expiryTimer->start(24 * 60 * 60 * 1000); // Проверка раз в сутки
+    // Таймер взводится на ближайший срок, без периодического опроса
+    m_expiryTimer->setSingleShot(true);
+    m_expiryTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_expiryTimer, &QTimer::timeout, this, &CertificateManager::checkExpiringCertificates);
+    
+    connect(&m_importWatcher, &QFutureWatcher<ParsedFile>::progressValueChanged, this, [this](int value) {
+        emit importProgress(value, m_importWatcher.progressMaximum());
+    });
+    connect(&m_importWatcher, &QFutureWatcher<ParsedFile>::finished,
+            this, &CertificateManager::handleImportFinished);
+    
+    // Индекс издателей перестраивается при каждом обновлении системного
+    // хранилища, а не при каждой проверке
+    connect(this, &CertificateManager::systemCertificatesChanged,
+            this, &CertificateManager::rebuildIssuerIndex);
+    
+    // Новые сведения об отзыве меняют результаты уже проверенных цепочек
+    connect(m_revocation, &RevocationCache::updated, this, &CertificateManager::invalidateVerdicts);
     
     // Загрузка системных сертификатов
     refreshSystemCertificates();
+    rescheduleAllExpiries();
 }
 
 CertificateManager::~CertificateManager()
 {
+    m_importWatcher.cancel();
+    m_importWatcher.waitForFinished();
     saveTrustedDomains();
     backupStore();
 }
 
 bool CertificateManager::initializeStore()
+{
+    // Читается только индекс; сертификаты разбираются по обращению
+    if (m_store.open(m_storePath, &m_certificates)) {
+        return true;
+    }
+    return loadLegacyStore();
+}
+
+bool CertificateManager::loadLegacyStore()
 {
     QString filePath = m_storePath + "/" + STORE_FILENAME;
     QFile file(filePath);
@@ -93,6 +127,11 @@ bool CertificateManager::initializeStore()
                     }
                 }
             }
+            
+            // Переносим в двоичное хранилище; JSON остаётся резервной копией
+            backupStore();
+            QFile::remove(m_storePath + "/" + BACKUP_FILENAME);
+            QFile::rename(filePath, m_storePath + "/" + BACKUP_FILENAME);
             return true;
         }
     }
@@ -101,51 +140,57 @@ bool CertificateManager::initializeStore()
 
 void CertificateManager::backupStore()
 {
-    QString filePath = m_storePath + "/" + STORE_FILENAME;
-    QString backupPath = m_storePath + "/" + BACKUP_FILENAME;
-    
-    QJsonObject root;
-    QJsonArray certs;
+    // Индекс переписывается атомарно, данные только дописываются
+    if (!m_store.save(m_certificates, m_privateKeys)) {
+        qWarning() << "Failed to save certificate store";
+    }
+}
+
+QSslCertificate CertificateManager::certificateFor(const QString &fingerprint) const
+{
+    auto it = m_certificates.find(fingerprint);
+    if (it == m_certificates.end()) {
+        return QSslCertificate();
+    }
     
-    for (auto it = m_certificates.begin(); it != m_certificates.end(); ++it) {
-        QJsonObject certObj;
-        const CertificateInfo &info = it.value();
-        
-        certObj["data"] = QString(info.certificate.toPem().toBase64());
-        certObj["nickname"] = info.nickname;
-        certObj["importDate"] = info.importDate.toString(Qt::ISODate);
-        certObj["trusted"] = info.trusted;
-        certObj["autoTrust"] = info.autoTrust;
-        
-        QJsonObject meta;
-        for (auto mit = info.metadata.begin(); mit != info.metadata.end(); ++mit) {
-            meta[mit.key()] = QJsonValue::fromVariant(mit.value());
-        }
-        certObj["metadata"] = meta;
-        
-        // Сохранение приватного ключа, если есть
-        if (m_privateKeys.contains(it.key())) {
-            certObj["privateKey"] = QString(m_privateKeys[it.key()].toPem().toBase64());
+    if (it->certificate.isNull()) {
+        it->certificate = m_store.certificate(fingerprint);
+        if (!it->certificate.isNull()) {
+            m_fingerprints.insert(it->certificate, fingerprint);
         }
-        
-        certs.append(certObj);
     }
-    
-    root["certificates"] = certs;
-    
-    QJsonDocument doc(root);
-    QFile file(filePath);
-    
-    // Создаем резервную копию перед сохранением
-    if (QFile::exists(filePath)) {
-        QFile::remove(backupPath);
-        QFile::copy(filePath, backupPath);
+    return it->certificate;
+}
+
+CertificateInfo CertificateManager::loadedInfo(const QString &fingerprint) const
+{
+    certificateFor(fingerprint);
+    return m_certificates.value(fingerprint);
+}
+
+QDateTime CertificateManager::expiryDateOf(const QString &fingerprint) const
+{
+    // Срок действия есть в индексе - разбирать сертификат не нужно
+    auto it = std::as_const(m_certificates).find(fingerprint);
+    if (it != m_certificates.constEnd() && !it->certificate.isNull()) {
+        return it->certificate.expiryDate();
+    }
+    const CertificateRecord *record = m_store.record(fingerprint);
+    return record ? record->expiryDate : QDateTime();
+}
+
+QSslKey CertificateManager::privateKeyFor(const QString &fingerprint) const
+{
+    auto it = m_privateKeys.constFind(fingerprint);
+    if (it != m_privateKeys.constEnd()) {
+        return it.value();
     }
     
-    if (file.open(QIODevice::WriteOnly)) {
-        file.write(doc.toJson());
-        file.close();
+    const QSslKey key = m_store.privateKey(fingerprint);
+    if (!key.isNull()) {
+        m_privateKeys.insert(fingerprint, key);
     }
+    return key;
 }
 
 bool CertificateManager::importCertificate(const QString &path, const QString &nickname)
@@ -191,9 +236,12 @@ bool CertificateManager::removeCertificate(const QString &fingerprint)
         return false;
     }
     
+    m_issuerIndex.remove(QByteArray::fromHex(fingerprint.toLatin1()));
+    invalidateVerdicts();
     m_certificates.remove(fingerprint);
     m_privateKeys.remove(fingerprint);
     m_domainTrust.remove(fingerprint);
+    unscheduleExpiry(fingerprint);
     
     backupStore();
     emit certificateRemoved(fingerprint);
@@ -209,6 +257,8 @@ bool CertificateManager::trustCertificate(const QString &fingerprint, bool trust
     CertificateInfo &info = m_certificates[fingerprint];
     if (info.trusted != trust) {
         info.trusted = trust;
+        invalidateVerdicts();
+        scheduleExpiry(fingerprint);
         emit certificateTrustChanged(fingerprint, trust);
         backupStore();
     }
@@ -218,20 +268,24 @@ bool CertificateManager::trustCertificate(const QString &fingerprint, bool trust
 
 CertificateInfo CertificateManager::getCertificateInfo(const QString &fingerprint) const
 {
-    return m_certificates.value(fingerprint);
+    return loadedInfo(fingerprint);
 }
 
 QList<CertificateInfo> CertificateManager::getAllCertificates() const
 {
-    return m_certificates.values();
+    QList<CertificateInfo> certificates;
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        certificates.append(loadedInfo(it.key()));
+    }
+    return certificates;
 }
 
 QList<CertificateInfo> CertificateManager::getTrustedCertificates() const
 {
     QList<CertificateInfo> trusted;
-    for (const CertificateInfo &info : m_certificates) {
-        if (info.trusted) {
-            trusted.append(info);
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        if (it->trusted) {
+            trusted.append(loadedInfo(it.key()));
         }
     }
     return trusted;
@@ -242,9 +296,9 @@ QList<CertificateInfo> CertificateManager::getExpiredCertificates() const
     QList<CertificateInfo> expired;
     QDateTime now = QDateTime::currentDateTime();
     
-    for (const CertificateInfo &info : m_certificates) {
-        if (info.certificate.expiryDate() < now) {
-            expired.append(info);
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        if (expiryDateOf(it.key()) < now) {
+            expired.append(loadedInfo(it.key()));
         }
     }
     return expired;
@@ -271,6 +325,11 @@ QList<QSslError> CertificateManager::validateCertificate(const QSslCertificate &
         return errors;
     }
     
+    const QString key = verdictKey({certificate}, QString(), QLatin1Char('v'));
+    if (const CertificateVerdict *verdict = cachedVerdict(key)) {
+        return verdict->errors;
+    }
+    
     QDateTime now = QDateTime::currentDateTime();
     
     if (certificate.isBlacklisted()) {
@@ -286,21 +345,195 @@ QList<QSslError> CertificateManager::validateCertificate(const QSslCertificate &
     }
     
     // Проверка цепочки доверия
-    QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
-    QList<QSslCertificate> caCerts = sslConfig.caCertificates();
+    QList<QSslCertificate> chain;
+    errors += buildChain(certificate, nullptr, &chain);
     
-    bool foundIssuer = false;
-    for (const QSslCertificate &caCert : caCerts) {
-        if (certificate.issuerDisplayName() == caCert.subjectDisplayName()) {
-            foundIssuer = true;
-            break;
+    CertificateVerdict verdict;
+    verdict.errors = errors;
+    verdict.trusted = errors.isEmpty();
+    storeVerdict(key, verdict, chain);
+    return errors;
+}
+
+bool CertificateManager::verifyChain(const QList<QSslCertificate> &chain) const
+{
+    if (chain.isEmpty() || !verifyCertificate(chain.first())) {
+        return false;
+    }
+    
+    // Повторные соединения присылают ту же цепочку - результат берём из кэша
+    const QString key = verdictKey(chain, QString(), QLatin1Char('c'));
+    if (const CertificateVerdict *verdict = cachedVerdict(key)) {
+        return verdict->trusted;
+    }
+    
+    // Остальные сертификаты цепочки - промежуточные, доверия им нет
+    CertificateIndex untrusted;
+    for (int i = 1; i < chain.size(); ++i) {
+        untrusted.insert(chain[i]);
+    }
+    
+    QList<QSslCertificate> built;
+    CertificateVerdict verdict;
+    verdict.errors = buildChain(chain.first(), &untrusted, &built);
+    verdict.trusted = verdict.errors.isEmpty();
+    storeVerdict(key, verdict, chain + built);
+    return verdict.trusted;
+}
+
+QString CertificateManager::verdictKey(const QList<QSslCertificate> &chain, const QString &domain,
+                                       QChar kind) const
+{
+    QString key(kind);
+    for (const QSslCertificate &certificate : chain) {
+        key += QLatin1Char(':') + calculateFingerprint(certificate);
+    }
+    return key + QLatin1Char('@') + domain.toLower();
+}
+
+const CertificateVerdict *CertificateManager::cachedVerdict(const QString &key) const
+{
+    auto it = m_verdicts.constFind(key);
+    if (it == m_verdicts.constEnd()) {
+        return nullptr;
+    }
+    if (it->validUntil.isValid() && it->validUntil <= QDateTime::currentDateTime()) {
+        m_verdicts.erase(it);
+        return nullptr;
+    }
+    return &it.value();
+}
+
+void CertificateManager::storeVerdict(const QString &key, CertificateVerdict verdict,
+                                      const QList<QSslCertificate> &chain) const
+{
+    // Результат меняется, когда истекает или вступает в силу любой
+    // сертификат цепочки
+    const QDateTime now = QDateTime::currentDateTime();
+    for (const QSslCertificate &certificate : chain) {
+        for (const QDateTime &moment : {certificate.effectiveDate(), certificate.expiryDate()}) {
+            if (moment > now && (!verdict.validUntil.isValid() || moment < verdict.validUntil)) {
+                verdict.validUntil = moment;
+            }
         }
     }
     
-    if (!foundIssuer) {
-        errors.append(QSslError(QSslError::UnableToGetIssuerCertificate));
+    if (m_verdicts.size() >= MAX_CACHED_VERDICTS) {
+        m_verdicts.clear();
+    }
+    m_verdicts.insert(key, verdict);
+}
+
+void CertificateManager::invalidateVerdicts()
+{
+    // Любое изменение хранилища или доверия может поменять любой результат
+    m_verdicts.clear();
+}
+
+QList<QSslCertificate> CertificateManager::issuerCandidates(const QByteArray &issuer,
+                                                           const QByteArray &authorityKeyId) const
+{
+    QList<QSslCertificate> candidates;
+    const QList<QByteArray> fingerprints = m_issuerIndex.findIssuerFingerprints(issuer, authorityKeyId);
+    for (const QByteArray &fingerprint : fingerprints) {
+        const QSslCertificate candidate = certificateFor(QString::fromLatin1(fingerprint.toHex()));
+        if (!candidate.isNull()) {
+            candidates.append(candidate);
+        }
+    }
+    return candidates;
+}
+
+bool CertificateManager::isTrustAnchor(const QSslCertificate &certificate) const
+{
+    auto it = m_certificates.constFind(calculateFingerprint(certificate));
+    return it != m_certificates.constEnd() && it->trusted;
+}
+
+QList<QSslError> CertificateManager::buildChain(const QSslCertificate &certificate,
+                                                const CertificateIndex *untrusted,
+                                                QList<QSslCertificate> *chain) const
+{
+    QList<QSslError> errors;
+    const QDateTime now = QDateTime::currentDateTime();
+    QSet<QString> visited;
+    QSslCertificate current = certificate;
+    
+    chain->clear();
+    chain->append(current);
+    visited.insert(calculateFingerprint(current));
+    
+    while (chain->size() <= MAX_CHAIN_LENGTH) {
+        if (isTrustAnchor(current)) {
+            return errors;
+        }
+        
+        // Кандидаты из индекса и из присланных сервером сертификатов;
+        // подходит только тот, чьим ключом действительно подписан текущий
+        const CertificateKeys keys = CertificateKeys::fromCertificate(current);
+        QList<QSslCertificate> candidates = issuerCandidates(keys.issuer, keys.authorityKeyId);
+        if (untrusted) {
+            candidates += untrusted->findIssuers(keys);
+        }
+        
+        QSslCertificate issuer;
+        for (const QSslCertificate &candidate : std::as_const(candidates)) {
+            if (visited.contains(calculateFingerprint(candidate)) ||
+                !CertificateIndex::isIssuedBy(current, candidate)) {
+                continue;
+            }
+            // При перевыпуске CA с тем же ключом предпочитаем доверенный
+            // и действующий сертификат
+            if (issuer.isNull() || isTrustAnchor(candidate) ||
+                (candidate.expiryDate() >= now && issuer.expiryDate() < now)) {
+                issuer = candidate;
+            }
+            if (isTrustAnchor(issuer)) {
+                break;
+            }
+        }
+        
+        if (issuer.isNull()) {
+            if (keys.isSelfIssued() && CertificateIndex::isIssuedBy(current, current)) {
+                errors.append(QSslError(chain->size() == 1 ? QSslError::SelfSignedCertificate
+                                                           : QSslError::SelfSignedCertificateInChain,
+                                        current));
+            } else {
+                errors.append(QSslError(chain->size() == 1 ? QSslError::UnableToGetIssuerCertificate
+                                                           : QSslError::UnableToGetLocalIssuerCertificate,
+                                        current));
+            }
+            return errors;
+        }
+        
+        if (!CertificateKeys::fromCertificate(issuer).isCa) {
+            errors.append(QSslError(QSslError::InvalidCaCertificate, issuer));
+        }
+        
+        // Только поиск в кэше; без данных цепочка не отклоняется (soft-fail),
+        // а CRL или OCSP запрашиваются в фоне
+        switch (m_revocation->status(keys)) {
+        case RevocationCache::Revoked:
+            errors.append(QSslError(QSslError::CertificateRevoked, current));
+            break;
+        case RevocationCache::Unknown:
+            m_revocation->refresh(current, issuer);
+            break;
+        case RevocationCache::Good:
+            break;
+        }
+        if (issuer.expiryDate() < now) {
+            errors.append(QSslError(QSslError::CertificateExpired, issuer));
+        } else if (issuer.effectiveDate() > now) {
+            errors.append(QSslError(QSslError::CertificateNotYetValid, issuer));
+        }
+        
+        visited.insert(calculateFingerprint(issuer));
+        chain->append(issuer);
+        current = issuer;
     }
     
+    errors.append(QSslError(QSslError::PathLengthExceeded, current));
     return errors;
 }
 
@@ -313,6 +546,7 @@ bool CertificateManager::addTrustedDomain(const QString &fingerprint, const QStr
     QStringList &domains = m_domainTrust[fingerprint];
     if (!domains.contains(domain)) {
         domains.append(domain);
+        invalidateVerdicts();
         emit domainTrustChanged(fingerprint, domain);
         saveTrustedDomains();
         return true;
@@ -328,6 +562,7 @@ bool CertificateManager::removeTrustedDomain(const QString &fingerprint, const Q
     
     QStringList &domains = m_domainTrust[fingerprint];
     if (domains.removeOne(domain)) {
+        invalidateVerdicts();
         emit domainTrustChanged(fingerprint, domain);
         saveTrustedDomains();
         return true;
@@ -342,23 +577,22 @@ QStringList CertificateManager::getTrustedDomains(const QString &fingerprint) co
 
 bool CertificateManager::isDomainTrusted(const QString &domain, const QSslCertificate &certificate) const
 {
-    QString fingerprint = calculateFingerprint(certificate);
-    
-    if (!m_certificates.contains(fingerprint)) {
-        return false;
+    const QString key = verdictKey({certificate}, domain, QLatin1Char('d'));
+    if (const CertificateVerdict *verdict = cachedVerdict(key)) {
+        return verdict->trusted;
     }
     
-    const CertificateInfo &info = m_certificates[fingerprint];
-    if (!info.trusted) {
-        return false;
-    }
+    QString fingerprint = calculateFingerprint(certificate);
+    CertificateVerdict verdict;
     
-    if (info.autoTrust) {
-        return true;
+    auto it = m_certificates.constFind(fingerprint);
+    if (it != m_certificates.constEnd() && it->trusted) {
+        verdict.trusted = it->autoTrust ||
+                          m_domainTrust.value(fingerprint).contains(domain, Qt::CaseInsensitive);
     }
     
-    const QStringList &domains = m_domainTrust.value(fingerprint);
-    return domains.contains(domain, Qt::CaseInsensitive);
+    storeVerdict(key, verdict, {certificate});
+    return verdict.trusted;
 }
 
 bool CertificateManager::exportCertificate(const QString &fingerprint, const QString &path,
@@ -368,13 +602,13 @@ bool CertificateManager::exportCertificate(const QString &fingerprint, const QSt
         return false;
     }
     
-    const CertificateInfo &info = m_certificates[fingerprint];
+    const QSslCertificate certificate = certificateFor(fingerprint);
     QByteArray data;
     
     if (format.toUpper() == "PEM") {
-        data = info.certificate.toPem();
+        data = certificate.toPem();
     } else if (format.toUpper() == "DER") {
-        data = info.certificate.toDer();
+        data = certificate.toDer();
     } else {
         return false;
     }
@@ -392,11 +626,11 @@ bool CertificateManager::exportCertificate(const QString &fingerprint, const QSt
 bool CertificateManager::exportPrivateKey(const QString &fingerprint, const QString &path,
                                         const QString &password)
 {
-    if (!m_privateKeys.contains(fingerprint)) {
+    const QSslKey key = privateKeyFor(fingerprint);
+    if (key.isNull()) {
         return false;
     }
     
-    const QSslKey &key = m_privateKeys[fingerprint];
     QByteArray data = key.toPem(password.toUtf8());
     
     QFile file(path);
@@ -443,9 +677,14 @@ bool CertificateManager::importPKCS12(const QString &path, const QString &passwo
         m_privateKeys[fingerprint] = key;
     }
     
+    m_issuerIndex.insert(cert);
+    invalidateVerdicts();
+    queueExpiry(fingerprint);
+    
     // Сохраняем CA сертификаты
     for (const QSslCertificate &caCert : caCerts) {
         QString caFingerprint = calculateFingerprint(caCert);
+        m_issuerIndex.insert(caCert);
         if (!m_certificates.contains(caFingerprint)) {
             CertificateInfo caInfo;
             caInfo.certificate = caCert;
@@ -453,14 +692,168 @@ bool CertificateManager::importPKCS12(const QString &path, const QString &passwo
             caInfo.trusted = false;
             caInfo.autoTrust = false;
             m_certificates[caFingerprint] = caInfo;
+            queueExpiry(caFingerprint);
         }
     }
     
+    armExpiryTimer();
     backupStore();
     emit certificateImported(fingerprint);
     return true;
 }
 
+bool CertificateManager::importCertificates(const QStringList &paths)
+{
+    if (isImporting()) {
+        return false;
+    }
+    
+    // Каталоги раскрываем сразу: список файлов нужен для прогресса
+    const QStringList filters{"*.pem", "*.crt", "*.cer", "*.der"};
+    QStringList files;
+    for (const QString &path : paths) {
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, filters, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                files.append(it.next());
+            }
+        } else {
+            files.append(path);
+        }
+    }
+    
+    if (files.isEmpty()) {
+        return false;
+    }
+    
+    m_importWatcher.setFuture(QtConcurrent::mapped(files, &CertificateManager::parseCertificateFile));
+    return true;
+}
+
+bool CertificateManager::isImporting() const
+{
+    return m_importWatcher.isRunning();
+}
+
+bool CertificateManager::importRevocationList(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    
+    // Издатель ищется по имени и AKI списка (субъекта у CRL нет),
+    // подпись проверяет сам кэш
+    const CertificateKeys keys = RevocationCache::crlIssuer(data);
+    const QList<QSslCertificate> candidates = issuerCandidates(keys.issuer, keys.authorityKeyId);
+    for (const QSslCertificate &issuer : candidates) {
+        if (m_revocation->addCrl(data, issuer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CertificateManager::addStapledOcspResponse(const QByteArray &response,
+                                                const QSslCertificate &certificate)
+{
+    const CertificateKeys keys = CertificateKeys::fromCertificate(certificate);
+    const QList<QSslCertificate> candidates = issuerCandidates(keys.issuer, keys.authorityKeyId);
+    for (const QSslCertificate &issuer : candidates) {
+        if (CertificateIndex::isIssuedBy(certificate, issuer) &&
+            m_revocation->addOcspResponse(response, certificate, issuer)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+CertificateManager::ParsedFile CertificateManager::parseCertificateFile(const QString &path)
+{
+    ParsedFile result;
+    result.path = path;
+    
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.failed = 1;
+        return result;
+    }
+    const QByteArray data = file.readAll();
+    
+    // PEM-связка может содержать много сертификатов; иначе пробуем DER
+    QList<QSslCertificate> certificates = QSslCertificate::fromData(data, QSsl::Pem);
+    if (certificates.isEmpty()) {
+        certificates = QSslCertificate::fromData(data, QSsl::Der);
+    }
+    if (certificates.isEmpty()) {
+        result.failed = 1;
+        return result;
+    }
+    
+    // Всё дорогое - хэши и разбор расширений - здесь, в рабочем потоке
+    for (const QSslCertificate &certificate : std::as_const(certificates)) {
+        ParsedCertificate parsed;
+        parsed.certificate = certificate;
+        parsed.keys = CertificateKeys::fromCertificate(certificate);
+        if (certificate.isNull() || certificate.isBlacklisted() || !parsed.keys.isValid()) {
+            ++result.failed;
+            continue;
+        }
+        parsed.fingerprint = QString(certificate.digest(QCryptographicHash::Sha256).toHex());
+        result.certificates.append(parsed);
+    }
+    return result;
+}
+
+void CertificateManager::handleImportFinished()
+{
+    const QFuture<ParsedFile> future = m_importWatcher.future();
+    if (future.isCanceled()) {
+        return;
+    }
+    
+    int imported = 0;
+    int failed = 0;
+    QStringList added;
+    const QDateTime now = QDateTime::currentDateTime();
+    
+    for (int i = 0; i < future.resultCount(); ++i) {
+        const ParsedFile file = future.resultAt(i);
+        failed += file.failed;
+        
+        for (const ParsedCertificate &parsed : file.certificates) {
+            if (m_certificates.contains(parsed.fingerprint)) {
+                continue;
+            }
+            
+            CertificateInfo info;
+            info.certificate = parsed.certificate;
+            info.importDate = now;
+            info.trusted = false;
+            info.autoTrust = false;
+            m_certificates.insert(parsed.fingerprint, info);
+            m_fingerprints.insert(parsed.certificate, parsed.fingerprint);
+            m_issuerIndex.insert(QByteArray::fromHex(parsed.fingerprint.toLatin1()),
+                                 parsed.keys, parsed.certificate);
+            queueExpiry(parsed.fingerprint);
+            added.append(parsed.fingerprint);
+            ++imported;
+        }
+    }
+    
+    // Одна запись хранилища и один пересчёт на весь пакет
+    if (imported > 0) {
+        invalidateVerdicts();
+        armExpiryTimer();
+        backupStore();
+    }
+    for (const QString &fingerprint : std::as_const(added)) {
+        emit certificateImported(fingerprint);
+    }
+    emit importFinished(imported, failed);
+}
+
 bool CertificateManager::setMetadata(const QString &fingerprint, const QString &key,
                                    const QVariant &value)
 {
@@ -486,7 +879,10 @@ QVariant CertificateManager::getMetadata(const QString &fingerprint, const QStri
 
 void CertificateManager::setExpiryWarningPeriod(int days)
 {
-    m_expiryWarningDays = days;
+    if (m_expiryWarningDays != days) {
+        m_expiryWarningDays = days;
+        rescheduleAllExpiries();
+    }
 }
 
 QList<CertificateInfo> CertificateManager::getExpiringCertificates() const
@@ -495,10 +891,10 @@ QList<CertificateInfo> CertificateManager::getExpiringCertificates() const
     QDateTime now = QDateTime::currentDateTime();
     QDateTime warningDate = now.addDays(m_expiryWarningDays);
     
-    for (const CertificateInfo &info : m_certificates) {
-        QDateTime expiryDate = info.certificate.expiryDate();
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        QDateTime expiryDate = expiryDateOf(it.key());
         if (expiryDate > now && expiryDate <= warningDate) {
-            expiring.append(info);
+            expiring.append(loadedInfo(it.key()));
         }
     }
     return expiring;
@@ -520,8 +916,16 @@ void CertificateManager::refreshSystemCertificates()
     QSslConfiguration sslConfig = QSslConfiguration::defaultConfiguration();
     QList<QSslCertificate> systemCerts = sslConfig.caCertificates();
     
-    for (const QSslCertificate &cert : systemCerts) {
-        QString fingerprint = calculateFingerprint(cert);
+    // Отпечатки сотен системных CA считаются параллельно
+    const QStringList fingerprints = QtConcurrent::blockingMapped<QStringList>(
+        systemCerts, [](const QSslCertificate &cert) {
+            return QString(cert.digest(QCryptographicHash::Sha256).toHex());
+        });
+    
+    for (int i = 0; i < systemCerts.size(); ++i) {
+        const QSslCertificate &cert = systemCerts[i];
+        const QString &fingerprint = fingerprints[i];
+        m_fingerprints.insert(cert, fingerprint);
         if (!m_certificates.contains(fingerprint)) {
             CertificateInfo info;
             info.certificate = cert;
@@ -529,9 +933,11 @@ void CertificateManager::refreshSystemCertificates()
             info.trusted = true;
             info.autoTrust = true;
             m_certificates[fingerprint] = info;
+            queueExpiry(fingerprint);
         }
     }
     
+    armExpiryTimer();
     emit systemCertificatesChanged();
 }
 
@@ -541,7 +947,7 @@ bool CertificateManager::installSystemCertificate(const QString &fingerprint)
         return false;
     }
 
-    const QSslCertificate &cert = m_certificates[fingerprint];
+    const QSslCertificate cert = certificateFor(fingerprint);
     QString certData = QString::fromLatin1(cert.toPem());
 
 #ifdef Q_OS_WIN
@@ -652,7 +1058,7 @@ bool CertificateManager::removeSystemCertificate(const QString &fingerprint)
 
 #elif defined(Q_OS_MAC)
     // macOS implementation
-    const QSslCertificate &cert = m_certificates[fingerprint];
+    const QSslCertificate cert = certificateFor(fingerprint);
     QString commonName = cert.subjectInfo(QSslCertificate::CommonName).join(",");
     
     QProcess process;
@@ -676,19 +1082,94 @@ bool CertificateManager::removeSystemCertificate(const QString &fingerprint)
 
 void CertificateManager::checkExpiringCertificates()
 {
-    QDateTime now = QDateTime::currentDateTime();
-    QDateTime warningDate = now.addDays(m_expiryWarningDays);
-    
-    for (const auto &pair : m_certificates.toStdMap()) {
-        const QString &fingerprint = pair.first;
-        const CertificateInfo &info = pair.second;
+    // Обрабатываются только наступившие сроки; после сна системы таймер
+    // может сработать позже - тогда они обработаются все сразу
+    const QDateTime now = QDateTime::currentDateTime();
+    const qint64 nowMs = now.toMSecsSinceEpoch();
+    auto later = [](const ExpiryDeadline &a, const ExpiryDeadline &b) { return a.time > b.time; };
+    
+    while (!m_deadlines.isEmpty() && m_deadlines.first().time <= nowMs) {
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end(), later);
+        const ExpiryDeadline deadline = m_deadlines.takeLast();
         
-        QDateTime expiryDate = info.certificate.expiryDate();
-        if (expiryDate > now && expiryDate <= warningDate) {
-            int daysLeft = now.daysTo(expiryDate);
-            emit certificateExpiring(fingerprint, daysLeft);
+        auto generation = m_deadlineGenerations.constFind(deadline.fingerprint);
+        if (generation == m_deadlineGenerations.constEnd() || *generation != deadline.generation) {
+            continue;
         }
+        
+        if (deadline.expired) {
+            invalidateVerdicts();
+            emit certificateError(deadline.fingerprint, "Certificate expired");
+        } else {
+            int daysLeft = now.daysTo(expiryDateOf(deadline.fingerprint));
+            emit certificateExpiring(deadline.fingerprint, daysLeft);
+        }
+    }
+    
+    armExpiryTimer();
+}
+
+void CertificateManager::queueExpiry(const QString &fingerprint)
+{
+    // Новое поколение делает прежние записи этого сертификата устаревшими
+    const quint64 generation = ++m_deadlineCounter;
+    m_deadlineGenerations.insert(fingerprint, generation);
+    
+    const QDateTime expiryDate = expiryDateOf(fingerprint);
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (!expiryDate.isValid() || expiryDate.toMSecsSinceEpoch() <= now) {
+        return;
     }
+    
+    const qint64 warningTime = expiryDate.addDays(-m_expiryWarningDays).toMSecsSinceEpoch();
+    pushDeadline(qMax(warningTime, now), fingerprint, generation, false);
+    pushDeadline(expiryDate.toMSecsSinceEpoch(), fingerprint, generation, true);
+}
+
+void CertificateManager::pushDeadline(qint64 time, const QString &fingerprint,
+                                      quint64 generation, bool expired)
+{
+    m_deadlines.append({time, fingerprint, generation, expired});
+    std::push_heap(m_deadlines.begin(), m_deadlines.end(),
+                   [](const ExpiryDeadline &a, const ExpiryDeadline &b) { return a.time > b.time; });
+}
+
+void CertificateManager::scheduleExpiry(const QString &fingerprint)
+{
+    // Устаревших записей в куче не должно быть больше живых
+    if (m_deadlines.size() > 4 * m_certificates.size() + 64) {
+        rescheduleAllExpiries();
+        return;
+    }
+    queueExpiry(fingerprint);
+    armExpiryTimer();
+}
+
+void CertificateManager::unscheduleExpiry(const QString &fingerprint)
+{
+    m_deadlineGenerations.remove(fingerprint);
+}
+
+void CertificateManager::rescheduleAllExpiries()
+{
+    m_deadlines.clear();
+    m_deadlineGenerations.clear();
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        queueExpiry(it.key());
+    }
+    armExpiryTimer();
+}
+
+void CertificateManager::armExpiryTimer()
+{
+    if (m_deadlines.isEmpty()) {
+        m_expiryTimer->stop();
+        return;
+    }
+    
+    // Интервал QTimer ограничен int: дальние сроки перевзводятся по пути
+    const qint64 delay = m_deadlines.first().time - QDateTime::currentMSecsSinceEpoch();
+    m_expiryTimer->start(static_cast<int>(qBound<qint64>(0, delay, qint64(MAX_TIMER_INTERVAL))));
 }
 
 void CertificateManager::handleSystemCertificateUpdate()
@@ -698,6 +1179,21 @@ void CertificateManager::handleSystemCertificateUpdate()
     }
 }
 
+void CertificateManager::rebuildIssuerIndex()
+{
+    invalidateVerdicts();
+    m_issuerIndex.clear();
+    for (auto it = m_certificates.constBegin(); it != m_certificates.constEnd(); ++it) {
+        // Не загруженные сертификаты попадают в индекс по ключам из хранилища
+        const CertificateRecord *record = m_store.record(it.key());
+        if (it->certificate.isNull() && record) {
+            m_issuerIndex.insert(QByteArray::fromHex(it.key().toLatin1()), record->keys);
+        } else {
+            m_issuerIndex.insert(it->certificate);
+        }
+    }
+}
+
 void CertificateManager::validateStoredCertificates()
 {
     QDateTime now = QDateTime::currentDateTime();
@@ -705,11 +1201,11 @@ void CertificateManager::validateStoredCertificates()
     
     for (auto it = m_certificates.begin(); it != m_certificates.end(); ++it) {
         const QString &fingerprint = it.key();
-        const CertificateInfo &info = it.value();
+        const QSslCertificate certificate = certificateFor(fingerprint);
         
-        if (info.certificate.isNull() || 
-            info.certificate.isBlacklisted() ||
-            info.certificate.expiryDate() < now) {
+        if (certificate.isNull() || 
+            certificate.isBlacklisted() ||
+            certificate.expiryDate() < now) {
             toRemove.append(fingerprint);
         }
     }
@@ -721,7 +1217,19 @@ void CertificateManager::validateStoredCertificates()
 
 QString CertificateManager::calculateFingerprint(const QSslCertificate &certificate) const
 {
-    return QString(certificate.digest(QCryptographicHash::Sha256).toHex());
+    // qHash сертификата берётся из SHA-1, который OpenSSL считает при
+    // разборе, поэтому поиск в кэше дешевле нового SHA-256
+    auto it = m_fingerprints.constFind(certificate);
+    if (it != m_fingerprints.constEnd()) {
+        return it.value();
+    }
+    
+    const QString fingerprint = QString(certificate.digest(QCryptographicHash::Sha256).toHex());
+    if (m_fingerprints.size() >= MAX_CACHED_FINGERPRINTS) {
+        m_fingerprints.clear();
+    }
+    m_fingerprints.insert(certificate, fingerprint);
+    return fingerprint;
 }
 
 bool CertificateManager::storeCertificate(const QSslCertificate &certificate, const QString &nickname)
@@ -736,6 +1244,9 @@ bool CertificateManager::storeCertificate(const QSslCertificate &certificate, co
     info.autoTrust = false;
     
     m_certificates[fingerprint] = info;
+    m_issuerIndex.insert(certificate);
+    invalidateVerdicts();
+    scheduleExpiry(fingerprint);
     backupStore();
     
     return true;
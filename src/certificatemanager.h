@@ -7,15 +7,18 @@
 #include <QDateTime>
 #include <QHash>
 #include <QSslError>
+#include <QFutureWatcher>
+#include "certificateindex.h"
+#include "certificatestore.h"
+#include "revocationcache.h"
 
-struct CertificateInfo {
-    QSslCertificate certificate;
-    QString nickname;
-    QDateTime importDate;
-    bool trusted;
-    bool autoTrust;
-    QStringList trustedDomains;
-    QHash<QString, QVariant> metadata;
+class QTimer;
+
+// Закэшированный результат проверки цепочки или доверия домену
+struct CertificateVerdict {
+    QList<QSslError> errors;
+    bool trusted = false;
+    QDateTime validUntil;   // ближайший момент, когда результат может измениться
 };
 
 class CertificateManager : public QObject
@@ -44,6 +47,12 @@ public:
     bool verifyChain(const QList<QSslCertificate> &chain) const;
     QList<QSslError> validateCertificate(const QSslCertificate &certificate) const;
     
+    // Отзыв: CRL и ответы OCSP держатся в памяти, при построении цепочки
+    // проверяется только кэш, недостающие данные запрашиваются в фоне
+    bool importRevocationList(const QString &path);
+    bool addStapledOcspResponse(const QByteArray &response, const QSslCertificate &certificate);
+    RevocationCache *revocationCache() const { return m_revocation; }
+    
     // Управление доверием
     bool addTrustedDomain(const QString &fingerprint, const QString &domain);
     bool removeTrustedDomain(const QString &fingerprint, const QString &domain);
@@ -57,6 +66,11 @@ public:
                          const QString &password);
     bool importPKCS12(const QString &path, const QString &password);
     
+    // Пакетный импорт файлов, PEM-связок и каталогов: разбор и проверка
+    // идут в пуле потоков, хранилище записывается один раз в конце
+    bool importCertificates(const QStringList &paths);
+    bool isImporting() const;
+    
     // Метаданные
     bool setMetadata(const QString &fingerprint, const QString &key, 
                     const QVariant &value);
@@ -81,26 +95,88 @@ signals:
     void domainTrustChanged(const QString &fingerprint, const QString &domain);
     void metadataChanged(const QString &fingerprint, const QString &key);
     void systemCertificatesChanged();
+    void importProgress(int done, int total);
+    void importFinished(int imported, int failed);
 
 private slots:
     void checkExpiringCertificates();
     void handleSystemCertificateUpdate();
     void validateStoredCertificates();
+    void rebuildIssuerIndex();
+    void handleImportFinished();
 
 private:
+    // Результат разбора одного файла в рабочем потоке
+    struct ParsedCertificate {
+        QSslCertificate certificate;
+        QString fingerprint;
+        CertificateKeys keys;
+    };
+    struct ParsedFile {
+        QString path;
+        QList<ParsedCertificate> certificates;
+        int failed = 0;
+    };
+    static ParsedFile parseCertificateFile(const QString &path);
+    
     bool initializeStore();
+    bool loadLegacyStore();
+    
+    // Сертификаты и ключи из хранилища разбираются при первом обращении
+    QSslCertificate certificateFor(const QString &fingerprint) const;
+    QList<QSslCertificate> issuerCandidates(const QByteArray &issuer,
+                                            const QByteArray &authorityKeyId) const;
+    CertificateInfo loadedInfo(const QString &fingerprint) const;
+    QDateTime expiryDateOf(const QString &fingerprint) const;
+    QSslKey privateKeyFor(const QString &fingerprint) const;
     QString calculateFingerprint(const QSslCertificate &certificate) const;
     bool storeCertificate(const QSslCertificate &certificate, const QString &nickname);
     void updateCertificateMetadata(const QString &fingerprint);
     bool validateCertificateFile(const QString &path) const;
+    bool isTrustAnchor(const QSslCertificate &certificate) const;
+    QList<QSslError> buildChain(const QSslCertificate &certificate,
+                                const CertificateIndex *untrusted,
+                                QList<QSslCertificate> *chain) const;
+    
+    // Кэш результатов проверки
+    QString verdictKey(const QList<QSslCertificate> &chain, const QString &domain,
+                       QChar kind) const;
+    const CertificateVerdict *cachedVerdict(const QString &key) const;
+    void storeVerdict(const QString &key, CertificateVerdict verdict,
+                      const QList<QSslCertificate> &chain) const;
+    void invalidateVerdicts();
+    
+    // Сроки действия: куча ближайших событий и один таймер на ближайшее
+    struct ExpiryDeadline {
+        qint64 time;            // мс с начала эпохи
+        QString fingerprint;
+        quint64 generation;     // устаревшие записи пропускаются при извлечении
+        bool expired;           // false - предупреждение, true - истечение срока
+    };
+    void queueExpiry(const QString &fingerprint);
+    void pushDeadline(qint64 time, const QString &fingerprint, quint64 generation, bool expired);
+    void scheduleExpiry(const QString &fingerprint);
+    void unscheduleExpiry(const QString &fingerprint);
+    void rescheduleAllExpiries();
+    void armExpiryTimer();
     void loadTrustedDomains();
     void saveTrustedDomains();
     void backupStore();
     void restoreStore();
     
-    QHash<QString, CertificateInfo> m_certificates;
-    QHash<QString, QSslKey> m_privateKeys;
+    mutable QHash<QString, CertificateInfo> m_certificates;
+    mutable QHash<QString, QSslKey> m_privateKeys;     // загруженные и новые ключи
+    CertificateStore m_store;
+    QList<ExpiryDeadline> m_deadlines;                 // двоичная куча по времени
+    QHash<QString, quint64> m_deadlineGenerations;
+    quint64 m_deadlineCounter;
+    QTimer *m_expiryTimer;
+    QFutureWatcher<ParsedFile> m_importWatcher;
     QHash<QString, QStringList> m_domainTrust;
+    CertificateIndex m_issuerIndex;   // все известные сертификаты для построения цепочек
+    RevocationCache *m_revocation;
+    mutable QHash<QString, CertificateVerdict> m_verdicts;     // отпечатки цепочки + домен
+    mutable QHash<QSslCertificate, QString> m_fingerprints;    // сертификат -> SHA-256
     int m_expiryWarningDays;
     bool m_autoUpdateEnabled;
     QString m_storePath;
@@ -109,6 +185,10 @@ private:
     static const QString STORE_FILENAME;
     static const QString BACKUP_FILENAME;
     static const int DEFAULT_EXPIRY_WARNING_DAYS = 30;
+    static const int MAX_CHAIN_LENGTH = 10;
+    static const int MAX_CACHED_VERDICTS = 1024;
+    static const int MAX_CACHED_FINGERPRINTS = 4096;
+    static const int MAX_TIMER_INTERVAL = 24 * 24 * 60 * 60 * 1000; // мс, предел int
 };
 
 #endif // CERTIFICATEMANAGER_H 
\ No newline at end of file
@@ -0,0 +1,295 @@
+#include "certificatestore.h"
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDir>
+
+const QString CertificateStore::INDEX_FILENAME = "certificates.idx";
+
+namespace {
+
+enum RecordFlag : quint8 {
+    Trusted   = 0x01,
+    AutoTrust = 0x02,
+    IsCa      = 0x04
+};
+
+}
+
+CertificateStore::CertificateStore()
+    : m_generation(0)
+    , m_garbage(0)
+{
+}
+
+QString CertificateStore::blobPath(quint32 generation) const
+{
+    return m_directory + QString("/certificates.%1.der").arg(generation);
+}
+
+bool CertificateStore::open(const QString &directory, QHash<QString, CertificateInfo> *certificates)
+{
+    m_directory = directory;
+    m_records.clear();
+    m_garbage = 0;
+    m_blobs.close();
+    
+    QFile file(m_directory + "/" + INDEX_FILENAME);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    in >> magic >> version;
+    if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+        return false;
+    }
+    in >> m_generation >> m_garbage >> count;
+    
+    QHash<QString, CertificateInfo> loaded;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString fingerprint;
+        CertificateRecord record;
+        CertificateInfo info;
+        quint8 flags = 0;
+        
+        in >> fingerprint
+           >> record.keys.subject >> record.keys.issuer
+           >> record.keys.subjectKeyId >> record.keys.authorityKeyId
+           >> flags >> record.effectiveDate >> record.expiryDate
+           >> info.nickname >> info.importDate >> info.metadata
+           >> record.certificateOffset >> record.certificateSize
+           >> record.keyOffset >> record.keySize;
+        
+        record.keys.isCa = flags & IsCa;
+        info.trusted = flags & Trusted;
+        info.autoTrust = flags & AutoTrust;
+        m_records.insert(fingerprint, record);
+        loaded.insert(fingerprint, info);
+    }
+    
+    if (in.status() != QDataStream::Ok) {
+        m_records.clear();
+        return false;
+    }
+    
+    *certificates = loaded;
+    return true;
+}
+
+const CertificateRecord *CertificateStore::record(const QString &fingerprint) const
+{
+    auto it = m_records.constFind(fingerprint);
+    return it != m_records.constEnd() ? &it.value() : nullptr;
+}
+
+QByteArray CertificateStore::readBlob(qint64 offset, int size) const
+{
+    if (offset < 0 || size <= 0) {
+        return QByteArray();
+    }
+    
+    const QString path = blobPath(m_generation);
+    if (m_blobs.fileName() != path || !m_blobs.isOpen()) {
+        m_blobs.close();
+        m_blobs.setFileName(path);
+        if (!m_blobs.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+    }
+    
+    if (!m_blobs.seek(offset)) {
+        return QByteArray();
+    }
+    const QByteArray data = m_blobs.read(size);
+    return data.size() == size ? data : QByteArray();
+}
+
+QSslCertificate CertificateStore::certificate(const QString &fingerprint) const
+{
+    const CertificateRecord *entry = record(fingerprint);
+    if (!entry) {
+        return QSslCertificate();
+    }
+    return QSslCertificate(readBlob(entry->certificateOffset, entry->certificateSize), QSsl::Der);
+}
+
+QSslKey CertificateStore::privateKey(const QString &fingerprint) const
+{
+    const CertificateRecord *entry = record(fingerprint);
+    if (!entry || entry->keyOffset < 0) {
+        return QSslKey();
+    }
+    return QSslKey(readBlob(entry->keyOffset, entry->keySize), QSsl::Rsa);
+}
+
+bool CertificateStore::hasPrivateKey(const QString &fingerprint) const
+{
+    const CertificateRecord *entry = record(fingerprint);
+    return entry && entry->keyOffset >= 0;
+}
+
+bool CertificateStore::appendBlob(QFile &file, const QByteArray &data, qint64 *offset, int *size)
+{
+    *offset = file.size();
+    *size = data.size();
+    return file.write(data) == data.size();
+}
+
+bool CertificateStore::save(const QHash<QString, CertificateInfo> &certificates,
+                            const QHash<QString, QSslKey> &privateKeys)
+{
+    if (m_directory.isEmpty()) {
+        return false;
+    }
+    
+    QFile blobs(blobPath(m_generation));
+    if (!blobs.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    
+    // Уже записанные данные не трогаем, дописываем только новые
+    QHash<QString, CertificateRecord> records;
+    for (auto it = certificates.constBegin(); it != certificates.constEnd(); ++it) {
+        CertificateRecord record = m_records.value(it.key());
+        
+        if (record.certificateOffset < 0) {
+            const QSslCertificate &certificate = it->certificate;
+            if (certificate.isNull()) {
+                continue;
+            }
+            record.keys = CertificateKeys::fromCertificate(certificate);
+            record.effectiveDate = certificate.effectiveDate();
+            record.expiryDate = certificate.expiryDate();
+            if (!appendBlob(blobs, certificate.toDer(),
+                            &record.certificateOffset, &record.certificateSize)) {
+                return false;
+            }
+        }
+        
+        // Ключ переписывается, только если он сменился
+        auto key = privateKeys.constFind(it.key());
+        if (key != privateKeys.constEnd()) {
+            const QByteArray pem = key->toPem();
+            if (record.keyOffset < 0 || readBlob(record.keyOffset, record.keySize) != pem) {
+                if (record.keyOffset >= 0) {
+                    m_garbage += record.keySize;
+                }
+                if (!appendBlob(blobs, pem, &record.keyOffset, &record.keySize)) {
+                    return false;
+                }
+            }
+        }
+        
+        records.insert(it.key(), record);
+    }
+    const qint64 blobSize = blobs.size();
+    blobs.close();
+    
+    for (auto it = m_records.constBegin(); it != m_records.constEnd(); ++it) {
+        if (!records.contains(it.key())) {
+            m_garbage += it->certificateSize + qMax(it->keySize, 0);
+        }
+    }
+    m_records = records;
+    
+    const quint32 generation = m_generation;
+    if (m_garbage > COMPACT_THRESHOLD && m_garbage * 2 > blobSize && !compact()) {
+        return false;
+    }
+    if (!writeIndex(certificates)) {
+        return false;
+    }
+    
+    // Индекс уже указывает на новое поколение - старое можно удалять
+    if (generation != m_generation) {
+        m_blobs.close();
+        QFile::remove(blobPath(generation));
+    }
+    return true;
+}
+
+bool CertificateStore::compact()
+{
+    QSaveFile target(blobPath(m_generation + 1));
+    if (!target.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    QHash<QString, CertificateRecord> records = m_records;
+    qint64 position = 0;
+    for (auto it = records.begin(); it != records.end(); ++it) {
+        const QByteArray certificate = readBlob(it->certificateOffset, it->certificateSize);
+        const QByteArray key = readBlob(it->keyOffset, it->keySize);
+        if (certificate.isEmpty() || target.write(certificate) != certificate.size()) {
+            target.cancelWriting();
+            return false;
+        }
+        it->certificateOffset = position;
+        position += certificate.size();
+        
+        if (it->keyOffset >= 0) {
+            if (key.isEmpty() || target.write(key) != key.size()) {
+                target.cancelWriting();
+                return false;
+            }
+            it->keyOffset = position;
+            position += key.size();
+        }
+    }
+    
+    if (!target.commit()) {
+        return false;
+    }
+    
+    m_records = records;
+    m_generation += 1;
+    m_garbage = 0;
+    return true;
+}
+
+bool CertificateStore::writeIndex(const QHash<QString, CertificateInfo> &certificates)
+{
+    QSaveFile file(m_directory + "/" + INDEX_FILENAME);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(INDEX_MAGIC) << quint32(INDEX_VERSION) << m_generation << m_garbage
+        << quint32(m_records.size());
+    
+    for (auto it = m_records.constBegin(); it != m_records.constEnd(); ++it) {
+        const CertificateInfo &info = certificates[it.key()];
+        const CertificateRecord &record = it.value();
+        quint8 flags = 0;
+        if (info.trusted) {
+            flags |= Trusted;
+        }
+        if (info.autoTrust) {
+            flags |= AutoTrust;
+        }
+        if (record.keys.isCa) {
+            flags |= IsCa;
+        }
+        
+        out << it.key()
+            << record.keys.subject << record.keys.issuer
+            << record.keys.subjectKeyId << record.keys.authorityKeyId
+            << flags << record.effectiveDate << record.expiryDate
+            << info.nickname << info.importDate << info.metadata
+            << record.certificateOffset << record.certificateSize
+            << record.keyOffset << record.keySize;
+    }
+    
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
@@ -0,0 +1,76 @@
+#ifndef CERTIFICATESTORE_H
+#define CERTIFICATESTORE_H
+
+#include <QSslCertificate>
+#include <QSslKey>
+#include <QDateTime>
+#include <QHash>
+#include <QVariant>
+#include <QFile>
+#include "certificateindex.h"
+
+struct CertificateInfo {
+    QSslCertificate certificate;   // пуст, пока не загружен из хранилища
+    QString nickname;
+    QDateTime importDate;
+    bool trusted;
+    bool autoTrust;
+    QStringList trustedDomains;
+    QHash<QString, QVariant> metadata;
+};
+
+// Запись индекса: всё, что нужно без разбора сертификата
+struct CertificateRecord {
+    CertificateKeys keys;
+    QDateTime effectiveDate;
+    QDateTime expiryDate;
+    qint64 certificateOffset = -1;
+    int certificateSize = 0;
+    qint64 keyOffset = -1;
+    int keySize = 0;
+};
+
+// Двоичное хранилище сертификатов: небольшой индекс (отпечаток, хэши имён,
+// идентификаторы ключей, сроки, флаги доверия, метаданные) и файл с DER
+// сертификатов и ключами. При запуске читается только индекс, сертификат
+// разбирается при первом обращении.
+//
+// Файл данных только дописывается; индекс переписывается атомарно.
+// Когда мусора становится больше половины, данные копируются в файл
+// следующего поколения, и индекс переключается на него.
+class CertificateStore
+{
+public:
+    CertificateStore();
+    
+    // false - индекса нет или он повреждён; каталог запоминается в любом случае
+    bool open(const QString &directory, QHash<QString, CertificateInfo> *certificates);
+    bool save(const QHash<QString, CertificateInfo> &certificates,
+              const QHash<QString, QSslKey> &privateKeys);
+    
+    const CertificateRecord *record(const QString &fingerprint) const;
+    QSslCertificate certificate(const QString &fingerprint) const;
+    QSslKey privateKey(const QString &fingerprint) const;
+    bool hasPrivateKey(const QString &fingerprint) const;
+    
+    static const QString INDEX_FILENAME;
+
+private:
+    QByteArray readBlob(qint64 offset, int size) const;
+    bool appendBlob(QFile &file, const QByteArray &data, qint64 *offset, int *size);
+    bool compact();
+    bool writeIndex(const QHash<QString, CertificateInfo> &certificates);
+    QString blobPath(quint32 generation) const;
+    
+    QString m_directory;
+    QHash<QString, CertificateRecord> m_records;
+    quint32 m_generation;
+    qint64 m_garbage;
+    mutable QFile m_blobs;
+    
+    static const quint32 INDEX_MAGIC = 0x43455254; // "CERT"
+    static const quint32 INDEX_VERSION = 1;
+    static const qint64 COMPACT_THRESHOLD = 64 * 1024;
+};
+
+#endif // CERTIFICATESTORE_H
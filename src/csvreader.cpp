@@ -0,0 +1,109 @@
+#include "csvreader.h"
+#include <QIODevice>
+
+CsvReader::CsvReader(QIODevice *device)
+    : m_device(device)
+    , m_decoder(QStringDecoder::Utf8)
+    , m_position(0)
+    , m_recordNumber(0)
+    , m_error(false)
+{
+}
+
+bool CsvReader::fillBuffer()
+{
+    // Прочитанная часть буфера больше не нужна
+    if (m_position > 0) {
+        m_buffer.remove(0, m_position);
+        m_position = 0;
+    }
+    if (!m_device || m_device->atEnd()) {
+        return false;
+    }
+    
+    const QByteArray chunk = m_device->read(CHUNK_SIZE);
+    if (chunk.isEmpty()) {
+        return false;
+    }
+    m_buffer += m_decoder.decode(chunk);
+    return true;
+}
+
+bool CsvReader::peek(QChar &c)
+{
+    while (m_position >= m_buffer.size()) {
+        if (!fillBuffer()) {
+            return false;
+        }
+    }
+    c = m_buffer.at(m_position);
+    return true;
+}
+
+bool CsvReader::readRecord(QStringList &fields)
+{
+    fields.clear();
+    if (m_error) {
+        return false;
+    }
+    
+    QString field;
+    bool inQuotes = false;
+    bool quoted = false;
+    bool started = false;
+    QChar c;
+    
+    while (peek(c)) {
+        ++m_position;
+        started = true;
+        
+        if (inQuotes) {
+            if (c != QLatin1Char('"')) {
+                field += c;
+                continue;
+            }
+            // "" внутри кавычек - сама кавычка
+            QChar next;
+            if (peek(next) && next == QLatin1Char('"')) {
+                ++m_position;
+                field += c;
+            } else {
+                inQuotes = false;
+            }
+            continue;
+        }
+        
+        if (c == QLatin1Char('"') && field.isEmpty() && !quoted) {
+            inQuotes = true;
+            quoted = true;
+        } else if (c == QLatin1Char(',')) {
+            fields.append(field);
+            field.clear();
+            quoted = false;
+        } else if (c == QLatin1Char('\r') || c == QLatin1Char('\n')) {
+            QChar next;
+            if (c == QLatin1Char('\r') && peek(next) && next == QLatin1Char('\n')) {
+                ++m_position;
+            }
+            fields.append(field);
+            ++m_recordNumber;
+            return true;
+        } else {
+            field += c;
+        }
+    }
+    
+    // Незакрытая кавычка в конце файла - файл обрезан
+    if (inQuotes) {
+        m_error = true;
+        fields.clear();
+        return false;
+    }
+    if (!started) {
+        return false;
+    }
+    
+    fields.append(field);
+    ++m_recordNumber;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringDecoder>
+
+class QIODevice;
+
+// Потоковое чтение CSV по RFC 4180: поля в кавычках могут содержать
+// запятые, переводы строк и удвоенные кавычки. Файл читается кусками,
+// в памяти держится только текущая запись.
+class CsvReader
+{
+public:
+    explicit CsvReader(QIODevice *device);
+    
+    // false - конец данных или ошибка разбора (см. hasError)
+    bool readRecord(QStringList &fields);
+    bool hasError() const { return m_error; }
+    qint64 recordNumber() const { return m_recordNumber; }
+
+private:
+    bool fillBuffer();
+    bool peek(QChar &c);
+    
+    QIODevice *m_device;
+    QStringDecoder m_decoder;
+    QString m_buffer;
+    int m_position;
+    qint64 m_recordNumber;
+    bool m_error;
+    
+    static const int CHUNK_SIZE = 64 * 1024;
+};
+
+#endif // CSVREADER_H
@@ -0,0 +1,264 @@
+#include "faviconstore.h"
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QPixmap>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+#include <QSet>
+
+const QString FaviconStore::STORE_DIRECTORY = "favicons";
+const QString FaviconStore::INDEX_FILENAME = "origins.json";
+
+FaviconStore *FaviconStore::instance()
+{
+    static FaviconStore *store = new FaviconStore(QCoreApplication::instance());
+    return store;
+}
+
+FaviconStore::FaviconStore(QObject *parent)
+    : QObject(parent)
+    , m_cache(DEFAULT_CACHE_LIMIT)
+    , m_saveTimer(new QTimer(this))
+    , m_releaseTimer(new QTimer(this))
+{
+    m_storePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+                  "/" + STORE_DIRECTORY;
+    QDir().mkpath(m_storePath);
+    
+    // Индекс пишется не чаще раза в SAVE_DELAY
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(SAVE_DELAY);
+    connect(m_saveTimer, &QTimer::timeout, this, &FaviconStore::saveIndex);
+    
+    // Удаления пачкой: массовое удаление закладок или истории даёт один проход
+    m_releaseTimer->setSingleShot(true);
+    m_releaseTimer->setInterval(RELEASE_DELAY);
+    connect(m_releaseTimer, &QTimer::timeout, this, &FaviconStore::removeReleasedIcons);
+    
+    loadIndex();
+}
+
+FaviconStore::~FaviconStore()
+{
+    if (m_saveTimer->isActive()) {
+        saveIndex();
+    }
+}
+
+QIcon FaviconStore::storeIcon(const QUrl &pageUrl, const QIcon &icon)
+{
+    if (icon.isNull()) {
+        return icon;
+    }
+    
+    QByteArray imageData;
+    QBuffer buffer(&imageData);
+    buffer.open(QIODevice::WriteOnly);
+    if (!icon.pixmap(ICON_SIZE, ICON_SIZE).save(&buffer, "PNG")) {
+        return icon;
+    }
+    
+    QString hash = storeIconData(pageUrl, imageData);
+    return hash.isEmpty() ? icon : this->icon(hash);
+}
+
+QString FaviconStore::storeIconData(const QUrl &pageUrl, const QByteArray &imageData)
+{
+    if (imageData.isEmpty()) {
+        return QString();
+    }
+    
+    QString hash = QCryptographicHash::hash(imageData, QCryptographicHash::Sha256).toHex();
+    
+    // Одинаковые изображения разных сайтов записываются один раз
+    QString path = iconPath(hash);
+    if (!QFile::exists(path)) {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return QString();
+        }
+        file.write(imageData);
+        if (!file.commit()) {
+            return QString();
+        }
+    }
+    
+    QString origin = originOf(pageUrl);
+    if (!origin.isEmpty() && m_originToHash.value(origin) != hash) {
+        m_originToHash.insert(origin, hash);
+        scheduleSave();
+        emit iconChanged(origin, hash);
+    }
+    
+    return hash;
+}
+
+QIcon FaviconStore::iconForUrl(const QUrl &pageUrl)
+{
+    QString hash = hashForUrl(pageUrl);
+    return hash.isEmpty() ? QIcon() : icon(hash);
+}
+
+QIcon FaviconStore::icon(const QString &hash)
+{
+    if (QIcon *cached = m_cache.object(hash)) {
+        return *cached;
+    }
+    
+    // Декодируем с диска и кладём в кэш
+    QPixmap pixmap;
+    if (!pixmap.load(iconPath(hash), "PNG")) {
+        return QIcon();
+    }
+    return cacheIcon(hash, pixmap);
+}
+
+QString FaviconStore::hashForUrl(const QUrl &pageUrl) const
+{
+    return m_originToHash.value(originOf(pageUrl));
+}
+
+void FaviconStore::addUsageCheck(QObject *owner, const UsageCheck &check)
+{
+    m_usageChecks.insert(owner, check);
+    connect(owner, &QObject::destroyed, this, [this, owner]() {
+        m_usageChecks.remove(owner);
+    });
+}
+
+void FaviconStore::releaseUrl(const QUrl &pageUrl)
+{
+    const QString origin = originOf(pageUrl);
+    if (origin.isEmpty() || !m_originToHash.contains(origin)) {
+        return;
+    }
+    
+    m_releasedOrigins.insert(origin);
+    m_releaseTimer->start();
+}
+
+void FaviconStore::releaseAll()
+{
+    const QList<QString> origins = m_originToHash.keys();
+    m_releasedOrigins.unite(QSet<QString>(origins.begin(), origins.end()));
+    m_releaseTimer->start();
+}
+
+void FaviconStore::removeReleasedIcons()
+{
+    m_releaseTimer->stop();
+    
+    QSet<QString> unused;
+    unused.swap(m_releasedOrigins);
+    for (auto it = m_usageChecks.cbegin(); it != m_usageChecks.cend() && !unused.isEmpty(); ++it) {
+        unused.subtract(it.value()(unused));
+    }
+    if (unused.isEmpty()) {
+        return;
+    }
+    
+    for (const QString &origin : std::as_const(unused)) {
+        m_originToHash.remove(origin);
+    }
+    
+    // Индекс пишется раньше удаления файлов, чтобы не ссылаться на удалённые
+    saveIndex();
+    removeUnusedIcons();
+}
+
+void FaviconStore::setCacheLimit(int bytes)
+{
+    m_cache.setMaxCost(bytes);
+}
+
+void FaviconStore::removeUnusedIcons()
+{
+    const QList<QString> used = m_originToHash.values();
+    const QSet<QString> usedHashes(used.begin(), used.end());
+    
+    QDir dir(m_storePath);
+    const QStringList files = dir.entryList(QStringList() << "*.png", QDir::Files);
+    for (const QString &fileName : files) {
+        QString hash = fileName.chopped(4);
+        if (!usedHashes.contains(hash)) {
+            m_cache.remove(hash);
+            dir.remove(fileName);
+        }
+    }
+}
+
+void FaviconStore::clear()
+{
+    m_releaseTimer->stop();
+    m_releasedOrigins.clear();
+    m_cache.clear();
+    m_originToHash.clear();
+    saveIndex();
+    removeUnusedIcons();
+}
+
+QString FaviconStore::originOf(const QUrl &url)
+{
+    if (!url.isValid() || url.host().isEmpty()) {
+        return QString();
+    }
+    return url.adjusted(QUrl::RemoveUserInfo | QUrl::RemovePath |
+                        QUrl::RemoveQuery | QUrl::RemoveFragment).toString();
+}
+
+QString FaviconStore::iconPath(const QString &hash) const
+{
+    return m_storePath + "/" + hash + ".png";
+}
+
+QIcon FaviconStore::cacheIcon(const QString &hash, const QPixmap &pixmap)
+{
+    QIcon *icon = new QIcon(pixmap);
+    int cost = qMax(1, pixmap.width() * pixmap.height() * 4);
+    
+    QIcon result = *icon;
+    m_cache.insert(hash, icon, cost);
+    return result;
+}
+
+void FaviconStore::loadIndex()
+{
+    QFile file(m_storePath + "/" + INDEX_FILENAME);
+    if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    
+    QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.begin(); it != root.end(); ++it) {
+        m_originToHash.insert(it.key(), it.value().toString());
+    }
+}
+
+void FaviconStore::saveIndex()
+{
+    m_saveTimer->stop();
+    
+    QJsonObject root;
+    for (auto it = m_originToHash.begin(); it != m_originToHash.end(); ++it) {
+        root[it.key()] = it.value();
+    }
+    
+    QSaveFile file(m_storePath + "/" + INDEX_FILENAME);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+void FaviconStore::scheduleSave()
+{
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef FAVICONSTORE_H
+#define FAVICONSTORE_H
+
+#include <QObject>
+#include <QIcon>
+#include <QUrl>
+#include <QHash>
+#include <QSet>
+#include <QCache>
+#include <functional>
+
+class QTimer;
+
+// Общее хранилище иконок сайтов для вкладок, истории и закладок.
+// Изображения хранятся на диске один раз по хэшу содержимого,
+// декодированные иконки держатся в ограниченном LRU-кэше.
+class FaviconStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FaviconStore *instance();
+    ~FaviconStore();
+
+    // Сохранение иконки страницы, возвращает общий экземпляр иконки
+    QIcon storeIcon(const QUrl &pageUrl, const QIcon &icon);
+    QString storeIconData(const QUrl &pageUrl, const QByteArray &imageData);
+    
+    // Получение иконок
+    QIcon iconForUrl(const QUrl &pageUrl);
+    QIcon icon(const QString &hash);
+    QString hashForUrl(const QUrl &pageUrl) const;
+    
+    // Владельцы ссылок (закладки, история) сообщают, какие из переданных
+    // источников они ещё используют. Проверка снимается вместе с owner.
+    using UsageCheck = std::function<QSet<QString>(const QSet<QString> &origins)>;
+    void addUsageCheck(QObject *owner, const UsageCheck &check);
+    
+    // Владелец удалил ссылки на страницу или на всё сразу: иконки источников,
+    // которые больше никто не использует, удаляются отложенно
+    void releaseUrl(const QUrl &pageUrl);
+    void releaseAll();
+    void removeReleasedIcons();
+    
+    // Управление
+    void setCacheLimit(int bytes);
+    void removeUnusedIcons();
+    void clear();
+    
+    static QString originOf(const QUrl &url);
+
+signals:
+    void iconChanged(const QString &origin, const QString &hash);
+
+private:
+    explicit FaviconStore(QObject *parent = nullptr);
+    
+    QString iconPath(const QString &hash) const;
+    QIcon cacheIcon(const QString &hash, const QPixmap &pixmap);
+    void loadIndex();
+    void saveIndex();
+    void scheduleSave();
+    
+    QString m_storePath;
+    QHash<QString, QString> m_originToHash;
+    QCache<QString, QIcon> m_cache;
+    QTimer *m_saveTimer;
+    QTimer *m_releaseTimer;
+    QHash<QObject *, UsageCheck> m_usageChecks;
+    QSet<QString> m_releasedOrigins;
+    
+    static const QString STORE_DIRECTORY;
+    static const QString INDEX_FILENAME;
+    static const int ICON_SIZE = 32;
+    static const int DEFAULT_CACHE_LIMIT = 4 * 1024 * 1024; // байт
+    static const int SAVE_DELAY = 2000; // мс
+    static const int RELEASE_DELAY = 5000; // мс
+};
+
+#endif // FAVICONSTORE_H
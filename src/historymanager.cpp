@@ -6,19 +6,56 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QUrl>
+#include <QTimer>
+#include <QDebug>
+#include "faviconstore.h"
+#include <QtConcurrent>
+#include <limits>
 
 const QString HistoryManager::DATABASE_NAME = "browser_history.db";
 const int HistoryManager::MAX_TITLE_LENGTH = 1000;
 const int HistoryManager::MAX_URL_LENGTH = 2048;
+const double HistoryManager::REFERRER_WEIGHT = 1.0;
+const double HistoryManager::SESSION_WEIGHT = 0.5;
+const double HistoryManager::RELATION_DECAY_FACTOR = 0.95;
+const double HistoryManager::MIN_RELATION_WEIGHT = 0.05;
 
 HistoryManager::HistoryManager(QObject *parent)
     : QObject(parent)
+    , m_lastSessionVisit(0)
 {
     initializeDatabase();
+    
+    // Затухание и обрезка графа связей выполняются в фоне: один раз
+    // вскоре после запуска (короткие сессии тоже ограничивают таблицу)
+    // и затем периодически
+    QTimer *decayTimer = new QTimer(this);
+    connect(decayTimer, &QTimer::timeout, this, &HistoryManager::decayRelations);
+    decayTimer->start(RELATION_DECAY_INTERVAL);
+    QTimer::singleShot(RELATION_DECAY_STARTUP_DELAY, this, &HistoryManager::decayRelations);
+    
+    // Иконки сайтов, оставшихся в истории, не удаляются при чистке хранилища.
+    // Диапазон по индексу url: origin + "/" <= url < origin + "0"
+    FaviconStore::instance()->addUsageCheck(this, [this](const QSet<QString> &origins) {
+        QSet<QString> used;
+        QSqlQuery query(m_db);
+        query.prepare("SELECT 1 FROM visits WHERE url = ? OR (url >= ? AND url < ?) LIMIT 1");
+        for (const QString &origin : origins) {
+            query.bindValue(0, origin);
+            query.bindValue(1, origin + "/");
+            query.bindValue(2, origin + "0");
+            if (query.exec() && query.next()) {
+                used.insert(origin);
+            }
+        }
+        return used;
+    });
 }
 
 HistoryManager::~HistoryManager()
 {
+    // Фоновое затухание пишет в ту же базу
+    m_decayFuture.waitForFinished();
     if (m_db.isOpen()) {
         m_db.close();
     }
@@ -31,6 +68,8 @@ void HistoryManager::initializeDatabase()
     
     m_db = QSqlDatabase::addDatabase("QSQLITE");
     m_db.setDatabaseName(path + "/" + DATABASE_NAME);
+    // Пока фоновое соединение держит блокировку, запись ждёт, а не падает
+    m_db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(DATABASE_BUSY_TIMEOUT));
     
     if (!m_db.open()) {
         emit databaseError(m_db.lastError().text());
@@ -65,11 +104,24 @@ void HistoryManager::initializeDatabase()
         return;
     }
     
+    // Таблица page_relations (граф совместных посещений)
+    if (!query.exec("CREATE TABLE IF NOT EXISTS page_relations ("
+                   "source TEXT NOT NULL,"
+                   "target TEXT NOT NULL,"
+                   "weight REAL NOT NULL,"
+                   "last_seen INTEGER NOT NULL,"
+                   "PRIMARY KEY (source, target)"
+                   ") WITHOUT ROWID")) {
+        emit databaseError(query.lastError().text());
+        return;
+    }
+    
     // Индексы для ускорения поиска
     query.exec("CREATE INDEX IF NOT EXISTS idx_visits_url ON visits(url)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_visits_time ON visits(visit_time)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_visit_details_url ON visit_details(url)");
     query.exec("CREATE INDEX IF NOT EXISTS idx_visit_details_time ON visit_details(visit_time)");
+    query.exec("CREATE INDEX IF NOT EXISTS idx_relations_weight ON page_relations(source, weight DESC)");
 }
 
 void HistoryManager::addVisit(const QString &url, const QString &title,
@@ -137,9 +189,128 @@ void HistoryManager::addVisit(const QString &url, const QString &title,
         return;
     }
     
+    updateRelations(url, referrer, timestamp);
+    
     emit visitAdded(url, title);
 }
 
+void HistoryManager::updateRelations(const QString &url, const QString &referrer,
+                                     qint64 timestamp)
+{
+    // Переход по ссылке - самая сильная связь
+    if (!referrer.isEmpty() && referrer != url) {
+        recordRelation(referrer, url, REFERRER_WEIGHT, timestamp);
+    }
+    
+    // Страницы, открытые в рамках одной сессии, связаны слабее
+    if (!m_lastSessionUrl.isEmpty() && m_lastSessionUrl != url &&
+        m_lastSessionUrl != referrer &&
+        timestamp - m_lastSessionVisit <= SESSION_GAP_SECS) {
+        recordRelation(m_lastSessionUrl, url, SESSION_WEIGHT, timestamp);
+    }
+    
+    m_lastSessionUrl = url;
+    m_lastSessionVisit = timestamp;
+}
+
+void HistoryManager::recordRelation(const QString &source, const QString &target,
+                                    double weight, qint64 timestamp)
+{
+    QSqlQuery query(m_db);
+    query.prepare("INSERT INTO page_relations (source, target, weight, last_seen) "
+                 "VALUES (?, ?, ?, ?) "
+                 "ON CONFLICT(source, target) DO UPDATE SET "
+                 "weight = weight + excluded.weight, last_seen = excluded.last_seen");
+    
+    // Связь симметрична, храним оба направления для поиска одним индексом
+    const QStringList sources = {source, target};
+    const QStringList targets = {target, source};
+    for (int i = 0; i < 2; ++i) {
+        query.addBindValue(sources[i]);
+        query.addBindValue(targets[i]);
+        query.addBindValue(weight);
+        query.addBindValue(timestamp);
+        
+        if (!query.exec()) {
+            emit databaseError(query.lastError().text());
+            return;
+        }
+    }
+}
+
+QList<HistoryItem> HistoryManager::getRelatedPages(const QString &url) const
+{
+    QList<HistoryItem> result;
+    
+    QSqlQuery query(m_db);
+    query.prepare("SELECT v.url, v.title, v.visit_time, v.visit_count, v.last_visit_time "
+                 "FROM page_relations r JOIN visits v ON v.url = r.target "
+                 "WHERE r.source = ? ORDER BY r.weight DESC LIMIT ?");
+    query.addBindValue(url);
+    query.addBindValue(MAX_RELATED_PAGES);
+    
+    if (query.exec()) {
+        while (query.next()) {
+            HistoryItem item;
+            item.url = query.value(0).toString();
+            item.title = query.value(1).toString();
+            item.visitTime = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
+            item.visitCount = query.value(3).toInt();
+            item.lastVisitTime = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+            item.favicon = FaviconStore::instance()->hashForUrl(QUrl(item.url));
+            result.append(item);
+        }
+    }
+    
+    return result;
+}
+
+void HistoryManager::decayRelations()
+{
+    if (m_decayFuture.isRunning()) {
+        return;
+    }
+    const QString databaseName = m_db.databaseName();
+    
+    m_decayFuture = QtConcurrent::run([databaseName]() {
+        // Соединение SQLite нельзя делить между потоками, открываем своё
+        const QString connectionName = "history_relations_decay";
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+            db.setDatabaseName(databaseName);
+            db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(DATABASE_BUSY_TIMEOUT));
+            if (!db.open()) {
+                qWarning() << "Failed to open history database for decay:"
+                           << db.lastError().text();
+            } else {
+                QSqlQuery query(db);
+                db.transaction();
+                
+                query.prepare("UPDATE page_relations SET weight = weight * ?");
+                query.addBindValue(RELATION_DECAY_FACTOR);
+                query.exec();
+                
+                query.prepare("DELETE FROM page_relations WHERE weight < ?");
+                query.addBindValue(MIN_RELATION_WEIGHT);
+                query.exec();
+                
+                // Оставляем только самые сильные связи для каждой страницы
+                query.prepare("DELETE FROM page_relations WHERE (source, target) IN ("
+                             "SELECT source, target FROM ("
+                             "SELECT source, target, ROW_NUMBER() OVER ("
+                             "PARTITION BY source ORDER BY weight DESC) AS relation_rank "
+                             "FROM page_relations) WHERE relation_rank > ?)");
+                query.addBindValue(MAX_RELATIONS_PER_PAGE);
+                query.exec();
+                
+                db.commit();
+                db.close();
+            }
+        }
+        QSqlDatabase::removeDatabase(connectionName);
+    });
+}
+
 QList<HistoryItem> HistoryManager::getHistory(const QDateTime &start,
                                             const QDateTime &end,
                                             int limit) const
@@ -172,6 +343,7 @@ QList<HistoryItem> HistoryManager::getHistory(const QDateTime &start,
             item.visitTime = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
             item.visitCount = query.value(3).toInt();
             item.lastVisitTime = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+            item.favicon = FaviconStore::instance()->hashForUrl(QUrl(item.url));
             result.append(item);
         }
     }
@@ -209,6 +381,7 @@ QList<HistoryItem> HistoryManager::searchHistory(const QString &text, int limit)
             item.visitTime = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
             item.visitCount = query.value(3).toInt();
             item.lastVisitTime = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+            item.favicon = FaviconStore::instance()->hashForUrl(QUrl(item.url));
             result.append(item);
         }
     }
@@ -238,34 +411,69 @@ void HistoryManager::deleteUrl(const QString &url)
         return;
     }
     
+    // Удаляем связи страницы в обоих направлениях
+    query.prepare("DELETE FROM page_relations WHERE source = ? OR target = ?");
+    query.addBindValue(url);
+    query.addBindValue(url);
+    
+    if (!query.exec()) {
+        emit databaseError(query.lastError().text());
+        return;
+    }
+    
+    if (m_lastSessionUrl == url) {
+        m_lastSessionUrl.clear();
+    }
+    
+    FaviconStore::instance()->releaseUrl(QUrl(url));
     emit urlDeleted(url);
 }
 
 void HistoryManager::deleteTimeRange(const QDateTime &start, const QDateTime &end)
 {
+    const qint64 from = start.isValid() ? start.toSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+    const qint64 to = end.isValid() ? end.toSecsSinceEpoch() : std::numeric_limits<qint64>::max();
     QSqlQuery query(m_db);
-    QString sql = "DELETE FROM visits WHERE 1=1";
     
-    if (start.isValid()) {
-        sql += " AND visit_time >= " + QString::number(start.toSecsSinceEpoch());
+    // Адреса запоминаем до удаления, чтобы освободить их иконки
+    QSet<QString> urls;
+    query.prepare("SELECT DISTINCT url FROM visits WHERE visit_time >= ? AND visit_time <= ?");
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (query.exec()) {
+        while (query.next()) {
+            urls.insert(query.value(0).toString());
+        }
     }
     
-    if (end.isValid()) {
-        sql += " AND visit_time <= " + QString::number(end.toSecsSinceEpoch());
+    query.prepare("DELETE FROM visits WHERE visit_time >= ? AND visit_time <= ?");
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (!query.exec()) {
+        emit databaseError(query.lastError().text());
+        return;
     }
     
-    if (!query.exec(sql)) {
+    query.prepare("DELETE FROM visit_details WHERE visit_time >= ? AND visit_time <= ?");
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (!query.exec()) {
         emit databaseError(query.lastError().text());
         return;
     }
     
-    sql = sql.replace("visits", "visit_details");
-    
-    if (!query.exec(sql)) {
+    // Связи, последний раз подтверждённые в этом интервале
+    query.prepare("DELETE FROM page_relations WHERE last_seen >= ? AND last_seen <= ?");
+    query.addBindValue(from);
+    query.addBindValue(to);
+    if (!query.exec()) {
         emit databaseError(query.lastError().text());
         return;
     }
     
+    for (const QString &url : std::as_const(urls)) {
+        FaviconStore::instance()->releaseUrl(QUrl(url));
+    }
     emit historyRangeDeleted(start, end);
 }
 
@@ -285,10 +493,18 @@ void HistoryManager::clearHistory()
         return;
     }
     
+    // Очищаем граф связей
+    if (!query.exec("DELETE FROM page_relations")) {
+        emit databaseError(query.lastError().text());
+        return;
+    }
+    m_lastSessionUrl.clear();
+    
     // Сбрасываем автоинкремент
     query.exec("DELETE FROM sqlite_sequence WHERE name='visits'");
     query.exec("DELETE FROM sqlite_sequence WHERE name='visit_details'");
     
+    FaviconStore::instance()->releaseAll();
     emit historyCleared();
 }
 
@@ -312,6 +528,7 @@ QList<HistoryItem> HistoryManager::getMostVisited(int limit) const
             item.visitTime = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
             item.visitCount = query.value(3).toInt();
             item.lastVisitTime = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+            item.favicon = FaviconStore::instance()->hashForUrl(QUrl(item.url));
             result.append(item);
         }
     }
@@ -339,6 +556,7 @@ QList<HistoryItem> HistoryManager::getRecentlyVisited(int limit) const
             item.visitTime = QDateTime::fromSecsSinceEpoch(query.value(2).toLongLong());
             item.visitCount = query.value(3).toInt();
             item.lastVisitTime = QDateTime::fromSecsSinceEpoch(query.value(4).toLongLong());
+            item.favicon = FaviconStore::instance()->hashForUrl(QUrl(item.url));
             result.append(item);
         }
     }
@@ -8,6 +8,7 @@
 #include <QSqlQuery>
 #include <QHash>
 #include <QVariant>
+#include <QFuture>
 
 struct HistoryItem {
     qint64 id;
@@ -15,7 +16,7 @@ struct HistoryItem {
     QString title;
     QDateTime timestamp;
     int visitCount;
-    QString favicon;
+    QString favicon; // хэш иконки в FaviconStore
     QString description;
     QHash<QString, QVariant> metadata;
     bool isBookmarked;
@@ -35,6 +36,8 @@ public:
     bool removeVisit(qint64 id);
     bool removeVisits(const QDateTime &begin, const QDateTime &end);
     bool clearHistory();
+    void deleteUrl(const QString &url);
+    void deleteTimeRange(const QDateTime &start, const QDateTime &end);
     
     // Поиск и получение истории
     QList<HistoryItem> getVisits(const QDateTime &begin, const QDateTime &end) const;
@@ -78,6 +81,7 @@ private slots:
     void performAutoCleanup();
     void handleDatabaseError(const QString &error);
     void syncWithCloudImpl();
+    void decayRelations();
 
 private:
     bool initDatabase();
@@ -90,6 +94,9 @@ private:
     bool isUrlValid(const QString &url) const;
     void updateVisitCount(const QString &url);
     void mergeHistoryItems(const QList<HistoryItem> &items);
+    void recordRelation(const QString &source, const QString &target,
+                        double weight, qint64 timestamp);
+    void updateRelations(const QString &url, const QString &referrer, qint64 timestamp);
     
     QSqlDatabase m_db;
     int m_retentionDays;
@@ -99,11 +106,26 @@ private:
     QDateTime m_lastCleanup;
     QDateTime m_lastSync;
     QHash<QString, int> m_visitCache;
+    QString m_lastSessionUrl;
+    qint64 m_lastSessionVisit;
+    QFuture<void> m_decayFuture;
     
     static const int DATABASE_VERSION = 2;
     static const QString DATABASE_NAME;
     static const int DEFAULT_RETENTION_DAYS = 90;
     static const int DEFAULT_MAX_ENTRIES = 10000;
+    
+    // Граф совместных посещений
+    static const int SESSION_GAP_SECS = 30 * 60;
+    static const int MAX_RELATED_PAGES = 10;
+    static const int MAX_RELATIONS_PER_PAGE = 50;
+    static const int RELATION_DECAY_INTERVAL = 6 * 60 * 60 * 1000; // мс
+    static const int RELATION_DECAY_STARTUP_DELAY = 60 * 1000;     // мс
+    static const int DATABASE_BUSY_TIMEOUT = 5000;                 // мс
+    static const double REFERRER_WEIGHT;
+    static const double SESSION_WEIGHT;
+    static const double RELATION_DECAY_FACTOR;
+    static const double MIN_RELATION_WEIGHT;
 };
 
 #endif // HISTORYMANAGER_H 
\ No newline at end of file
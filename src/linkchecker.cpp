@@ -0,0 +1,168 @@
+#include "linkchecker.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+
+LinkChecker::LinkChecker(QObject *parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+    , m_pendingCount(0)
+    , m_maxConcurrent(DEFAULT_MAX_CONCURRENT)
+    , m_maxPerHost(DEFAULT_MAX_PER_HOST)
+    , m_timeout(DEFAULT_TIMEOUT)
+{
+}
+
+LinkChecker::~LinkChecker()
+{
+    abort();
+}
+
+void LinkChecker::setMaxConcurrent(int count)
+{
+    m_maxConcurrent = qMax(1, count);
+}
+
+void LinkChecker::setMaxPerHost(int count)
+{
+    m_maxPerHost = qMax(1, count);
+}
+
+void LinkChecker::setTimeout(int msecs)
+{
+    m_timeout = msecs;
+}
+
+void LinkChecker::enqueue(const QString &id, const QUrl &url)
+{
+    Job job;
+    job.id = id;
+    job.url = url;
+    job.host = url.host().toLower();
+    job.useGet = false;
+    
+    QQueue<Job> &jobs = m_pending[job.host];
+    if (jobs.isEmpty()) {
+        m_hostOrder.enqueue(job.host);
+    }
+    jobs.enqueue(job);
+    ++m_pendingCount;
+    
+    dispatch();
+}
+
+void LinkChecker::abort()
+{
+    m_pending.clear();
+    m_hostOrder.clear();
+    m_pendingCount = 0;
+    
+    const QList<QNetworkReply *> replies = m_running.keys();
+    m_running.clear();
+    m_activePerHost.clear();
+    for (QNetworkReply *reply : replies) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+bool LinkChecker::isRunning() const
+{
+    return !m_running.isEmpty() || m_pendingCount > 0;
+}
+
+void LinkChecker::dispatch()
+{
+    // Хосты обходятся по кругу, чтобы один крупный сайт не занимал все слоты
+    int attempts = m_hostOrder.size();
+    while (m_running.size() < m_maxConcurrent && attempts-- > 0) {
+        const QString host = m_hostOrder.dequeue();
+        if (m_activePerHost.value(host) >= m_maxPerHost) {
+            m_hostOrder.enqueue(host);
+            continue;
+        }
+        
+        auto it = m_pending.find(host);
+        const Job job = it->dequeue();
+        if (it->isEmpty()) {
+            m_pending.erase(it);
+        } else {
+            m_hostOrder.enqueue(host);
+        }
+        --m_pendingCount;
+        
+        start(job);
+        attempts = m_hostOrder.size();
+    }
+}
+
+void LinkChecker::start(const Job &job)
+{
+    QNetworkRequest request(job.url);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                         QNetworkRequest::ManualRedirectPolicy);
+    request.setTransferTimeout(m_timeout);
+    
+    QNetworkReply *reply;
+    if (job.useGet) {
+        // Тело не нужно: просим один байт и обрываем после заголовков
+        request.setRawHeader("Range", "bytes=0-0");
+        reply = m_network->get(request);
+        connect(reply, &QNetworkReply::metaDataChanged, reply, [reply]() {
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+                reply->abort();
+            }
+        });
+    } else {
+        reply = m_network->head(request);
+    }
+    
+    m_running.insert(reply, job);
+    m_activePerHost[job.host]++;
+    connect(reply, &QNetworkReply::finished, this, &LinkChecker::handleFinished);
+}
+
+void LinkChecker::handleFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !m_running.contains(reply)) {
+        return;
+    }
+    reply->deleteLater();
+    
+    Job job = m_running.take(reply);
+    const int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    
+    // Серверы без поддержки HEAD отвечают 405 или 501 - перепроверяем
+    // через GET, не освобождая слот хоста. Остальные ошибки окончательны.
+    if (!job.useGet && (status == 405 || status == 501)) {
+        job.useGet = true;
+        m_activePerHost[job.host]--;
+        start(job);
+        return;
+    }
+    
+    if (--m_activePerHost[job.host] <= 0) {
+        m_activePerHost.remove(job.host);
+    }
+    
+    LinkCheckResult result;
+    result.id = job.id;
+    result.url = job.url;
+    result.httpStatus = status;
+    if (status == 0) {
+        result.errorString = reply->errorString();
+    }
+    if (status >= 300 && status < 400) {
+        result.redirectTarget = job.url.resolved(
+            reply->header(QNetworkRequest::LocationHeader).toUrl());
+        result.permanentRedirect = status == 301 || status == 308;
+    }
+    
+    emit checked(result);
+    
+    dispatch();
+    if (!isRunning()) {
+        emit finished();
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef LINKCHECKER_H
+#define LINKCHECKER_H
+
+#include <QObject>
+#include <QUrl>
+#include <QHash>
+#include <QQueue>
+#include <QNetworkReply>
+
+class QNetworkAccessManager;
+
+struct LinkCheckResult {
+    QString id;
+    QUrl url;
+    int httpStatus = 0;          // 0 - ответа не было
+    QString errorString;
+    QUrl redirectTarget;
+    bool permanentRedirect = false;
+    
+    // 401/403/429 означают, что страница существует, но закрыта или занята
+    bool isBroken() const {
+        return httpStatus == 0 || (httpStatus >= 400 && httpStatus != 401 &&
+                                   httpStatus != 403 && httpStatus != 429);
+    }
+};
+
+// Проверка доступности ссылок через один QNetworkAccessManager: соединения
+// переиспользуются, число одновременных запросов ограничено глобально и для
+// каждого хоста. Сначала отправляется HEAD, при 405/501 - GET первого байта.
+class LinkChecker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LinkChecker(QObject *parent = nullptr);
+    ~LinkChecker();
+    
+    void setMaxConcurrent(int count);
+    void setMaxPerHost(int count);
+    void setTimeout(int msecs);
+    QNetworkAccessManager *networkManager() const { return m_network; }
+    
+    void enqueue(const QString &id, const QUrl &url);
+    void abort();
+    bool isRunning() const;
+    int pendingCount() const { return m_pendingCount; }
+
+signals:
+    void checked(const LinkCheckResult &result);
+    void finished();
+
+private slots:
+    void handleFinished();
+
+private:
+    struct Job {
+        QString id;
+        QUrl url;
+        QString host;
+        bool useGet;
+    };
+    
+    void dispatch();
+    void start(const Job &job);
+    
+    QNetworkAccessManager *m_network;
+    QHash<QString, QQueue<Job>> m_pending;   // хост -> ожидающие проверки
+    QQueue<QString> m_hostOrder;             // хосты с ожидающими, по кругу
+    QHash<QString, int> m_activePerHost;
+    QHash<QNetworkReply *, Job> m_running;
+    int m_pendingCount;
+    int m_maxConcurrent;
+    int m_maxPerHost;
+    int m_timeout;
+    
+    static const int DEFAULT_MAX_CONCURRENT = 16;
+    static const int DEFAULT_MAX_PER_HOST = 2;
+    static const int DEFAULT_TIMEOUT = 15000;
+};
+
+#endif // LINKCHECKER_H
@@ -20,9 +20,14 @@
 #include <QSpinBox>
 #include <QLabel>
 #include <QTabWidget>
+#include "faviconstore.h"
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , bookmarksMenuFixedActions(0)
+    , historyMenuFixedActions(0)
+    , bookmarksMenuDirty(true)
+    , historyMenuDirty(true)
     , settings("MyBrowser", "Browser")
     , currentZoom(1.0)
     , darkMode(false)
@@ -180,12 +185,18 @@ void MainWindow::createMenus()
     bookmarksMenu->addAction("Импорт закладок...", this, &MainWindow::importBookmarks);
     bookmarksMenu->addAction("Экспорт закладок...", this, &MainWindow::exportBookmarks);
     bookmarksMenu->addSeparator();
+    bookmarksMenuFixedActions = bookmarksMenu->actions().size();
+    
+    // Пункты закладок создаются только при открытии меню
+    connect(bookmarksMenu, &QMenu::aboutToShow, this, &MainWindow::populateBookmarksMenu);
     
     // Меню История
     historyMenu = menuBar()->addMenu("История");
     historyMenu->addAction("Показать историю", this, &MainWindow::showHistory, QKeySequence("Ctrl+H"));
     historyMenu->addAction("Очистить историю", this, &MainWindow::clearHistory);
     historyMenu->addSeparator();
+    historyMenuFixedActions = historyMenu->actions().size();
+    connect(historyMenu, &QMenu::aboutToShow, this, &MainWindow::populateHistoryMenu);
     
     // Меню Инструменты
     QMenu *toolsMenu = menuBar()->addMenu("Инструменты");
@@ -359,12 +370,7 @@ void MainWindow::addBookmark()
     
     Bookmark bookmark{url, title};
     bookmarks.append(bookmark);
-    
-    QAction *action = new QAction(title, this);
-    connect(action, &QAction::triggered, this, [this, url]() {
-        webView->setUrl(QUrl(url));
-    });
-    bookmarksMenu->addAction(action);
+    bookmarksMenuDirty = true;
     
     settings.setValue("bookmarks", QVariant::fromValue(bookmarks));
 }
@@ -376,7 +382,8 @@ void MainWindow::showHistory()
     QVBoxLayout *layout = new QVBoxLayout(&dialog);
     
     for (const auto &entry : history) {
-        QPushButton *button = new QPushButton(entry.title + "\n" + entry.url, &dialog);
+        QPushButton *button = new QPushButton(FaviconStore::instance()->iconForUrl(QUrl(entry.url)),
+                                              entry.title + "\n" + entry.url, &dialog);
         connect(button, &QPushButton::clicked, this, [this, entry]() {
             webView->setUrl(QUrl(entry.url));
         });
@@ -389,9 +396,82 @@ void MainWindow::showHistory()
 void MainWindow::clearHistory()
 {
     history.clear();
+    historyMenuDirty = true;
     settings.remove("history");
 }
 
+void MainWindow::populateBookmarksMenu()
+{
+    if (!bookmarksMenuDirty) {
+        return;
+    }
+    
+    clearDynamicActions(bookmarksMenu, bookmarksMenuFixedActions);
+    fillBookmarksMenu(bookmarksMenu);
+    bookmarksMenuDirty = false;
+}
+
+void MainWindow::populateHistoryMenu()
+{
+    if (!historyMenuDirty) {
+        return;
+    }
+    
+    clearDynamicActions(historyMenu, historyMenuFixedActions);
+    fillHistoryMenu(historyMenu);
+    historyMenuDirty = false;
+}
+
+void MainWindow::fillBookmarksMenu(QMenu *menu)
+{
+    int end = qMin(int(MAX_MENU_ITEMS), int(bookmarks.size()));
+    for (int i = 0; i < end; ++i) {
+        const Bookmark &bookmark = bookmarks.at(i);
+        QString url = bookmark.url;
+        menu->addAction(FaviconStore::instance()->iconForUrl(QUrl(url)), bookmark.title,
+                        this, [this, url]() {
+            webView->setUrl(QUrl(url));
+        });
+    }
+    
+    // Остальное доступно в окне закладок, а не в цепочке подменю
+    if (end < bookmarks.size()) {
+        menu->addAction("Показать все…", this, &MainWindow::showBookmarks);
+    }
+}
+
+void MainWindow::fillHistoryMenu(QMenu *menu)
+{
+    // Последние посещения показываются первыми
+    int end = qMin(int(MAX_MENU_ITEMS), int(history.size()));
+    for (int i = 0; i < end; ++i) {
+        const HistoryEntry &entry = history.at(history.size() - 1 - i);
+        QString url = entry.url;
+        menu->addAction(FaviconStore::instance()->iconForUrl(QUrl(url)),
+                        entry.title.isEmpty() ? url : entry.title,
+                        this, [this, url]() {
+            webView->setUrl(QUrl(url));
+        });
+    }
+    
+    if (end < history.size()) {
+        menu->addAction("Показать все…", this, &MainWindow::showHistory);
+    }
+}
+
+void MainWindow::clearDynamicActions(QMenu *menu, int fixedActions)
+{
+    const QList<QAction*> actions = menu->actions();
+    for (int i = fixedActions; i < actions.size(); ++i) {
+        QAction *action = actions.at(i);
+        menu->removeAction(action);
+        if (QMenu *submenu = action->menu()) {
+            submenu->deleteLater();
+        }
+        action->deleteLater();
+    }
+}
+
 void MainWindow::findInPage()
 {
     findBar->show();
@@ -468,19 +548,14 @@ void MainWindow::loadSettings()
     QVariant historyVar = settings.value("history");
     if (historyVar.isValid()) {
         history = historyVar.value<QList<HistoryItem>>();
+        historyMenuDirty = true;
     }
     
     // Загружаем закладки
     QVariant bookmarksVar = settings.value("bookmarks");
     if (bookmarksVar.isValid()) {
         bookmarks = bookmarksVar.value<QList<Bookmark>>();
-        for (const auto &bookmark : bookmarks) {
-            QAction *action = new QAction(bookmark.title, this);
-            connect(action, &QAction::triggered, this, [this, bookmark]() {
-                webView->setUrl(QUrl(bookmark.url));
-            });
-            bookmarksMenu->addAction(action);
-        }
+        bookmarksMenuDirty = true;
     }
 }
 
@@ -512,6 +587,7 @@ void MainWindow::addToHistory(const QString &url, const QString &title)
     while (history.size() > 1000) {
         history.removeFirst();
     }
+    historyMenuDirty = true;
     
     settings.setValue("history", QVariant::fromValue(history));
 }
@@ -569,7 +645,9 @@ void MainWindow::clearBrowsingData()
         webProfile->clearAllVisitedLinks();
         webProfile->clearHttpCache();
         webProfile->cookieStore()->deleteAllCookies();
+        FaviconStore::instance()->clear();
         history.clear();
+        historyMenuDirty = true;
         settings.remove("history");
         QMessageBox::information(this, "Очистка данных", "Данные браузера успешно очищены.");
     }
@@ -617,13 +695,8 @@ void MainWindow::importBookmarks()
                 bookmark.url = bookmarkObj["url"].toString();
                 bookmark.title = bookmarkObj["title"].toString();
                 bookmarks.append(bookmark);
-                
-                QAction *action = new QAction(bookmark.title, this);
-                connect(action, &QAction::triggered, this, [this, bookmark]() {
-                    webView->setUrl(QUrl(bookmark.url));
-                });
-                bookmarksMenu->addAction(action);
             }
+            bookmarksMenuDirty = true;
             
             settings.setValue("bookmarks", QVariant::fromValue(bookmarks));
             QMessageBox::information(this, "Импорт закладок", "Закладки успешно импортированы.");
@@ -986,7 +1059,8 @@ void MainWindow::setupTab(QWebEngineView *webView, const QString &title)
     connect(webView, &QWebEngineView::iconChanged, this, [this, webView](const QIcon &icon) {
         int index = tabWidget->indexOf(webView);
         if (index >= 0) {
-            tabWidget->setTabIcon(index, icon);
+            // Вкладки одного сайта используют один декодированный экземпляр
+            tabWidget->setTabIcon(index, FaviconStore::instance()->storeIcon(webView->url(), icon));
         }
     });
 
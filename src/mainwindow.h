@@ -87,6 +87,11 @@ private:
     void applyStyle();
     void setupWebView();
     void setupTab(QWebEngineView *webView, const QString &title = QString());
+    void populateBookmarksMenu();
+    void populateHistoryMenu();
+    void fillBookmarksMenu(QMenu *menu);
+    void fillHistoryMenu(QMenu *menu);
+    void clearDynamicActions(QMenu *menu, int fixedActions);
 
     QWebEngineView *webView;
     QWebEngineProfile *webProfile;
@@ -95,6 +100,10 @@ private:
     QLineEdit *findBar;
     QMenu *bookmarksMenu;
     QMenu *historyMenu;
+    int bookmarksMenuFixedActions;
+    int historyMenuFixedActions;
+    bool bookmarksMenuDirty;
+    bool historyMenuDirty;
     QStatusBar *statusBar;
     QVector<HistoryEntry> history;
     QVector<Bookmark> bookmarks;
@@ -114,4 +123,6 @@ private:
     QTabWidget *tabWidget;
     QList<QWebEngineView*> webViews;
     QWebEngineView* currentWebView() const;
+    
+    static const int MAX_MENU_ITEMS = 30;
 }; 
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "merkletree.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+
+MerkleTree::MerkleTree()
+    : m_buckets(BUCKET_COUNT)
+    , m_levels(DEPTH + 1)
+    , m_size(0)
+{
+    int width = 1;
+    for (int level = 0; level <= DEPTH; ++level) {
+        m_levels[level].resize(width);
+        width *= FANOUT;
+    }
+}
+
+int MerkleTree::bucketOf(const QString &id)
+{
+    // Первые 12 бит SHA-256 дают равномерное распределение по корзинам
+    const QByteArray hash = QCryptographicHash::hash(id.toUtf8(), QCryptographicHash::Sha256);
+    const int prefix = (static_cast<uchar>(hash[0]) << 8) | static_cast<uchar>(hash[1]);
+    return prefix % BUCKET_COUNT;
+}
+
+QList<int> MerkleTree::children(int index)
+{
+    QList<int> result;
+    result.reserve(FANOUT);
+    for (int i = 0; i < FANOUT; ++i) {
+        result.append(index * FANOUT + i);
+    }
+    return result;
+}
+
+void MerkleTree::insert(const QString &id, const QByteArray &checksum)
+{
+    const int bucket = bucketOf(id);
+    auto it = m_buckets[bucket].find(id);
+    if (it == m_buckets[bucket].end()) {
+        m_buckets[bucket].insert(id, checksum);
+        ++m_size;
+    } else if (*it != checksum) {
+        *it = checksum;
+    } else {
+        return;
+    }
+    m_dirtyBuckets.insert(bucket);
+}
+
+void MerkleTree::remove(const QString &id)
+{
+    const int bucket = bucketOf(id);
+    if (m_buckets[bucket].remove(id) > 0) {
+        --m_size;
+        m_dirtyBuckets.insert(bucket);
+    }
+}
+
+void MerkleTree::clear()
+{
+    for (int bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+        if (!m_buckets[bucket].isEmpty()) {
+            m_buckets[bucket].clear();
+            m_dirtyBuckets.insert(bucket);
+        }
+    }
+    m_size = 0;
+}
+
+bool MerkleTree::contains(const QString &id) const
+{
+    return m_buckets[bucketOf(id)].contains(id);
+}
+
+QByteArray MerkleTree::checksum(const QString &id) const
+{
+    return m_buckets[bucketOf(id)].value(id);
+}
+
+QByteArray MerkleTree::nodeHash(int level, int index) const
+{
+    if (level < 0 || level > DEPTH || index < 0 || index >= m_levels[level].size()) {
+        return QByteArray();
+    }
+    rehash();
+    return m_levels[level][index];
+}
+
+QMap<QString, QByteArray> MerkleTree::bucketEntries(int bucket) const
+{
+    if (bucket < 0 || bucket >= BUCKET_COUNT) {
+        return QMap<QString, QByteArray>();
+    }
+    return m_buckets[bucket];
+}
+
+QList<int> MerkleTree::differingNodes(int level, const QList<int> &nodes,
+                                      const QHash<int, QByteArray> &remote) const
+{
+    QList<int> result;
+    for (int index : nodes) {
+        if (nodeHash(level, index) != remote.value(index)) {
+            result.append(index);
+        }
+    }
+    return result;
+}
+
+void MerkleTree::rehash() const
+{
+    if (m_dirtyBuckets.isEmpty()) {
+        return;
+    }
+    
+    // Пересчитываются только изменённые корзины и их предки
+    QSet<int> dirty;
+    for (int bucket : std::as_const(m_dirtyBuckets)) {
+        const QMap<QString, QByteArray> &entries = m_buckets[bucket];
+        if (entries.isEmpty()) {
+            m_levels[DEPTH][bucket].clear();
+        } else {
+            // QMap упорядочен по id, поэтому хэш не зависит от порядка вставки
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+                hash.addData(it.key().toUtf8());
+                hash.addData(QByteArray(1, '\0'));
+                hash.addData(it.value());
+            }
+            m_levels[DEPTH][bucket] = hash.result();
+        }
+        dirty.insert(bucket / FANOUT);
+    }
+    m_dirtyBuckets.clear();
+    
+    for (int level = DEPTH - 1; level >= 0; --level) {
+        QSet<int> parents;
+        for (int index : std::as_const(dirty)) {
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            bool empty = true;
+            for (int child = index * FANOUT; child < (index + 1) * FANOUT; ++child) {
+                const QByteArray &childHash = m_levels[level + 1][child];
+                empty = empty && childHash.isEmpty();
+                // Позиция пустого потомка тоже входит в хэш
+                hash.addData(childHash.isEmpty() ? QByteArray(1, '\0') : childHash);
+            }
+            m_levels[level][index] = empty ? QByteArray() : hash.result();
+            parents.insert(index / FANOUT);
+        }
+        dirty = parents;
+    }
+}
+
+QDataStream &operator<<(QDataStream &stream, const MerkleTree &tree)
+{
+    stream << qint32(tree.m_size);
+    for (const QMap<QString, QByteArray> &bucket : tree.m_buckets) {
+        for (auto it = bucket.constBegin(); it != bucket.constEnd(); ++it) {
+            stream << it.key() << it.value();
+        }
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, MerkleTree &tree)
+{
+    tree.clear();
+    qint32 count = 0;
+    stream >> count;
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString id;
+        QByteArray checksum;
+        stream >> id >> checksum;
+        tree.insert(id, checksum);
+    }
+    return stream;
+}
@@ -0,0 +1,59 @@
+#ifndef MERKLETREE_H
+#define MERKLETREE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+class QDataStream;
+
+// Дерево хэшей над контрольными суммами объектов одного типа. Объекты
+// раскладываются по BUCKET_COUNT корзинам по хэшу id; у каждого узла
+// FANOUT потомков. Две стороны сравнивают узлы сверху вниз и спускаются
+// только в различающиеся, а у листьев обмениваются списками id и сумм.
+// Пустое поддерево имеет пустой хэш.
+class MerkleTree
+{
+public:
+    static const int FANOUT = 16;
+    static const int DEPTH = 3;                       // уровень корзин
+    static const int BUCKET_COUNT = 16 * 16 * 16;     // FANOUT^DEPTH
+    
+    MerkleTree();
+    
+    void insert(const QString &id, const QByteArray &checksum);
+    void remove(const QString &id);
+    void clear();
+    int size() const { return m_size; }
+    bool contains(const QString &id) const;
+    QByteArray checksum(const QString &id) const;
+    
+    // Уровень 0 - корень, уровень DEPTH - корзины
+    QByteArray rootHash() const { return nodeHash(0, 0); }
+    QByteArray nodeHash(int level, int index) const;
+    QMap<QString, QByteArray> bucketEntries(int bucket) const;
+    
+    // Узлы уровня, хэш которых отличается от присланного
+    // (отсутствующий в remote узел считается пустым)
+    QList<int> differingNodes(int level, const QList<int> &nodes,
+                              const QHash<int, QByteArray> &remote) const;
+    
+    static int bucketOf(const QString &id);
+    static QList<int> children(int index);
+    
+    friend QDataStream &operator<<(QDataStream &stream, const MerkleTree &tree);
+    friend QDataStream &operator>>(QDataStream &stream, MerkleTree &tree);
+
+private:
+    void rehash() const;
+    
+    QVector<QMap<QString, QByteArray>> m_buckets;
+    mutable QVector<QVector<QByteArray>> m_levels;   // хэши узлов по уровням
+    mutable QSet<int> m_dirtyBuckets;
+    int m_size;
+};
+
+#endif // MERKLETREE_H
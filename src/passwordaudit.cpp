@@ -0,0 +1,59 @@
+#include "passwordaudit.h"
+
+namespace {
+
+// Символы, которые считаются специальными
+const char SPECIAL_CHARACTERS[] = "!@#$%^&*(),.?\":{}|<>";
+
+struct CharacterTable {
+    unsigned char classes[128];
+    
+    CharacterTable() : classes{} {
+        for (int c = 'a'; c <= 'z'; ++c) classes[c] = PasswordAudit::NoLowercase;
+        for (int c = 'A'; c <= 'Z'; ++c) classes[c] = PasswordAudit::NoUppercase;
+        for (int c = '0'; c <= '9'; ++c) classes[c] = PasswordAudit::NoDigit;
+        for (const char *c = SPECIAL_CHARACTERS; *c; ++c) classes[int(*c)] = PasswordAudit::NoSpecial;
+    }
+};
+
+const CharacterTable &characterTable()
+{
+    static const CharacterTable table;
+    return table;
+}
+
+}
+
+int PasswordAudit::classify(const char *utf8, int size, int minLength, int *length)
+{
+    const CharacterTable &table = characterTable();
+    int present = 0;
+    int characters = 0;
+    
+    for (int i = 0; i < size; ++i) {
+        const unsigned char c = static_cast<unsigned char>(utf8[i]);
+        // Продолжения многобайтовых последовательностей не считаются символами
+        if ((c & 0xC0) != 0x80) {
+            ++characters;
+        }
+        if (c < 128) {
+            present |= table.classes[c];
+        }
+    }
+    
+    if (length) {
+        *length = characters;
+    }
+    
+    int flags = (NoLowercase | NoUppercase | NoDigit | NoSpecial) & ~present;
+    if (characters < minLength) {
+        flags |= TooShort;
+    }
+    return flags;
+}
+
+int PasswordAudit::classify(const QString &password, int minLength, int *length)
+{
+    const QByteArray utf8 = password.toUtf8();
+    return classify(utf8.constData(), utf8.size(), minLength, length);
+}
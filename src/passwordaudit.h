@@ -0,0 +1,33 @@
+#ifndef PASSWORDAUDIT_H
+#define PASSWORDAUDIT_H
+
+#include <QString>
+#include <QByteArray>
+
+// Результат проверки одной записи. Хранится в кэше до изменения записи,
+// открытый пароль в нём не сохраняется.
+struct PasswordAudit {
+    enum Flag {
+        TooShort    = 0x01,
+        NoLowercase = 0x02,
+        NoUppercase = 0x04,
+        NoDigit     = 0x08,
+        NoSpecial   = 0x10
+    };
+    
+    QString key;             // источник + имя пользователя
+    QString sealed;          // шифротекст, по которому проводилась проверка
+    QByteArray fingerprint;  // HMAC открытого пароля для поиска повторов
+    int flags = 0;
+    int length = 0;
+    quint32 breachCount = 0; // число появлений в локальной базе утечек
+    
+    bool isWeak() const { return flags != 0; }
+    bool isBreached() const { return breachCount > 0; }
+    
+    // Один проход по UTF-8 без регулярных выражений
+    static int classify(const char *utf8, int size, int minLength, int *length = nullptr);
+    static int classify(const QString &password, int minLength, int *length = nullptr);
+};
+
+#endif // PASSWORDAUDIT_H
@@ -1,60 +1,110 @@
 #include "passwordmanager.h"
 #include <QFile>
+#include <QSaveFile>
+#include <QTimer>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QRandomGenerator>
 #include <QStandardPaths>
 #include <QDir>
 #include <QMessageAuthenticationCode>
+#include <QCryptographicHash>
+#include <QtConcurrent>
+#include "publicsuffix.h"
+#include "csvreader.h"
 
 const QString PasswordManager::CONFIG_FILE = "passwords.config";
 const QString PasswordManager::PASSWORDS_FILE = "passwords.dat";
+const QString PasswordManager::JOURNAL_FILE = "passwords.journal";
+
+namespace {
+
+// Задание для проверки одной записи; собирается в основном потоке
+struct AuditJob {
+    QString key;
+    QString sealed;
+    QByteArray associatedData;
+};
+
+// Строка CSV-выгрузки до шифрования
+struct ImportRow {
+    QString url;
+    QString username;
+    QString password;
+    QDateTime created;
+    QDateTime lastUsed;
+};
+
+}
 
 PasswordManager::PasswordManager(QObject *parent)
     : QObject(parent)
     , m_settings(QSettings::IniFormat, QSettings::UserScope, "Browser", "Passwords")
+    , m_touchTimer(new QTimer(this))
+    , m_auditTimer(new QTimer(this))
+    , m_auditRequested(false)
 {
+    m_dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(m_dataPath);
+    
+    // Отметки об использовании копятся и пишутся одной пачкой
+    m_touchTimer->setSingleShot(true);
+    m_touchTimer->setInterval(TOUCH_FLUSH_DELAY);
+    connect(m_touchTimer, &QTimer::timeout, this, &PasswordManager::flushTouches);
+    
+    // Проверка запускается после серии изменений, а не на каждое
+    m_auditTimer->setSingleShot(true);
+    m_auditTimer->setInterval(AUDIT_DELAY);
+    connect(m_auditTimer, &QTimer::timeout, this, &PasswordManager::startAudit);
+    connect(&m_auditWatcher, &QFutureWatcher<PasswordAudit>::finished,
+            this, &PasswordManager::handleAuditFinished);
+    
     loadPasswords();
 }
 
 PasswordManager::~PasswordManager()
 {
+    cancelAudit();
+    flushTouches();
     savePasswords();
 }
 
 bool PasswordManager::savePassword(const QString &url, const QString &username, 
                                  const QString &password, const QString &formData)
 {
-    if (isNeverSave(url) || !validatePassword(password)) {
+    if (isLocked() || isNeverSave(url) || !validatePassword(password)) {
         return false;
     }
 
     PasswordEntry entry;
     entry.url = url;
     entry.username = username;
-    entry.password = encryptPassword(password);
+    entry.password = encryptPassword(password, url, username);
     entry.formData = formData;
     entry.created = QDateTime::currentDateTime();
     entry.lastUsed = entry.created;
     entry.useCount = 1;
     entry.neverSave = false;
 
-    QString key = url + username;
+    const QString key = originKey(url);
     QList<PasswordEntry> &entries = m_passwords[key];
+    if (entries.isEmpty()) {
+        indexOrigin(key);
+    }
 
     // Проверяем существующие записи
     for (auto &existingEntry : entries) {
         if (existingEntry.username == username) {
             existingEntry = entry;
+            journalEntry(existingEntry);
             emit passwordUpdated(url);
-            savePasswords();
             return true;
         }
     }
 
     entries.append(entry);
+    journalEntry(entry);
     emit passwordAdded(url);
-    savePasswords();
     
     // Проверяем силу пароля
     checkPasswordStrength(password);
@@ -64,7 +114,7 @@ bool PasswordManager::savePassword(const QString &url, const QString &username,
 
 bool PasswordManager::removePassword(const QString &url, const QString &username)
 {
-    QString key = url + username;
+    const QString key = originKey(url);
     if (!m_passwords.contains(key)) {
         return false;
     }
@@ -75,9 +125,12 @@ bool PasswordManager::removePassword(const QString &url, const QString &username
             entries.removeAt(i);
             if (entries.isEmpty()) {
                 m_passwords.remove(key);
+                unindexOrigin(key);
             }
+            m_pendingTouches.remove(qMakePair(key, username));
+            invalidateAudit(key, username);
+            journalRemoval(key, username);
             emit passwordRemoved(url);
-            savePasswords();
             return true;
         }
     }
@@ -88,11 +141,11 @@ bool PasswordManager::removePassword(const QString &url, const QString &username
 bool PasswordManager::updatePassword(const QString &url, const QString &username, 
                                    const QString &newPassword)
 {
-    if (!validatePassword(newPassword)) {
+    if (isLocked() || !validatePassword(newPassword)) {
         return false;
     }
 
-    QString key = url + username;
+    const QString key = originKey(url);
     if (!m_passwords.contains(key)) {
         return false;
     }
@@ -100,11 +153,11 @@ bool PasswordManager::updatePassword(const QString &url, const QString &username
     QList<PasswordEntry> &entries = m_passwords[key];
     for (auto &entry : entries) {
         if (entry.username == username) {
-            entry.password = encryptPassword(newPassword);
+            entry.password = encryptPassword(newPassword, entry.url, username);
             entry.lastUsed = QDateTime::currentDateTime();
             entry.useCount++;
+            journalEntry(entry);
             emit passwordUpdated(url);
-            savePasswords();
             
             // Проверяем силу нового пароля
             checkPasswordStrength(newPassword);
@@ -119,14 +172,13 @@ bool PasswordManager::updatePassword(const QString &url, const QString &username
 QList<PasswordEntry> PasswordManager::getPasswords(const QString &url) const
 {
     QList<PasswordEntry> result;
-    QString key = url;
+    const QList<const PasswordEntry *> entries = matchingEntries(url);
+    result.reserve(entries.size());
     
-    if (m_passwords.contains(key)) {
-        result = m_passwords[key];
-        // Дешифруем пароли перед возвратом
-        for (auto &entry : result) {
-            entry.password = decryptPassword(entry.password);
-        }
+    // Дешифруем пароли перед возвратом
+    for (const PasswordEntry *entry : entries) {
+        result.append(*entry);
+        result.last().password = decryptPassword(*entry).toString();
     }
     
     return result;
@@ -134,15 +186,10 @@ QList<PasswordEntry> PasswordManager::getPasswords(const QString &url) const
 
 QString PasswordManager::findPassword(const QString &url, const QString &username) const
 {
-    QString key = url + username;
-    if (!m_passwords.contains(key)) {
-        return QString();
-    }
-
-    const QList<PasswordEntry> &entries = m_passwords[key];
-    for (const auto &entry : entries) {
-        if (entry.username == username) {
-            return decryptPassword(entry.password);
+    const QList<const PasswordEntry *> entries = matchingEntries(url);
+    for (const PasswordEntry *entry : entries) {
+        if (entry->username == username) {
+            return decryptPassword(*entry).toString();
         }
     }
     
@@ -152,12 +199,10 @@ QString PasswordManager::findPassword(const QString &url, const QString &usernam
 QStringList PasswordManager::findUsernames(const QString &url) const
 {
     QStringList usernames;
-    QString key = url;
-    
-    if (m_passwords.contains(key)) {
-        const QList<PasswordEntry> &entries = m_passwords[key];
-        for (const auto &entry : entries) {
-            usernames.append(entry.username);
+    const QList<const PasswordEntry *> entries = matchingEntries(url);
+    for (const PasswordEntry *entry : entries) {
+        if (!usernames.contains(entry->username)) {
+            usernames.append(entry->username);
         }
     }
     
@@ -166,19 +211,134 @@ QStringList PasswordManager::findUsernames(const QString &url) const
 
 QString PasswordManager::findFormData(const QString &url, const QString &username) const
 {
-    QString key = url + username;
-    if (!m_passwords.contains(key)) {
-        return QString();
+    const QList<const PasswordEntry *> entries = matchingEntries(url);
+    for (const PasswordEntry *entry : entries) {
+        if (entry->username == username) {
+            return entry->formData;
+        }
+    }
+    
+    return QString();
+}
+
+QString PasswordManager::originKey(const QString &url)
+{
+    // scheme://host[:port] в нижнем регистре, хост в ACE-форме
+    const QUrl parsed = QUrl::fromUserInput(url);
+    if (parsed.host().isEmpty()) {
+        return url;
+    }
+    return parsed.adjusted(QUrl::RemoveUserInfo | QUrl::RemovePath |
+                           QUrl::RemoveQuery | QUrl::RemoveFragment)
+                 .toString(QUrl::FullyEncoded).toLower();
+}
+
+QString PasswordManager::siteKey(const QString &host)
+{
+    // Суффикс не из списка (внутренние зоны, новые TLD) мог бы объединить
+    // чужие сайты в один - такие хосты сопоставляются только по источнику
+    bool listed = false;
+    const QString site = PublicSuffixList::instance().registrableDomain(
+        QString::fromLatin1(QUrl::toAce(host)), &listed);
+    return listed ? site : QString();
+}
+
+void PasswordManager::insertEntry(const PasswordEntry &entry)
+{
+    const QString key = originKey(entry.url);
+    QList<PasswordEntry> &entries = m_passwords[key];
+    if (entries.isEmpty()) {
+        indexOrigin(key);
     }
+    entries.append(entry);
+}
 
-    const QList<PasswordEntry> &entries = m_passwords[key];
-    for (const auto &entry : entries) {
+void PasswordManager::indexOrigin(const QString &origin)
+{
+    const QString site = siteKey(QUrl(origin).host());
+    if (site.isEmpty()) {
+        return;
+    }
+    
+    QStringList &origins = m_siteOrigins[site];
+    if (!origins.contains(origin)) {
+        origins.append(origin);
+    }
+}
+
+void PasswordManager::unindexOrigin(const QString &origin)
+{
+    const QString site = siteKey(QUrl(origin).host());
+    auto it = m_siteOrigins.find(site);
+    if (site.isEmpty() || it == m_siteOrigins.end()) {
+        return;
+    }
+    it->removeOne(origin);
+    if (it->isEmpty()) {
+        m_siteOrigins.erase(it);
+    }
+}
+
+void PasswordManager::recordUse(const QString &url, const QString &username)
+{
+    PasswordEntry *entry = findEntry(originKey(url), username);
+    if (!entry) {
+        return;
+    }
+    
+    entry->useCount++;
+    entry->lastUsed = QDateTime::currentDateTime();
+    m_pendingTouches.insert(qMakePair(originKey(entry->url), username));
+    if (!m_touchTimer->isActive()) {
+        m_touchTimer->start();
+    }
+}
+
+PasswordEntry *PasswordManager::findEntry(const QString &origin, const QString &username)
+{
+    auto it = m_passwords.find(origin);
+    if (it == m_passwords.end()) {
+        return nullptr;
+    }
+    for (PasswordEntry &entry : *it) {
         if (entry.username == username) {
-            return entry.formData;
+            return &entry;
         }
     }
+    return nullptr;
+}
+
+QList<const PasswordEntry *> PasswordManager::matchingEntries(const QString &url) const
+{
+    // Сначала записи точного источника, затем остальных источников того же сайта
+    QList<const PasswordEntry *> result;
+    const QUrl parsed = QUrl::fromUserInput(url);
+    const QString origin = originKey(url);
     
-    return QString();
+    auto exact = m_passwords.constFind(origin);
+    if (exact != m_passwords.constEnd()) {
+        for (const PasswordEntry &entry : exact.value()) {
+            result.append(&entry);
+        }
+    }
+    
+    const QString site = siteKey(parsed.host());
+    const QStringList origins = site.isEmpty() ? QStringList() : m_siteOrigins.value(site);
+    for (const QString &other : origins) {
+        // Пароль, сохранённый на https, не подставляется на http-страницу
+        if (other == origin || (parsed.scheme() == "http" && other.startsWith("https:"))) {
+            continue;
+        }
+        auto it = m_passwords.constFind(other);
+        if (it == m_passwords.constEnd()) {
+            continue;
+        }
+        for (const PasswordEntry &entry : it.value()) {
+            result.append(&entry);
+        }
+    }
+    
+    return result;
 }
 
 void PasswordManager::addToNeverSave(const QString &url)
@@ -215,15 +375,7 @@ bool PasswordManager::exportPasswords(const QString &filename, const QString &ma
     QJsonArray passwordsArray;
     for (const auto &entries : m_passwords) {
         for (const auto &entry : entries) {
-            QJsonObject entryObj;
-            entryObj["url"] = entry.url;
-            entryObj["username"] = entry.username;
-            entryObj["password"] = entry.password;
-            entryObj["formData"] = entry.formData;
-            entryObj["lastUsed"] = entry.lastUsed.toString(Qt::ISODate);
-            entryObj["created"] = entry.created.toString(Qt::ISODate);
-            entryObj["useCount"] = entry.useCount;
-            passwordsArray.append(entryObj);
+            passwordsArray.append(entryToJson(entry));
         }
     }
 
@@ -258,18 +410,7 @@ bool PasswordManager::importPasswords(const QString &filename, const QString &ma
     int importCount = 0;
 
     for (const auto &value : passwordsArray) {
-        QJsonObject entryObj = value.toObject();
-        PasswordEntry entry;
-        entry.url = entryObj["url"].toString();
-        entry.username = entryObj["username"].toString();
-        entry.password = entryObj["password"].toString();
-        entry.formData = entryObj["formData"].toString();
-        entry.lastUsed = QDateTime::fromString(entryObj["lastUsed"].toString(), Qt::ISODate);
-        entry.created = QDateTime::fromString(entryObj["created"].toString(), Qt::ISODate);
-        entry.useCount = entryObj["useCount"].toInt();
-
-        QString key = entry.url + entry.username;
-        m_passwords[key].append(entry);
+        insertEntry(entryFromJson(value.toObject()));
         importCount++;
     }
 
@@ -278,62 +419,312 @@ bool PasswordManager::importPasswords(const QString &filename, const QString &ma
     return true;
 }
 
+bool PasswordManager::importFromChrome(const QString &filename)
+{
+    // name,url,username,password,note
+    return importCsv(filename);
+}
+
+bool PasswordManager::importFromFirefox(const QString &filename)
+{
+    // "url","username","password","httpRealm","formActionOrigin","guid",
+    // "timeCreated","timeLastUsed","timePasswordChanged"
+    return importCsv(filename);
+}
+
+bool PasswordManager::importCsv(const QString &filename)
+{
+    if (isLocked()) {
+        return false;
+    }
+    
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    // Столбцы ищем по заголовку: порядок в выгрузках браузеров различается
+    CsvReader reader(&file);
+    QStringList fields;
+    if (!reader.readRecord(fields)) {
+        return false;
+    }
+    QHash<QString, int> columns;
+    for (int i = 0; i < fields.size(); ++i) {
+        columns.insert(fields[i].trimmed().toLower(), i);
+    }
+    const int urlColumn = columns.value("url", -1);
+    const int usernameColumn = columns.value("username", -1);
+    const int passwordColumn = columns.value("password", -1);
+    const int createdColumn = columns.value("timecreated", -1);
+    const int lastUsedColumn = columns.value("timelastused", -1);
+    if (urlColumn < 0 || usernameColumn < 0 || passwordColumn < 0) {
+        return false;
+    }
+    
+    const PasswordVault *vault = &m_vault;
+    auto encryptRow = [vault](const ImportRow &row) {
+        PasswordEntry entry;
+        entry.url = row.url;
+        entry.username = row.username;
+        QByteArray data = row.password.toUtf8();
+        entry.password = QString::fromLatin1(
+            vault->encrypt(data, associatedData(row.url, row.username)).toBase64());
+        data.fill('\0');
+        entry.created = row.created;
+        entry.lastUsed = row.lastUsed;
+        entry.neverSave = false;
+        entry.useCount = 0;
+        return entry;
+    };
+    
+    // Записи копятся отдельно и попадают в хранилище одним снимком в конце:
+    // при ошибке разбора текущие пароли не меняются
+    const QDateTime now = QDateTime::currentDateTime();
+    QList<PasswordEntry> imported;
+    QList<ImportRow> batch;
+    QSet<QString> seen;
+    batch.reserve(IMPORT_BATCH_SIZE);
+    
+    auto flushBatch = [&]() {
+        // Шифрование - самая дорогая часть, пачка шифруется на пуле потоков
+        const QList<PasswordEntry> entries =
+            QtConcurrent::blockingMapped<QList<PasswordEntry>>(batch, encryptRow);
+        batch.clear();
+        for (const PasswordEntry &entry : entries) {
+            if (entry.password.isEmpty()) {
+                return false;
+            }
+            imported.append(entry);
+        }
+        return true;
+    };
+    
+    const int required = qMax(urlColumn, qMax(usernameColumn, passwordColumn));
+    while (reader.readRecord(fields)) {
+        if (fields.size() <= required) {
+            continue; // пустые и неполные строки
+        }
+        
+        ImportRow row;
+        row.url = fields[urlColumn].trimmed();
+        row.username = fields[usernameColumn];
+        row.password = fields[passwordColumn];
+        const QString origin = originKey(row.url);
+        if (origin.isEmpty() || row.password.isEmpty() || isNeverSave(row.url)) {
+            continue;
+        }
+        
+        // Пара (источник, имя) уже сохранена или встречалась в файле раньше
+        const QString key = auditKey(origin, row.username);
+        if (findEntry(origin, row.username) || seen.contains(key)) {
+            continue;
+        }
+        seen.insert(key);
+        
+        const qint64 created = createdColumn >= 0 && createdColumn < fields.size()
+            ? fields[createdColumn].toLongLong() : 0;
+        const qint64 lastUsed = lastUsedColumn >= 0 && lastUsedColumn < fields.size()
+            ? fields[lastUsedColumn].toLongLong() : 0;
+        row.created = created > 0 ? QDateTime::fromMSecsSinceEpoch(created) : now;
+        row.lastUsed = lastUsed > 0 ? QDateTime::fromMSecsSinceEpoch(lastUsed) : row.created;
+        
+        batch.append(row);
+        if (batch.size() >= IMPORT_BATCH_SIZE && !flushBatch()) {
+            return false;
+        }
+    }
+    
+    if (reader.hasError() || (!batch.isEmpty() && !flushBatch())) {
+        return false;
+    }
+    
+    for (const PasswordEntry &entry : std::as_const(imported)) {
+        insertEntry(entry);
+    }
+    savePasswords();
+    scheduleAudit();
+    
+    emit importCompleted(imported.size());
+    return true;
+}
+
+bool PasswordManager::unlock(const QString &masterPassword)
+{
+    if (!m_vault.isInitialized()) {
+        // Хранилище старой версии: пароль проверяется по прежнему хэшу,
+        // затем создаётся новое хранилище и записи перешифровываются
+        const QString legacySalt = m_settings.value("salt").toString();
+        const QString legacyHash = m_settings.value("masterPasswordHash").toString();
+        const QByteArray digest = QCryptographicHash::hash((masterPassword + legacySalt).toUtf8(),
+                                                           QCryptographicHash::Sha256).toHex();
+        if (legacyHash.isEmpty() || QString::fromLatin1(digest) != legacyHash ||
+            !m_vault.create(masterPassword)) {
+            return false;
+        }
+        saveVaultParameters();
+    } else if (!m_vault.unlock(masterPassword)) {
+        emit securityAlert("Неверный мастер-пароль");
+        return false;
+    }
+    
+    migrateLegacyEntries();
+    scheduleAudit();
+    emit lockedChanged(false);
+    return true;
+}
+
+void PasswordManager::lock()
+{
+    // Рабочие потоки расшифровывают ключом хранилища - дожидаемся их
+    cancelAudit();
+    if (m_vault.isUnlocked()) {
+        m_vault.lock();
+        emit lockedChanged(true);
+    }
+}
+
+bool PasswordManager::isLocked() const
+{
+    return !m_vault.isUnlocked();
+}
+
 bool PasswordManager::setMasterPassword(const QString &password)
 {
     if (!validatePassword(password)) {
         return false;
     }
-
-    m_salt = generateSalt();
-    m_masterPasswordHash = hashPassword(password, m_salt);
-    m_encryptionKey = hashPassword(password, generateSalt());
     
-    m_settings.setValue("salt", m_salt);
-    m_settings.setValue("masterPasswordHash", m_masterPasswordHash);
-    m_settings.setValue("encryptionKey", m_encryptionKey);
+    // Существующие записи можно перешифровать только из открытого хранилища
+    if (m_vault.isInitialized() && isLocked() && getPasswordCount() > 0) {
+        return false;
+    }
+    
+    PasswordVault vault;
+    if (!vault.create(password)) {
+        return false;
+    }
+    if (m_vault.isUnlocked() && !reencryptAll(m_vault, vault)) {
+        return false;
+    }
+    
+    // Отпечатки зависят от ключа хранилища, прежние результаты недействительны
+    cancelAudit();
+    m_audits.clear();
+    m_vault = std::move(vault);
+    saveVaultParameters();
+    migrateLegacyEntries();
+    savePasswords();
+    scheduleAudit();
     
     emit masterPasswordChanged();
+    emit lockedChanged(false);
     return true;
 }
 
 bool PasswordManager::changeMasterPassword(const QString &oldPassword, const QString &newPassword)
 {
-    if (!verifyMasterPassword(oldPassword) || !validatePassword(newPassword)) {
+    if (!validatePassword(newPassword)) {
         return false;
     }
-
-    // Перешифровываем все пароли с новым ключом
-    QString newSalt = generateSalt();
-    QString newEncryptionKey = hashPassword(newPassword, newSalt);
     
-    for (auto &entries : m_passwords) {
-        for (auto &entry : entries) {
-            QString decrypted = decryptPassword(entry.password);
-            entry.password = encryptPassword(decrypted);
-        }
+    PasswordVault oldVault;
+    oldVault.setParameters(m_vault.salt(), m_vault.iterations(), m_vault.checkValue());
+    if (!oldVault.unlock(oldPassword)) {
+        return false;
     }
-
-    m_salt = newSalt;
-    m_masterPasswordHash = hashPassword(newPassword, m_salt);
-    m_encryptionKey = newEncryptionKey;
     
-    m_settings.setValue("salt", m_salt);
-    m_settings.setValue("masterPasswordHash", m_masterPasswordHash);
-    m_settings.setValue("encryptionKey", m_encryptionKey);
+    // Перешифровываем все пароли с новым ключом
+    PasswordVault newVault;
+    if (!newVault.create(newPassword, m_vault.iterations()) || !reencryptAll(oldVault, newVault)) {
+        return false;
+    }
     
+    cancelAudit();
+    m_audits.clear();
+    m_vault = std::move(newVault);
+    saveVaultParameters();
     savePasswords();
+    scheduleAudit();
     emit masterPasswordChanged();
     return true;
 }
 
 bool PasswordManager::verifyMasterPassword(const QString &password) const
 {
-    return hashPassword(password, m_salt) == m_masterPasswordHash;
+    return m_vault.checkPassword(password);
+}
+
+bool PasswordManager::reencryptAll(const PasswordVault &from, const PasswordVault &to)
+{
+    // Сначала шифруем всё в копию: при ошибке записи остаются нетронутыми
+    QHash<QString, QList<PasswordEntry>> reencrypted = m_passwords;
+    for (auto &entries : reencrypted) {
+        for (auto &entry : entries) {
+            const QByteArray aad = associatedData(entry.url, entry.username);
+            bool ok = false;
+            const SecureBuffer plain = from.decrypt(QByteArray::fromBase64(entry.password.toLatin1()),
+                                                    aad, &ok);
+            if (!ok) {
+                emit securityAlert("Не удалось расшифровать пароль для " + entry.url);
+                return false;
+            }
+            const QByteArray sealed = to.encrypt(QByteArray::fromRawData(plain.constData(), plain.size()), aad);
+            entry.password = QString::fromLatin1(sealed.toBase64());
+        }
+    }
+    
+    m_passwords = reencrypted;
+    return true;
+}
+
+void PasswordManager::migrateLegacyEntries()
+{
+    if (m_legacyKey.isEmpty() || isLocked()) {
+        return;
+    }
+    
+    // Записи старых версий зашифрованы XOR с ключом из настроек
+    const QHash<QString, QList<PasswordEntry>> legacyPasswords = m_passwords;
+    const QByteArray key = m_legacyKey.toUtf8();
+    for (auto &entries : m_passwords) {
+        for (auto &entry : entries) {
+            QByteArray data = QByteArray::fromBase64(entry.password.toUtf8());
+            for (int i = 0; i < data.size(); ++i) {
+                data[i] = data[i] ^ key[i % key.size()];
+            }
+            entry.password = encryptPassword(QString::fromUtf8(data), entry.url, entry.username);
+            data.fill('\0');
+        }
+    }
+    
+    // Ключ старого формата удаляется только после записи нового: при сбое
+    // на диске остаются старые записи, и расшифровать их будет нечем
+    if (!savePasswords()) {
+        m_passwords = legacyPasswords;
+        return;
+    }
+    
+    m_legacyKey.clear();
+    m_settings.remove("encryptionKey");
+    m_settings.remove("masterPasswordHash");
+    m_settings.remove("salt");
+}
+
+void PasswordManager::saveVaultParameters()
+{
+    m_settings.setValue("vault/salt", m_vault.salt().toBase64());
+    m_settings.setValue("vault/iterations", m_vault.iterations());
+    m_settings.setValue("vault/check", m_vault.checkValue().toBase64());
 }
 
 void PasswordManager::clearPasswords()
 {
     m_passwords.clear();
+    m_siteOrigins.clear();
+    m_pendingTouches.clear();
+    cancelAudit();
+    m_audits.clear();
     savePasswords();
     emit passwordsCleared();
 }
@@ -354,15 +745,13 @@ QDateTime PasswordManager::getLastSync() const
 
 QList<PasswordEntry> PasswordManager::getWeakPasswords() const
 {
+    // Результаты берутся из кэша фоновой проверки; записи, которые ещё не
+    // проверены, появятся после auditCompleted()
     QList<PasswordEntry> weakPasswords;
-    for (const auto &entries : m_passwords) {
-        for (const auto &entry : entries) {
-            QString password = decryptPassword(entry.password);
-            if (password.length() < 8 || 
-                password.toLower() == password ||
-                password.toUpper() == password ||
-                !password.contains(QRegExp("\\d")) ||
-                !password.contains(QRegExp("[!@#$%^&*(),.?\":{}|<>]"))) {
+    for (auto it = m_passwords.constBegin(); it != m_passwords.constEnd(); ++it) {
+        for (const auto &entry : it.value()) {
+            const PasswordAudit *audit = cachedAudit(it.key(), entry);
+            if (audit && audit->isWeak()) {
                 weakPasswords.append(entry);
             }
         }
@@ -372,21 +761,23 @@ QList<PasswordEntry> PasswordManager::getWeakPasswords() const
 
 QList<PasswordEntry> PasswordManager::getReusedPasswords() const
 {
-    QHash<QString, QStringList> passwordUsage;
-    QList<PasswordEntry> reusedPasswords;
-
-    // Собираем информацию об использовании паролей
-    for (const auto &entries : m_passwords) {
-        for (const auto &entry : entries) {
-            QString password = entry.password;
-            passwordUsage[password].append(entry.url);
+    // Шифротексты с разными nonce не совпадают, сравниваем ключевые
+    // отпечатки открытых паролей
+    QHash<QByteArray, int> fingerprintUsage;
+    for (auto it = m_passwords.constBegin(); it != m_passwords.constEnd(); ++it) {
+        for (const auto &entry : it.value()) {
+            const PasswordAudit *audit = cachedAudit(it.key(), entry);
+            if (audit && !audit->fingerprint.isEmpty()) {
+                ++fingerprintUsage[audit->fingerprint];
+            }
         }
     }
 
-    // Находим повторно используемые пароли
-    for (const auto &entries : m_passwords) {
-        for (const auto &entry : entries) {
-            if (passwordUsage[entry.password].size() > 1) {
+    QList<PasswordEntry> reusedPasswords;
+    for (auto it = m_passwords.constBegin(); it != m_passwords.constEnd(); ++it) {
+        for (const auto &entry : it.value()) {
+            const PasswordAudit *audit = cachedAudit(it.key(), entry);
+            if (audit && fingerprintUsage.value(audit->fingerprint) > 1) {
                 reusedPasswords.append(entry);
             }
         }
@@ -395,6 +786,50 @@ QList<PasswordEntry> PasswordManager::getReusedPasswords() const
     return reusedPasswords;
 }
 
+bool PasswordManager::loadBreachCorpus(const QString &fileName)
+{
+    // Рабочие потоки проверки читают отображение файла - дожидаемся их
+    cancelAudit();
+    const QString previous = m_breachCorpus.fileName();
+    
+    if (fileName.isEmpty()) {
+        m_breachCorpus.close();
+        m_settings.remove("breach/corpus");
+    } else if (m_breachCorpus.open(fileName)) {
+        m_settings.setValue("breach/corpus", fileName);
+    } else {
+        if (!previous.isEmpty()) {
+            m_breachCorpus.open(previous);
+        }
+        scheduleAudit();
+        return false;
+    }
+    
+    // Результаты сверки с прежней базой недействительны
+    m_audits.clear();
+    scheduleAudit();
+    return true;
+}
+
+bool PasswordManager::hasBreachCorpus() const
+{
+    return m_breachCorpus.isOpen();
+}
+
+QList<PasswordEntry> PasswordManager::getBreachedPasswords() const
+{
+    QList<PasswordEntry> breachedPasswords;
+    for (auto it = m_passwords.constBegin(); it != m_passwords.constEnd(); ++it) {
+        for (const auto &entry : it.value()) {
+            const PasswordAudit *audit = cachedAudit(it.key(), entry);
+            if (audit && audit->isBreached()) {
+                breachedPasswords.append(entry);
+            }
+        }
+    }
+    return breachedPasswords;
+}
+
 QList<PasswordEntry> PasswordManager::getOldPasswords() const
 {
     const int OLD_PASSWORD_DAYS = 90;
@@ -412,175 +847,401 @@ QList<PasswordEntry> PasswordManager::getOldPasswords() const
     return oldPasswords;
 }
 
-QString PasswordManager::encryptPassword(const QString &password) const
+QString PasswordManager::encryptPassword(const QString &password, const QString &url,
+                                         const QString &username) const
 {
-    // Используем AES шифрование
+    // AES-256-GCM ключом, выведенным при разблокировке
     QByteArray data = password.toUtf8();
-    QByteArray key = m_encryptionKey.toUtf8();
-    
-    // В реальном приложении здесь должна быть реализация AES шифрования
-    // Для примера используем простое XOR шифрование
-    QByteArray encrypted;
-    for (int i = 0; i < data.size(); ++i) {
-        encrypted.append(data[i] ^ key[i % key.size()]);
-    }
-    
-    return encrypted.toBase64();
+    const QByteArray sealed = m_vault.encrypt(data, associatedData(url, username));
+    data.fill('\0');
+    return QString::fromLatin1(sealed.toBase64());
 }
 
-QString PasswordManager::decryptPassword(const QString &encrypted) const
+SecureBuffer PasswordManager::decryptPassword(const PasswordEntry &entry) const
 {
-    QByteArray data = QByteArray::fromBase64(encrypted.toUtf8());
-    QByteArray key = m_encryptionKey.toUtf8();
-    
-    // В реальном приложении здесь должна быть реализация AES дешифрования
-    // Для примера используем простое XOR дешифрование
-    QByteArray decrypted;
-    for (int i = 0; i < data.size(); ++i) {
-        decrypted.append(data[i] ^ key[i % key.size()]);
-    }
-    
-    return QString::fromUtf8(decrypted);
+    // Расшифровка только по запросу; открытый текст живёт в закреплённом
+    // буфере, который затирается при выходе из области видимости
+    bool ok = false;
+    SecureBuffer plain = m_vault.decrypt(QByteArray::fromBase64(entry.password.toLatin1()),
+                                         associatedData(entry.url, entry.username), &ok);
+    return ok ? std::move(plain) : SecureBuffer();
 }
 
-QString PasswordManager::generateSalt() const
+QByteArray PasswordManager::associatedData(const QString &url, const QString &username)
 {
-    const QString chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-    QString salt;
-    for (int i = 0; i < SALT_LENGTH; ++i) {
-        salt.append(chars[QRandomGenerator::global()->bounded(chars.length())]);
-    }
-    return salt;
+    return (url + QLatin1Char('\n') + username).toUtf8();
 }
 
-QString PasswordManager::hashPassword(const QString &password, const QString &salt) const
+bool PasswordManager::validatePassword(const QString &password) const
 {
-    QByteArray data = (password + salt).toUtf8();
-    return QString(QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex());
+    if (password.length() > MAX_PASSWORD_LENGTH) {
+        return false;
+    }
+
+    // Длина, цифры, буквы разных регистров и специальные символы
+    return PasswordAudit::classify(password, MIN_PASSWORD_LENGTH) == 0;
 }
 
-bool PasswordManager::validatePassword(const QString &password) const
+void PasswordManager::loadPasswords()
 {
-    if (password.length() < MIN_PASSWORD_LENGTH || 
-        password.length() > MAX_PASSWORD_LENGTH) {
-        return false;
+    m_neverSaveList = m_settings.value("neverSave").toStringList();
+    m_vault.setParameters(QByteArray::fromBase64(m_settings.value("vault/salt").toByteArray()),
+                          m_settings.value("vault/iterations").toInt(),
+                          QByteArray::fromBase64(m_settings.value("vault/check").toByteArray()));
+    m_legacyKey = m_settings.value("encryptionKey").toString();
+    m_lastSync = m_settings.value("lastSync").toDateTime();
+    
+    const QString corpusFile = m_settings.value("breach/corpus").toString();
+    if (!corpusFile.isEmpty()) {
+        m_breachCorpus.open(corpusFile);
     }
 
-    // Проверяем наличие цифр
-    if (!password.contains(QRegExp("\\d"))) {
-        return false;
+    QFile file(m_dataPath + "/" + PASSWORDS_FILE);
+    if (file.open(QIODevice::ReadOnly)) {
+        QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        
+        // Ключи файла не используются: старые версии хранили записи по полному
+        // адресу, индекс по источникам строится заново
+        QJsonObject root = doc.object();
+        for (auto it = root.begin(); it != root.end(); ++it) {
+            const QJsonArray entriesArray = it.value().toArray();
+            for (const auto &entryValue : entriesArray) {
+                insertEntry(entryFromJson(entryValue.toObject()));
+            }
+        }
     }
+    
+    // Изменения после последнего снимка
+    replayJournal();
+}
 
-    // Проверяем наличие букв в разных регистрах
-    if (!password.contains(QRegExp("[a-z]")) || 
-        !password.contains(QRegExp("[A-Z]"))) {
-        return false;
+bool PasswordManager::savePasswords()
+{
+    // Полный снимок: QSaveFile заменяет файл атомарно, при сбое остаётся прежний
+    QJsonObject root;
+    for (auto it = m_passwords.cbegin(); it != m_passwords.cend(); ++it) {
+        QJsonArray entriesArray;
+        for (const auto &entry : it.value()) {
+            entriesArray.append(entryToJson(entry));
+        }
+        root[it.key()] = entriesArray;
     }
 
-    // Проверяем наличие специальных символов
-    if (!password.contains(QRegExp("[!@#$%^&*(),.?\":{}|<>]"))) {
+    QSaveFile file(m_dataPath + "/" + PASSWORDS_FILE);
+    if (!file.open(QIODevice::WriteOnly)) {
         return false;
     }
-
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        return false;
+    }
+    
+    // Снимок содержит всё из журнала. Если сбой случится до удаления журнала,
+    // повторное применение его записей ничего не изменит.
+    m_journal.close();
+    QFile::remove(m_dataPath + "/" + JOURNAL_FILE);
+    
+    m_lastSync = QDateTime::currentDateTime();
+    m_settings.setValue("lastSync", m_lastSync);
     return true;
 }
 
-void PasswordManager::loadPasswords()
+QJsonObject PasswordManager::entryToJson(const PasswordEntry &entry)
 {
-    m_neverSaveList = m_settings.value("neverSave").toStringList();
-    m_salt = m_settings.value("salt").toString();
-    m_masterPasswordHash = m_settings.value("masterPasswordHash").toString();
-    m_encryptionKey = m_settings.value("encryptionKey").toString();
-    m_lastSync = m_settings.value("lastSync").toDateTime();
+    QJsonObject entryObj;
+    entryObj["url"] = entry.url;
+    entryObj["username"] = entry.username;
+    entryObj["password"] = entry.password;
+    entryObj["formData"] = entry.formData;
+    entryObj["lastUsed"] = entry.lastUsed.toString(Qt::ISODate);
+    entryObj["created"] = entry.created.toString(Qt::ISODate);
+    entryObj["useCount"] = entry.useCount;
+    return entryObj;
+}
 
-    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(path);
-    QFile file(path + "/" + PASSWORDS_FILE);
-    
-    if (!file.open(QIODevice::ReadOnly)) {
-        return;
-    }
+PasswordEntry PasswordManager::entryFromJson(const QJsonObject &entryObj)
+{
+    PasswordEntry entry;
+    entry.url = entryObj["url"].toString();
+    entry.username = entryObj["username"].toString();
+    entry.password = entryObj["password"].toString();
+    entry.formData = entryObj["formData"].toString();
+    entry.lastUsed = QDateTime::fromString(entryObj["lastUsed"].toString(), Qt::ISODate);
+    entry.created = QDateTime::fromString(entryObj["created"].toString(), Qt::ISODate);
+    entry.useCount = entryObj["useCount"].toInt();
+    entry.neverSave = false;
+    return entry;
+}
 
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    if (!doc.isObject()) {
+void PasswordManager::replayJournal()
+{
+    QFile file(m_dataPath + "/" + JOURNAL_FILE);
+    if (!file.open(QIODevice::ReadOnly)) {
         return;
     }
-
-    QJsonObject root = doc.object();
-    for (auto it = root.begin(); it != root.end(); ++it) {
-        QJsonArray entriesArray = it.value().toArray();
-        QList<PasswordEntry> entries;
-        
-        for (const auto &entryValue : entriesArray) {
-            QJsonObject entryObj = entryValue.toObject();
-            PasswordEntry entry;
-            entry.url = entryObj["url"].toString();
-            entry.username = entryObj["username"].toString();
-            entry.password = entryObj["password"].toString();
-            entry.formData = entryObj["formData"].toString();
-            entry.lastUsed = QDateTime::fromString(entryObj["lastUsed"].toString(), Qt::ISODate);
-            entry.created = QDateTime::fromString(entryObj["created"].toString(), Qt::ISODate);
-            entry.useCount = entryObj["useCount"].toInt();
-            entries.append(entry);
+    
+    // Записи содержат полное состояние, поэтому применяются повторно без вреда.
+    // Оборванная последняя строка означает сбой во время записи - она пропускается.
+    qint64 validEnd = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (!line.endsWith('\n') || !doc.isObject()) {
+            break;
         }
+        validEnd = file.pos();
         
-        m_passwords[it.key()] = entries;
+        const QJsonObject record = doc.object();
+        const QString op = record["op"].toString();
+        if (op == "put") {
+            const PasswordEntry entry = entryFromJson(record["entry"].toObject());
+            PasswordEntry *existing = findEntry(originKey(entry.url), entry.username);
+            if (existing) {
+                *existing = entry;
+            } else {
+                insertEntry(entry);
+            }
+        } else if (op == "remove") {
+            const QString origin = record["origin"].toString();
+            auto it = m_passwords.find(origin);
+            if (it == m_passwords.end()) {
+                continue;
+            }
+            for (int i = 0; i < it->size(); ++i) {
+                if (it->at(i).username == record["username"].toString()) {
+                    it->removeAt(i);
+                    break;
+                }
+            }
+            if (it->isEmpty()) {
+                m_passwords.erase(it);
+                unindexOrigin(origin);
+            }
+        } else if (op == "touch") {
+            PasswordEntry *entry = findEntry(record["origin"].toString(),
+                                             record["username"].toString());
+            if (entry) {
+                entry->useCount = record["useCount"].toInt();
+                entry->lastUsed = QDateTime::fromString(record["lastUsed"].toString(), Qt::ISODate);
+            }
+        }
+    }
+    
+    // Хвост обрезается до дозаписи, иначе следующая запись склеится
+    // с оборванной строкой и пропадёт при следующей загрузке
+    const qint64 fileSize = file.size();
+    file.close();
+    if (validEnd < fileSize && !QFile::resize(m_dataPath + "/" + JOURNAL_FILE, validEnd)) {
+        savePasswords();
     }
 }
 
-void PasswordManager::savePasswords()
+void PasswordManager::appendJournal(const QByteArray &records)
 {
-    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-    QDir().mkpath(path);
-    QFile file(path + "/" + PASSWORDS_FILE);
+    if (!m_journal.isOpen()) {
+        m_journal.setFileName(m_dataPath + "/" + JOURNAL_FILE);
+        if (!m_journal.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            savePasswords();
+            return;
+        }
+    }
     
-    if (!file.open(QIODevice::WriteOnly)) {
+    if (m_journal.write(records) != records.size() || !m_journal.flush()) {
+        // Журнал недоступен - сохраняем полный снимок
+        m_journal.close();
+        savePasswords();
         return;
     }
+    
+    if (m_journal.size() > JOURNAL_COMPACT_THRESHOLD) {
+        savePasswords();
+    }
+}
 
-    QJsonObject root;
-    for (auto it = m_passwords.begin(); it != m_passwords.end(); ++it) {
-        QJsonArray entriesArray;
-        for (const auto &entry : it.value()) {
-            QJsonObject entryObj;
-            entryObj["url"] = entry.url;
-            entryObj["username"] = entry.username;
-            entryObj["password"] = entry.password;
-            entryObj["formData"] = entry.formData;
-            entryObj["lastUsed"] = entry.lastUsed.toString(Qt::ISODate);
-            entryObj["created"] = entry.created.toString(Qt::ISODate);
-            entryObj["useCount"] = entry.useCount;
-            entriesArray.append(entryObj);
+void PasswordManager::journalEntry(const PasswordEntry &entry)
+{
+    invalidateAudit(originKey(entry.url), entry.username);
+    
+    QJsonObject record;
+    record["op"] = "put";
+    record["entry"] = entryToJson(entry);
+    appendJournal(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void PasswordManager::journalRemoval(const QString &origin, const QString &username)
+{
+    QJsonObject record;
+    record["op"] = "remove";
+    record["origin"] = origin;
+    record["username"] = username;
+    appendJournal(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n');
+}
+
+void PasswordManager::flushTouches()
+{
+    m_touchTimer->stop();
+    if (m_pendingTouches.isEmpty()) {
+        return;
+    }
+    
+    // Все отметки за интервал - одной записью в журнал
+    QByteArray records;
+    for (const QPair<QString, QString> &key : std::as_const(m_pendingTouches)) {
+        const PasswordEntry *entry = findEntry(key.first, key.second);
+        if (!entry) {
+            continue;
         }
-        root[it.key()] = entriesArray;
+        QJsonObject record;
+        record["op"] = "touch";
+        record["origin"] = key.first;
+        record["username"] = key.second;
+        record["useCount"] = entry->useCount;
+        record["lastUsed"] = entry->lastUsed.toString(Qt::ISODate);
+        records += QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n';
     }
-
-    QJsonDocument doc(root);
-    file.write(doc.toJson());
+    m_pendingTouches.clear();
     
-    m_lastSync = QDateTime::currentDateTime();
-    m_settings.setValue("lastSync", m_lastSync);
+    if (!records.isEmpty()) {
+        appendJournal(records);
+    }
 }
 
 void PasswordManager::checkPasswordStrength(const QString &password)
 {
-    if (password.length() < 12) {
+    const int flags = PasswordAudit::classify(password, 12);
+    
+    if (flags & PasswordAudit::TooShort) {
         emit securityAlert("Рекомендуется использовать пароль длиной не менее 12 символов");
     }
     
-    if (!password.contains(QRegExp("[!@#$%^&*(),.?\":{}|<>]"))) {
+    if (flags & PasswordAudit::NoSpecial) {
         emit securityAlert("Рекомендуется использовать специальные символы в пароле");
     }
     
-    if (password.toLower() == password || password.toUpper() == password) {
+    if (flags & (PasswordAudit::NoLowercase | PasswordAudit::NoUppercase)) {
         emit securityAlert("Рекомендуется использовать буквы разных регистров");
     }
     
-    if (!password.contains(QRegExp("\\d"))) {
+    if (flags & PasswordAudit::NoDigit) {
         emit securityAlert("Рекомендуется использовать цифры в пароле");
     }
 }
 
+QString PasswordManager::auditKey(const QString &origin, const QString &username)
+{
+    return origin + QLatin1Char('\n') + username;
+}
+
+const PasswordAudit *PasswordManager::cachedAudit(const QString &origin,
+                                                  const PasswordEntry &entry) const
+{
+    // Результат годится, только пока шифротекст записи не менялся
+    auto it = m_audits.constFind(auditKey(origin, entry.username));
+    if (it == m_audits.constEnd() || it->sealed != entry.password) {
+        return nullptr;
+    }
+    return &it.value();
+}
+
+void PasswordManager::invalidateAudit(const QString &origin, const QString &username)
+{
+    m_audits.remove(auditKey(origin, username));
+    scheduleAudit();
+}
+
+void PasswordManager::scheduleAudit()
+{
+    m_auditRequested = true;
+    if (!isLocked() && !m_auditWatcher.isRunning()) {
+        m_auditTimer->start();
+    }
+}
+
+void PasswordManager::startAudit()
+{
+    if (isLocked() || m_auditWatcher.isRunning()) {
+        return;
+    }
+    m_auditRequested = false;
+    
+    // Проверяются только записи без актуального результата в кэше
+    QList<AuditJob> jobs;
+    QSet<QString> liveKeys;
+    for (auto it = m_passwords.constBegin(); it != m_passwords.constEnd(); ++it) {
+        for (const auto &entry : it.value()) {
+            const QString key = auditKey(it.key(), entry.username);
+            liveKeys.insert(key);
+            if (!cachedAudit(it.key(), entry)) {
+                jobs.append({key, entry.password, associatedData(entry.url, entry.username)});
+            }
+        }
+    }
+    
+    for (auto it = m_audits.begin(); it != m_audits.end();) {
+        if (!liveKeys.contains(it.key())) {
+            it = m_audits.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    if (jobs.isEmpty()) {
+        emit auditCompleted();
+        return;
+    }
+    
+    // Открытый текст существует только внутри рабочего потока
+    const PasswordVault *vault = &m_vault;
+    const BreachCorpus *corpus = &m_breachCorpus;
+    const int minLength = MIN_PASSWORD_LENGTH;
+    m_auditWatcher.setFuture(QtConcurrent::mapped(jobs, [vault, corpus, minLength](const AuditJob &job) {
+        PasswordAudit audit;
+        audit.key = job.key;
+        audit.sealed = job.sealed;
+        
+        bool ok = false;
+        const SecureBuffer plain = vault->decrypt(QByteArray::fromBase64(job.sealed.toLatin1()),
+                                                  job.associatedData, &ok);
+        if (ok) {
+            audit.flags = PasswordAudit::classify(plain.constData(), plain.size(),
+                                                  minLength, &audit.length);
+            audit.fingerprint = vault->fingerprint(plain.constData(), plain.size());
+            audit.breachCount = corpus->lookup(plain.constData(), plain.size());
+        }
+        return audit;
+    }));
+}
+
+void PasswordManager::cancelAudit()
+{
+    m_auditTimer->stop();
+    if (m_auditWatcher.isRunning()) {
+        m_auditWatcher.cancel();
+        m_auditWatcher.waitForFinished();
+    }
+}
+
+void PasswordManager::handleAuditFinished()
+{
+    const QFuture<PasswordAudit> future = m_auditWatcher.future();
+    if (!future.isCanceled()) {
+        for (int i = 0; i < future.resultCount(); ++i) {
+            const PasswordAudit audit = future.resultAt(i);
+            if (!audit.fingerprint.isEmpty()) {
+                m_audits.insert(audit.key, audit);
+            }
+        }
+    }
+    
+    // Записи, изменённые во время проверки, отбросит cachedAudit() по шифротексту
+    if (m_auditRequested) {
+        scheduleAudit();
+    }
+    if (!future.isCanceled()) {
+        emit auditCompleted();
+    }
+}
+
 QString PasswordManager::generateStrongPassword(int length) const
 {
     const QString lowercase = "abcdefghijklmnopqrstuvwxyz";
@@ -8,6 +8,16 @@
 #include <QCryptographicHash>
 #include <QSettings>
 #include <QUrl>
+#include <QFile>
+#include <QSet>
+#include <QPair>
+#include <QJsonObject>
+#include <QFutureWatcher>
+#include "passwordvault.h"
+#include "passwordaudit.h"
+#include "breachcorpus.h"
+
+class QTimer;
 
 struct PasswordEntry {
     QString url;
@@ -40,6 +50,7 @@ public:
     QString findPassword(const QString &url, const QString &username) const;
     QStringList findUsernames(const QString &url) const;
     QString findFormData(const QString &url, const QString &username) const;
+    void recordUse(const QString &url, const QString &username);
 
     // Управление исключениями
     void addToNeverSave(const QString &url);
@@ -54,6 +65,9 @@ public:
     bool importFromFirefox(const QString &filename);
 
     // Безопасность
+    bool unlock(const QString &masterPassword);
+    void lock();
+    bool isLocked() const;
     bool setMasterPassword(const QString &password);
     bool changeMasterPassword(const QString &oldPassword, const QString &newPassword);
     bool verifyMasterPassword(const QString &password) const;
@@ -65,6 +79,11 @@ public:
     QList<PasswordEntry> getWeakPasswords() const;
     QList<PasswordEntry> getReusedPasswords() const;
     QList<PasswordEntry> getOldPasswords() const;
+    
+    // Проверка по локальной базе утечек (см. BreachCorpus::convert)
+    bool loadBreachCorpus(const QString &fileName);
+    bool hasBreachCorpus() const;
+    QList<PasswordEntry> getBreachedPasswords() const;
 
 signals:
     void passwordAdded(const QString &url);
@@ -75,31 +94,77 @@ signals:
     void importCompleted(int count);
     void exportCompleted(int count);
     void securityAlert(const QString &message);
+    void lockedChanged(bool locked);
+    void auditCompleted();
 
 private:
-    QString encryptPassword(const QString &password) const;
-    QString decryptPassword(const QString &encrypted) const;
-    QString generateSalt() const;
-    QString hashPassword(const QString &password, const QString &salt) const;
+    QString encryptPassword(const QString &password, const QString &url,
+                            const QString &username) const;
+    SecureBuffer decryptPassword(const PasswordEntry &entry) const;
+    static QByteArray associatedData(const QString &url, const QString &username);
+    bool reencryptAll(const PasswordVault &from, const PasswordVault &to);
+    void migrateLegacyEntries();
+    void saveVaultParameters();
+    
+    // Индекс по источникам и сайтам
+    static QString originKey(const QString &url);
+    static QString siteKey(const QString &host);
+    void insertEntry(const PasswordEntry &entry);
+    void indexOrigin(const QString &origin);
+    void unindexOrigin(const QString &origin);
+    QList<const PasswordEntry *> matchingEntries(const QString &url) const;
+    PasswordEntry *findEntry(const QString &origin, const QString &username);
     bool validatePassword(const QString &password) const;
     void loadPasswords();
-    void savePasswords();
+    bool savePasswords();
+    
+    // Журнал изменений
+    static QJsonObject entryToJson(const PasswordEntry &entry);
+    static PasswordEntry entryFromJson(const QJsonObject &entryObj);
+    void replayJournal();
+    void appendJournal(const QByteArray &records);
+    void journalEntry(const PasswordEntry &entry);
+    void journalRemoval(const QString &origin, const QString &username);
+    void flushTouches();
     void checkPasswordStrength(const QString &password);
+    bool importCsv(const QString &filename);
+    
+    // Фоновая проверка паролей
+    static QString auditKey(const QString &origin, const QString &username);
+    const PasswordAudit *cachedAudit(const QString &origin, const PasswordEntry &entry) const;
+    void invalidateAudit(const QString &origin, const QString &username);
+    void scheduleAudit();
+    void startAudit();
+    void cancelAudit();
+    void handleAuditFinished();
     QString generateStrongPassword(int length = 16) const;
 
-    QHash<QString, QList<PasswordEntry>> m_passwords;
+    QHash<QString, QList<PasswordEntry>> m_passwords;   // источник -> записи
+    QHash<QString, QStringList> m_siteOrigins;          // регистрируемый домен -> источники
     QStringList m_neverSaveList;
-    QString m_masterPasswordHash;
-    QString m_salt;
-    QString m_encryptionKey;
+    PasswordVault m_vault;
+    BreachCorpus m_breachCorpus;
+    QString m_legacyKey; // ключ XOR-шифрования старых версий, до миграции
     QDateTime m_lastSync;
     QSettings m_settings;
+    QString m_dataPath;
+    QFile m_journal;
+    QTimer *m_touchTimer;
+    QSet<QPair<QString, QString>> m_pendingTouches; // источник, имя пользователя
+    QHash<QString, PasswordAudit> m_audits;            // источник + имя -> результат проверки
+    QFutureWatcher<PasswordAudit> m_auditWatcher;
+    QTimer *m_auditTimer;
+    bool m_auditRequested;
     
     static const int MIN_PASSWORD_LENGTH = 8;
     static const int MAX_PASSWORD_LENGTH = 64;
-    static const int SALT_LENGTH = 16;
     static const QString CONFIG_FILE;
     static const QString PASSWORDS_FILE;
+    static const QString JOURNAL_FILE;
+    static const qint64 JOURNAL_COMPACT_THRESHOLD = 256 * 1024;
+    static const int TOUCH_FLUSH_DELAY = 5000; // мс
+    static const int AUDIT_DELAY = 1000;       // мс
+    static const int IMPORT_BATCH_SIZE = 1000;
 };
 
 #endif // PASSWORDMANAGER_H 
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "passwordvault.h"
+#include <QRandomGenerator>
+#include <QStringEncoder>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include <cstring>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+const QByteArray PasswordVault::CHECK_PLAINTEXT = "brouser-password-vault";
+const QByteArray PasswordVault::FINGERPRINT_LABEL = "brouser-password-fingerprint";
+
+namespace {
+
+int pageSize()
+{
+#if defined(Q_OS_WIN)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return int(info.dwPageSize);
+#else
+    return int(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+QByteArray randomBytes(int size)
+{
+    QByteArray result(size, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(result.data()), size / 4);
+    return result;
+}
+
+}
+
+// ---------------------------------------------------------------------------
+// SecureBuffer
+// ---------------------------------------------------------------------------
+
+SecureBuffer::SecureBuffer()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+{
+}
+
+SecureBuffer::SecureBuffer(int size)
+    : m_data(nullptr)
+    , m_size(0)
+    , m_capacity(0)
+{
+    if (size <= 0) {
+        return;
+    }
+    
+    // Выделяем целые страницы, чтобы закрепление не касалось чужих данных
+    const int page = pageSize();
+    m_capacity = (size + page - 1) / page * page;
+    m_data = static_cast<char *>(qMallocAligned(m_capacity, page));
+    if (!m_data) {
+        m_capacity = 0;
+        return;
+    }
+    m_size = size;
+    
+#if defined(Q_OS_WIN)
+    VirtualLock(m_data, m_capacity);
+#else
+    mlock(m_data, m_capacity);
+#endif
+}
+
+SecureBuffer::~SecureBuffer()
+{
+    clear();
+}
+
+SecureBuffer::SecureBuffer(SecureBuffer &&other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_capacity(other.m_capacity)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_capacity = 0;
+}
+
+SecureBuffer &SecureBuffer::operator=(SecureBuffer &&other) noexcept
+{
+    if (this != &other) {
+        clear();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        other.m_data = nullptr;
+        other.m_size = 0;
+        other.m_capacity = 0;
+    }
+    return *this;
+}
+
+void SecureBuffer::truncate(int size)
+{
+    if (size < m_size) {
+        OPENSSL_cleanse(m_data + size, m_size - size);
+        m_size = qMax(0, size);
+    }
+}
+
+void SecureBuffer::clear()
+{
+    if (!m_data) {
+        return;
+    }
+    
+    OPENSSL_cleanse(m_data, m_capacity);
+#if defined(Q_OS_WIN)
+    VirtualUnlock(m_data, m_capacity);
+#else
+    munlock(m_data, m_capacity);
+#endif
+    qFreeAligned(m_data);
+    
+    m_data = nullptr;
+    m_size = 0;
+    m_capacity = 0;
+}
+
+QString SecureBuffer::toString() const
+{
+    return QString::fromUtf8(m_data, m_size);
+}
+
+// ---------------------------------------------------------------------------
+// PasswordVault
+// ---------------------------------------------------------------------------
+
+PasswordVault::PasswordVault()
+    : m_iterations(DEFAULT_ITERATIONS)
+{
+}
+
+PasswordVault::~PasswordVault()
+{
+    lock();
+}
+
+void PasswordVault::setParameters(const QByteArray &salt, int iterations, const QByteArray &check)
+{
+    lock();
+    m_salt = salt;
+    m_iterations = iterations > 0 ? iterations : DEFAULT_ITERATIONS;
+    m_check = check;
+}
+
+bool PasswordVault::create(const QString &masterPassword, int iterations)
+{
+    m_salt = randomBytes(SALT_SIZE);
+    m_iterations = iterations;
+    m_key = deriveKey(masterPassword, m_salt, m_iterations);
+    if (m_key.isEmpty()) {
+        return false;
+    }
+    
+    // Контрольное значение: успешная расшифровка подтверждает пароль
+    m_check = seal(m_key, CHECK_PLAINTEXT, QByteArray());
+    return !m_check.isEmpty() && deriveFingerprintKey();
+}
+
+bool PasswordVault::unlock(const QString &masterPassword)
+{
+    if (!isInitialized()) {
+        return false;
+    }
+    
+    SecureBuffer key = deriveKey(masterPassword, m_salt, m_iterations);
+    bool ok = false;
+    open(key, m_check, QByteArray(), &ok);
+    if (!ok) {
+        return false;
+    }
+    
+    m_key = std::move(key);
+    return deriveFingerprintKey();
+}
+
+void PasswordVault::lock()
+{
+    m_key.clear();
+    m_fingerprintKey.clear();
+}
+
+bool PasswordVault::deriveFingerprintKey()
+{
+    // Отдельный ключ, чтобы отпечатки не зависели напрямую от ключа шифрования
+    SecureBuffer key(KEY_SIZE);
+    unsigned int length = 0;
+    if (!HMAC(EVP_sha256(), m_key.constData(), m_key.size(),
+              reinterpret_cast<const unsigned char *>(FINGERPRINT_LABEL.constData()),
+              FINGERPRINT_LABEL.size(),
+              reinterpret_cast<unsigned char *>(key.data()), &length)) {
+        lock();
+        return false;
+    }
+    
+    key.truncate(static_cast<int>(length));
+    m_fingerprintKey = std::move(key);
+    return true;
+}
+
+QByteArray PasswordVault::fingerprint(const char *data, int size) const
+{
+    if (m_fingerprintKey.isEmpty()) {
+        return QByteArray();
+    }
+    
+    QByteArray result(EVP_MAX_MD_SIZE, Qt::Uninitialized);
+    unsigned int length = 0;
+    if (!HMAC(EVP_sha256(), m_fingerprintKey.constData(), m_fingerprintKey.size(),
+              reinterpret_cast<const unsigned char *>(data), static_cast<size_t>(size),
+              reinterpret_cast<unsigned char *>(result.data()), &length)) {
+        return QByteArray();
+    }
+    result.truncate(static_cast<int>(length));
+    return result;
+}
+
+bool PasswordVault::checkPassword(const QString &masterPassword) const
+{
+    if (!isInitialized()) {
+        return false;
+    }
+    
+    bool ok = false;
+    open(deriveKey(masterPassword, m_salt, m_iterations), m_check, QByteArray(), &ok);
+    return ok;
+}
+
+QByteArray PasswordVault::encrypt(const QByteArray &plaintext, const QByteArray &associatedData) const
+{
+    if (!isUnlocked()) {
+        return QByteArray();
+    }
+    return seal(m_key, plaintext, associatedData);
+}
+
+SecureBuffer PasswordVault::decrypt(const QByteArray &sealed, const QByteArray &associatedData,
+                                    bool *ok) const
+{
+    if (!isUnlocked()) {
+        if (ok) {
+            *ok = false;
+        }
+        return SecureBuffer();
+    }
+    return open(m_key, sealed, associatedData, ok);
+}
+
+SecureBuffer PasswordVault::deriveKey(const QString &masterPassword, const QByteArray &salt,
+                                      int iterations)
+{
+    // UTF-8 пишется сразу в защищённый буфер, без промежуточной копии
+    QStringEncoder encoder(QStringEncoder::Utf8);
+    SecureBuffer password(int(encoder.requiredSpace(masterPassword.size())));
+    const char *end = encoder.appendToBuffer(password.data(), masterPassword);
+    password.truncate(int(end - password.constData()));
+    
+    SecureBuffer key(KEY_SIZE);
+    if (PKCS5_PBKDF2_HMAC(password.constData(), password.size(),
+                          reinterpret_cast<const unsigned char *>(salt.constData()), salt.size(),
+                          iterations, EVP_sha256(), KEY_SIZE,
+                          reinterpret_cast<unsigned char *>(key.data())) != 1) {
+        return SecureBuffer();
+    }
+    return key;
+}
+
+QByteArray PasswordVault::seal(const SecureBuffer &key, const QByteArray &plaintext,
+                               const QByteArray &associatedData)
+{
+    if (key.size() != KEY_SIZE) {
+        return QByteArray();
+    }
+    
+    // EVP сам выбирает аппаратную реализацию AES (AES-NI, ARMv8 Crypto)
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        return QByteArray();
+    }
+    
+    QByteArray result(NONCE_SIZE + plaintext.size() + TAG_SIZE, Qt::Uninitialized);
+    unsigned char *out = reinterpret_cast<unsigned char *>(result.data());
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(out), NONCE_SIZE / 4);
+    
+    int length = 0;
+    bool ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 reinterpret_cast<const unsigned char *>(key.constData()), out) == 1;
+    if (ok && !associatedData.isEmpty()) {
+        ok = EVP_EncryptUpdate(ctx, nullptr, &length,
+                               reinterpret_cast<const unsigned char *>(associatedData.constData()),
+                               associatedData.size()) == 1;
+    }
+    if (ok) {
+        ok = EVP_EncryptUpdate(ctx, out + NONCE_SIZE, &length,
+                               reinterpret_cast<const unsigned char *>(plaintext.constData()),
+                               plaintext.size()) == 1;
+    }
+    if (ok) {
+        ok = EVP_EncryptFinal_ex(ctx, out + NONCE_SIZE + length, &length) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_SIZE,
+                                 out + NONCE_SIZE + plaintext.size()) == 1;
+    }
+    
+    EVP_CIPHER_CTX_free(ctx);
+    return ok ? result : QByteArray();
+}
+
+SecureBuffer PasswordVault::open(const SecureBuffer &key, const QByteArray &sealed,
+                                 const QByteArray &associatedData, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (key.size() != KEY_SIZE || sealed.size() < NONCE_SIZE + TAG_SIZE) {
+        return SecureBuffer();
+    }
+    
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        return SecureBuffer();
+    }
+    
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(sealed.constData());
+    const int cipherSize = sealed.size() - NONCE_SIZE - TAG_SIZE;
+    SecureBuffer plaintext(qMax(cipherSize, 1));
+    unsigned char *out = reinterpret_cast<unsigned char *>(plaintext.data());
+    
+    int length = 0;
+    bool success = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                      reinterpret_cast<const unsigned char *>(key.constData()),
+                                      in) == 1;
+    if (success && !associatedData.isEmpty()) {
+        success = EVP_DecryptUpdate(ctx, nullptr, &length,
+                                    reinterpret_cast<const unsigned char *>(associatedData.constData()),
+                                    associatedData.size()) == 1;
+    }
+    if (success) {
+        success = EVP_DecryptUpdate(ctx, out, &length, in + NONCE_SIZE, cipherSize) == 1;
+    }
+    if (success) {
+        // Тег проверяется в EVP_DecryptFinal_ex: изменённые данные не пройдут
+        success = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_SIZE,
+                                      const_cast<unsigned char *>(in + NONCE_SIZE + cipherSize)) == 1 &&
+                  EVP_DecryptFinal_ex(ctx, out + length, &length) == 1;
+    }
+    
+    EVP_CIPHER_CTX_free(ctx);
+    if (!success) {
+        return SecureBuffer();
+    }
+    
+    plaintext.truncate(cipherSize);
+    if (ok) {
+        *ok = true;
+    }
+    return plaintext;
+}
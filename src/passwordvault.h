@@ -0,0 +1,99 @@
+#ifndef PASSWORDVAULT_H
+#define PASSWORDVAULT_H
+
+#include <QByteArray>
+#include <QString>
+
+// Буфер для ключей и расшифрованных паролей: занимает собственные страницы,
+// закреплённые в памяти (не попадают в swap), и затирается при освобождении.
+class SecureBuffer
+{
+public:
+    SecureBuffer();
+    explicit SecureBuffer(int size);
+    ~SecureBuffer();
+    
+    SecureBuffer(SecureBuffer &&other) noexcept;
+    SecureBuffer &operator=(SecureBuffer &&other) noexcept;
+    SecureBuffer(const SecureBuffer &) = delete;
+    SecureBuffer &operator=(const SecureBuffer &) = delete;
+    
+    char *data() { return m_data; }
+    const char *constData() const { return m_data; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    void truncate(int size);
+    void clear();
+    
+    QString toString() const;
+
+private:
+    char *m_data;
+    int m_size;
+    int m_capacity;
+};
+
+// Хранилище паролей: ключ AES-256 выводится из мастер-пароля через
+// PBKDF2-HMAC-SHA256 один раз при разблокировке, каждая запись шифруется
+// AES-256-GCM со случайным nonce. Запись привязана к своему адресу и
+// имени пользователя через associated data.
+class PasswordVault
+{
+public:
+    PasswordVault();
+    ~PasswordVault();
+    PasswordVault(PasswordVault &&other) = default;
+    PasswordVault &operator=(PasswordVault &&other) = default;
+    
+    // Параметры хранилища, сохраняемые вместе с ним
+    QByteArray salt() const { return m_salt; }
+    int iterations() const { return m_iterations; }
+    QByteArray checkValue() const { return m_check; }
+    void setParameters(const QByteArray &salt, int iterations, const QByteArray &check);
+    bool isInitialized() const { return !m_salt.isEmpty() && !m_check.isEmpty(); }
+    
+    bool create(const QString &masterPassword, int iterations = DEFAULT_ITERATIONS);
+    bool unlock(const QString &masterPassword);
+    void lock();
+    bool isUnlocked() const { return !m_key.isEmpty(); }
+    
+    // Проверка пароля без смены текущего ключа
+    bool checkPassword(const QString &masterPassword) const;
+    
+    // nonce (12 байт) | шифротекст | тег (16 байт)
+    QByteArray encrypt(const QByteArray &plaintext, const QByteArray &associatedData) const;
+    SecureBuffer decrypt(const QByteArray &sealed, const QByteArray &associatedData,
+                         bool *ok = nullptr) const;
+    
+    // HMAC-SHA256 открытого пароля на отдельном ключе хранилища: одинаковые
+    // пароли дают одинаковый отпечаток, но подобрать пароль по нему без
+    // мастер-пароля нельзя
+    QByteArray fingerprint(const char *data, int size) const;
+    
+    static SecureBuffer deriveKey(const QString &masterPassword, const QByteArray &salt,
+                                  int iterations);
+    static QByteArray seal(const SecureBuffer &key, const QByteArray &plaintext,
+                           const QByteArray &associatedData);
+    static SecureBuffer open(const SecureBuffer &key, const QByteArray &sealed,
+                             const QByteArray &associatedData, bool *ok);
+    
+    static const int DEFAULT_ITERATIONS = 600000;
+    static const int KEY_SIZE = 32;
+    static const int NONCE_SIZE = 12;
+    static const int TAG_SIZE = 16;
+    static const int SALT_SIZE = 16;
+
+private:
+    QByteArray m_salt;
+    int m_iterations;
+    QByteArray m_check;
+    SecureBuffer m_key;
+    SecureBuffer m_fingerprintKey;
+    
+    bool deriveFingerprintKey();
+    
+    static const QByteArray CHECK_PLAINTEXT;
+    static const QByteArray FINGERPRINT_LABEL;
+};
+
+#endif // PASSWORDVAULT_H
@@ -16,6 +16,7 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QTimer>
+#include "faviconstore.h"
 
 const QString PrivacyManager::SETTINGS_FILE = "privacy_settings.json";
 
@@ -271,6 +272,7 @@ void PrivacyManager::clearBrowsingData(const QDateTime &start, const QDateTime &
 {
     m_profile->clearHttpCache();
     m_profile->clearAllVisitedLinks();
+    FaviconStore::instance()->clear();
     
     // Очистка истории
     emit dataCleared("browsing-data");
@@ -0,0 +1,105 @@
+#include "publicsuffix.h"
+#include <QFile>
+#include <QTextStream>
+#include <QUrl>
+#include <QHostAddress>
+
+const QString PublicSuffixList::SUFFIX_LIST_FILE = ":/resources/config/public_suffix_list.dat";
+
+PublicSuffixList::PublicSuffixList(const QString &fileName)
+{
+    load(fileName);
+}
+
+const PublicSuffixList &PublicSuffixList::instance()
+{
+    static const PublicSuffixList list;
+    return list;
+}
+
+bool PublicSuffixList::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    
+    m_rules.clear();
+    m_wildcards.clear();
+    m_exceptions.clear();
+    
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        // Правило - первое слово строки, комментарии начинаются с //
+        const QString line = stream.readLine().section(QLatin1Char(' '), 0, 0).trimmed();
+        if (line.isEmpty() || line.startsWith(QLatin1String("//"))) {
+            continue;
+        }
+        
+        // Хосты сравниваются в ACE-форме, правила для IDN переводим так же
+        if (line.startsWith(QLatin1Char('!'))) {
+            m_exceptions.insert(QString::fromLatin1(QUrl::toAce(line.mid(1))));
+        } else if (line.startsWith(QLatin1String("*."))) {
+            m_wildcards.insert(QString::fromLatin1(QUrl::toAce(line.mid(2))));
+        } else {
+            m_rules.insert(QString::fromLatin1(QUrl::toAce(line)));
+        }
+    }
+    return true;
+}
+
+int PublicSuffixList::suffixLabelCount(const QStringList &labels, bool *listed) const
+{
+    if (listed) {
+        *listed = true;
+    }
+    
+    // Ищем самое длинное совпавшее правило: перебор от полного хоста к TLD
+    const int count = labels.size();
+    for (int i = 0; i < count; ++i) {
+        const QString candidate = labels.mid(i).join(QLatin1Char('.'));
+        if (m_exceptions.contains(candidate)) {
+            return count - i - 1;
+        }
+        if (m_rules.contains(candidate)) {
+            return count - i;
+        }
+        if (i + 1 < count && m_wildcards.contains(labels.mid(i + 1).join(QLatin1Char('.')))) {
+            return count - i;
+        }
+    }
+    
+    // Правило по умолчанию "*": суффикс - последняя метка
+    if (listed) {
+        *listed = false;
+    }
+    return 1;
+}
+
+QString PublicSuffixList::registrableDomain(const QString &host, bool *listed) const
+{
+    if (listed) {
+        *listed = false;
+    }
+    
+    QString normalized = host.toLower();
+    if (normalized.endsWith(QLatin1Char('.'))) {
+        normalized.chop(1);
+    }
+    if (normalized.isEmpty() || !QHostAddress(normalized).isNull()) {
+        return normalized;
+    }
+    
+    const QStringList labels = normalized.split(QLatin1Char('.'));
+    const int suffix = suffixLabelCount(labels, listed);
+    if (suffix >= labels.size()) {
+        return normalized;
+    }
+    return labels.mid(labels.size() - suffix - 1).join(QLatin1Char('.'));
+}
+
+bool PublicSuffixList::isPublicSuffix(const QString &host) const
+{
+    const QStringList labels = host.toLower().split(QLatin1Char('.'));
+    return suffixLabelCount(labels) >= labels.size();
+}
@@ -0,0 +1,33 @@
+#ifndef PUBLICSUFFIX_H
+#define PUBLICSUFFIX_H
+
+#include <QString>
+#include <QSet>
+
+// Список публичных суффиксов (publicsuffix.org) для определения
+// регистрируемого домена: mail.example.co.uk -> example.co.uk
+class PublicSuffixList
+{
+public:
+    explicit PublicSuffixList(const QString &fileName = SUFFIX_LIST_FILE);
+    static const PublicSuffixList &instance();
+    
+    bool load(const QString &fileName);
+    
+    // Хост в нижнем регистре и ACE-форме; для IP-адресов и самих
+    // публичных суффиксов возвращается хост без изменений. listed - суффикс
+    // найден в списке, а не получен правилом по умолчанию "*".
+    QString registrableDomain(const QString &host, bool *listed = nullptr) const;
+    bool isPublicSuffix(const QString &host) const;
+
+    static const QString SUFFIX_LIST_FILE;
+
+private:
+    int suffixLabelCount(const QStringList &labels, bool *listed = nullptr) const;
+    
+    QSet<QString> m_rules;       // com, co.uk
+    QSet<QString> m_wildcards;   // *.ck -> ck
+    QSet<QString> m_exceptions;  // !www.ck -> www.ck
+};
+
+#endif // PUBLICSUFFIX_H
@@ -0,0 +1,332 @@
+#include "revocationcache.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QCryptographicHash>
+#include <openssl/ocsp.h>
+#include <openssl/pem.h>
+#include <openssl/x509v3.h>
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+template <typename T, void (*Free)(T *)>
+struct OpenSslDeleter {
+    void operator()(T *object) const { Free(object); }
+};
+using X509Ptr = std::unique_ptr<X509, OpenSslDeleter<X509, X509_free>>;
+using CrlPtr = std::unique_ptr<X509_CRL, OpenSslDeleter<X509_CRL, X509_CRL_free>>;
+using OcspResponsePtr = std::unique_ptr<OCSP_RESPONSE, OpenSslDeleter<OCSP_RESPONSE, OCSP_RESPONSE_free>>;
+using OcspBasicPtr = std::unique_ptr<OCSP_BASICRESP, OpenSslDeleter<OCSP_BASICRESP, OCSP_BASICRESP_free>>;
+using OcspIdPtr = std::unique_ptr<OCSP_CERTID, OpenSslDeleter<OCSP_CERTID, OCSP_CERTID_free>>;
+using OcspRequestPtr = std::unique_ptr<OCSP_REQUEST, OpenSslDeleter<OCSP_REQUEST, OCSP_REQUEST_free>>;
+using StorePtr = std::unique_ptr<X509_STORE, OpenSslDeleter<X509_STORE, X509_STORE_free>>;
+
+X509Ptr parseCertificate(const QSslCertificate &certificate)
+{
+    const QByteArray der = certificate.toDer();
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(der.constData());
+    return X509Ptr(d2i_X509(nullptr, &data, der.size()));
+}
+
+// CRL приходят и в DER (из точек распространения), и в PEM (файлы)
+CrlPtr parseCrl(const QByteArray &data)
+{
+    if (data.startsWith("-----BEGIN")) {
+        BIO *bio = BIO_new_mem_buf(data.constData(), data.size());
+        CrlPtr crl(PEM_read_bio_X509_CRL(bio, nullptr, nullptr, nullptr));
+        BIO_free(bio);
+        return crl;
+    }
+    const unsigned char *der = reinterpret_cast<const unsigned char *>(data.constData());
+    return CrlPtr(d2i_X509_CRL(nullptr, &der, data.size()));
+}
+
+QByteArray nameHash(const X509_NAME *name)
+{
+    const unsigned char *der = nullptr;
+    size_t length = 0;
+    if (!name || !X509_NAME_get0_der(const_cast<X509_NAME *>(name), &der, &length)) {
+        return QByteArray();
+    }
+    return QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(der),
+                                                            static_cast<int>(length)),
+                                    QCryptographicHash::Sha256);
+}
+
+QByteArray octets(const ASN1_STRING *string)
+{
+    if (!string) {
+        return QByteArray();
+    }
+    return QByteArray(reinterpret_cast<const char *>(ASN1_STRING_get0_data(string)),
+                      ASN1_STRING_length(string));
+}
+
+QDateTime toDateTime(const ASN1_TIME *time)
+{
+    struct tm parts;
+    if (!time || !ASN1_TIME_to_tm(time, &parts)) {
+        return QDateTime();
+    }
+    return QDateTime(QDate(parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday),
+                     QTime(parts.tm_hour, parts.tm_min, parts.tm_sec), Qt::UTC);
+}
+
+QUrl ocspResponder(X509 *certificate)
+{
+    QUrl url;
+    STACK_OF(OPENSSL_STRING) *responders = X509_get1_ocsp(certificate);
+    if (responders && sk_OPENSSL_STRING_num(responders) > 0) {
+        url = QUrl(QString::fromLatin1(sk_OPENSSL_STRING_value(responders, 0)));
+    }
+    X509_email_free(responders);
+    return url;
+}
+
+QUrl crlDistributionPoint(X509 *certificate)
+{
+    QUrl url;
+    auto *points = static_cast<STACK_OF(DIST_POINT) *>(
+        X509_get_ext_d2i(certificate, NID_crl_distribution_points, nullptr, nullptr));
+    for (int i = 0; points && url.isEmpty() && i < sk_DIST_POINT_num(points); ++i) {
+        const DIST_POINT *point = sk_DIST_POINT_value(points, i);
+        if (!point->distpoint || point->distpoint->type != 0) {
+            continue;
+        }
+        const GENERAL_NAMES *names = point->distpoint->name.fullname;
+        for (int j = 0; j < sk_GENERAL_NAME_num(names); ++j) {
+            const GENERAL_NAME *name = sk_GENERAL_NAME_value(names, j);
+            if (name->type == GEN_URI) {
+                const QUrl candidate(QString::fromLatin1(octets(name->d.uniformResourceIdentifier)));
+                if (candidate.scheme() == "http") {
+                    url = candidate;
+                    break;
+                }
+            }
+        }
+    }
+    CRL_DIST_POINTS_free(points);
+    return url;
+}
+
+}
+
+RevocationCache::RevocationCache(QObject *parent)
+    : QObject(parent)
+    , m_network(new QNetworkAccessManager(this))
+{
+}
+
+QByteArray RevocationCache::issuerKey(const QByteArray &nameHash, const QByteArray &keyId)
+{
+    return nameHash + keyId;
+}
+
+QByteArray RevocationCache::certificateKey(const CertificateKeys &keys)
+{
+    return issuerKey(keys.issuer, keys.authorityKeyId) + '/' + keys.serialNumber;
+}
+
+RevocationCache::Status RevocationCache::status(const CertificateKeys &keys) const
+{
+    if (keys.serialNumber.isEmpty()) {
+        return Unknown;
+    }
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    
+    // Ответ OCSP свежее любого CRL, поэтому проверяется первым
+    auto ocsp = m_ocsp.constFind(certificateKey(keys));
+    if (ocsp != m_ocsp.constEnd() && ocsp->nextUpdate > now) {
+        return ocsp->status;
+    }
+    
+    auto crl = m_crls.constFind(issuerKey(keys.issuer, keys.authorityKeyId));
+    if (crl == m_crls.constEnd() || crl->nextUpdate <= now) {
+        return Unknown;
+    }
+    return std::binary_search(crl->serials.constBegin(), crl->serials.constEnd(), keys.serialNumber)
+        ? Revoked : Good;
+}
+
+bool RevocationCache::addCrl(const QByteArray &data, const QSslCertificate &issuer)
+{
+    CrlPtr crl = parseCrl(data);
+    X509Ptr issuerX509 = parseCertificate(issuer);
+    if (!crl || !issuerX509 ||
+        X509_NAME_cmp(X509_CRL_get_issuer(crl.get()), X509_get_subject_name(issuerX509.get())) != 0 ||
+        X509_CRL_verify(crl.get(), X509_get0_pubkey(issuerX509.get())) != 1) {
+        return false;
+    }
+    
+    CrlEntry entry;
+    entry.nextUpdate = toDateTime(X509_CRL_get0_nextUpdate(crl.get()));
+    if (!entry.nextUpdate.isValid()) {
+        entry.nextUpdate = QDateTime::currentDateTimeUtc().addSecs(DEFAULT_LIFETIME);
+    }
+    if (entry.nextUpdate <= QDateTime::currentDateTimeUtc()) {
+        return false;
+    }
+    
+    STACK_OF(X509_REVOKED) *revoked = X509_CRL_get_REVOKED(crl.get());
+    const int count = sk_X509_REVOKED_num(revoked);
+    entry.serials.reserve(qMax(0, count));
+    for (int i = 0; i < count; ++i) {
+        entry.serials.append(octets(X509_REVOKED_get0_serialNumber(sk_X509_REVOKED_value(revoked, i))));
+    }
+    std::sort(entry.serials.begin(), entry.serials.end());
+    
+    // Сертификаты без AKI ищут издателя только по имени
+    const CertificateKeys keys = CertificateKeys::fromCertificate(issuer);
+    m_crls.insert(issuerKey(keys.subject, keys.subjectKeyId), entry);
+    if (!keys.subjectKeyId.isEmpty()) {
+        m_crls.insert(issuerKey(keys.subject, QByteArray()), entry);
+    }
+    emit updated();
+    return true;
+}
+
+bool RevocationCache::addOcspResponse(const QByteArray &data, const QSslCertificate &certificate,
+                                      const QSslCertificate &issuer)
+{
+    const unsigned char *der = reinterpret_cast<const unsigned char *>(data.constData());
+    OcspResponsePtr response(d2i_OCSP_RESPONSE(nullptr, &der, data.size()));
+    if (!response || OCSP_response_status(response.get()) != OCSP_RESPONSE_STATUS_SUCCESSFUL) {
+        return false;
+    }
+    OcspBasicPtr basic(OCSP_response_get1_basic(response.get()));
+    X509Ptr certificateX509 = parseCertificate(certificate);
+    X509Ptr issuerX509 = parseCertificate(issuer);
+    if (!basic || !certificateX509 || !issuerX509) {
+        return false;
+    }
+    
+    // Ответ подписан самим издателем или его делегированным ответчиком.
+    // Издатель обычно промежуточный CA: без PARTIAL_CHAIN цепочка ответчика
+    // не сошлась бы без корня. Что ответчик выпущен именно издателем и имеет
+    // EKU OCSPSigning, проверяет OCSP_basic_verify
+    StorePtr store(X509_STORE_new());
+    X509_STORE_add_cert(store.get(), issuerX509.get());
+    X509_STORE_set_flags(store.get(), X509_V_FLAG_PARTIAL_CHAIN);
+    STACK_OF(X509) *signers = sk_X509_new_null();
+    sk_X509_push(signers, issuerX509.get());
+    const bool verified = OCSP_basic_verify(basic.get(), signers, store.get(), OCSP_TRUSTOTHER) > 0;
+    sk_X509_free(signers);
+    if (!verified) {
+        return false;
+    }
+    
+    OcspIdPtr id(OCSP_cert_to_id(EVP_sha1(), certificateX509.get(), issuerX509.get()));
+    int certificateStatus = 0;
+    int reason = 0;
+    ASN1_GENERALIZEDTIME *revokedAt = nullptr;
+    ASN1_GENERALIZEDTIME *thisUpdate = nullptr;
+    ASN1_GENERALIZEDTIME *nextUpdate = nullptr;
+    if (!id || !OCSP_resp_find_status(basic.get(), id.get(), &certificateStatus, &reason,
+                                      &revokedAt, &thisUpdate, &nextUpdate) ||
+        !OCSP_check_validity(thisUpdate, nextUpdate, CLOCK_SKEW, -1)) {
+        return false;
+    }
+    
+    OcspEntry entry;
+    switch (certificateStatus) {
+    case V_OCSP_CERTSTATUS_GOOD:
+        entry.status = Good;
+        break;
+    case V_OCSP_CERTSTATUS_REVOKED:
+        entry.status = Revoked;
+        break;
+    default:
+        return false;
+    }
+    entry.nextUpdate = toDateTime(nextUpdate);
+    if (!entry.nextUpdate.isValid()) {
+        entry.nextUpdate = QDateTime::currentDateTimeUtc().addSecs(DEFAULT_LIFETIME);
+    }
+    
+    m_ocsp.insert(certificateKey(CertificateKeys::fromCertificate(certificate)), entry);
+    emit updated();
+    return true;
+}
+
+void RevocationCache::refresh(const QSslCertificate &certificate, const QSslCertificate &issuer)
+{
+    const QByteArray key = certificateKey(CertificateKeys::fromCertificate(certificate));
+    const QDateTime now = QDateTime::currentDateTimeUtc();
+    auto attempt = m_attempts.constFind(key);
+    if (attempt != m_attempts.constEnd() && attempt->secsTo(now) < RETRY_DELAY) {
+        return;
+    }
+    
+    X509Ptr certificateX509 = parseCertificate(certificate);
+    X509Ptr issuerX509 = parseCertificate(issuer);
+    if (!certificateX509 || !issuerX509) {
+        return;
+    }
+    
+    QNetworkReply *reply = nullptr;
+    bool ocsp = true;
+    QUrl url = m_responderUrl.isEmpty() ? ocspResponder(certificateX509.get()) : m_responderUrl;
+    if (!url.isEmpty()) {
+        OcspRequestPtr request(OCSP_REQUEST_new());
+        OCSP_CERTID *id = OCSP_cert_to_id(EVP_sha1(), certificateX509.get(), issuerX509.get());
+        if (!request || !id || !OCSP_request_add0_id(request.get(), id)) {
+            OCSP_CERTID_free(id);
+            return;
+        }
+        QByteArray body(i2d_OCSP_REQUEST(request.get(), nullptr), Qt::Uninitialized);
+        unsigned char *out = reinterpret_cast<unsigned char *>(body.data());
+        i2d_OCSP_REQUEST(request.get(), &out);
+        
+        QNetworkRequest networkRequest(url);
+        networkRequest.setHeader(QNetworkRequest::ContentTypeHeader, "application/ocsp-request");
+        reply = m_network->post(networkRequest, body);
+    } else {
+        url = crlDistributionPoint(certificateX509.get());
+        if (url.isEmpty()) {
+            return;
+        }
+        ocsp = false;
+        reply = m_network->get(QNetworkRequest(url));
+    }
+    m_attempts.insert(key, now);
+    
+    connect(reply, &QNetworkReply::finished, this, [this, reply, ocsp, certificate, issuer]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
+            return;
+        }
+        const QByteArray data = reply->readAll();
+        if (ocsp) {
+            addOcspResponse(data, certificate, issuer);
+        } else {
+            addCrl(data, issuer);
+        }
+    });
+}
+
+CertificateKeys RevocationCache::crlIssuer(const QByteArray &data)
+{
+    CertificateKeys keys;
+    CrlPtr crl = parseCrl(data);
+    if (!crl) {
+        return keys;
+    }
+    keys.issuer = nameHash(X509_CRL_get_issuer(crl.get()));
+    auto *keyId = static_cast<AUTHORITY_KEYID *>(
+        X509_CRL_get_ext_d2i(crl.get(), NID_authority_key_identifier, nullptr, nullptr));
+    if (keyId) {
+        keys.authorityKeyId = octets(keyId->keyid);
+        AUTHORITY_KEYID_free(keyId);
+    }
+    return keys;
+}
+
+void RevocationCache::clear()
+{
+    m_crls.clear();
+    m_ocsp.clear();
+    m_attempts.clear();
+    emit updated();
+}
@@ -0,0 +1,74 @@
+#ifndef REVOCATIONCACHE_H
+#define REVOCATIONCACHE_H
+
+#include <QObject>
+#include <QSslCertificate>
+#include <QDateTime>
+#include <QHash>
+#include <QUrl>
+#include "certificateindex.h"
+
+class QNetworkAccessManager;
+
+// Данные об отзыве в памяти: списки CRL - отсортированные серийные номера
+// по издателю, ответы OCSP - по сертификату до nextUpdate. Проверка при
+// валидации - только поиск в памяти; загрузка идёт в фоне.
+class RevocationCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Status {
+        Unknown,
+        Good,
+        Revoked
+    };
+    
+    explicit RevocationCache(QObject *parent = nullptr);
+    
+    Status status(const CertificateKeys &keys) const;
+    
+    // Подпись CRL и ответа OCSP проверяется ключом издателя
+    bool addCrl(const QByteArray &data, const QSslCertificate &issuer);
+    bool addOcspResponse(const QByteArray &data, const QSslCertificate &certificate,
+                         const QSslCertificate &issuer);
+    
+    // Фоновый запрос к OCSP-ответчику или точке распространения CRL
+    // из сертификата; повторные запросы не чаще RETRY_DELAY
+    void refresh(const QSslCertificate &certificate, const QSslCertificate &issuer);
+    
+    // Ответчик вместо указанного в сертификате (корпоративный прокси, тесты)
+    void setResponderUrl(const QUrl &url) { m_responderUrl = url; }
+    
+    // Имя издателя (хэш в поле issuer) и AKI из CRL - для поиска издателя
+    static CertificateKeys crlIssuer(const QByteArray &data);
+    
+    void clear();
+
+signals:
+    void updated();
+
+private:
+    struct CrlEntry {
+        QList<QByteArray> serials;   // отсортированы
+        QDateTime nextUpdate;
+    };
+    struct OcspEntry {
+        Status status;
+        QDateTime nextUpdate;
+    };
+    static QByteArray issuerKey(const QByteArray &nameHash, const QByteArray &keyId);
+    static QByteArray certificateKey(const CertificateKeys &keys);
+    
+    QHash<QByteArray, CrlEntry> m_crls;    // издатель -> отозванные номера
+    QHash<QByteArray, OcspEntry> m_ocsp;   // издатель + номер -> статус
+    QHash<QByteArray, QDateTime> m_attempts; // последние запросы по сертификату
+    QNetworkAccessManager *m_network;
+    QUrl m_responderUrl;
+    
+    static const int RETRY_DELAY = 10 * 60;          // с
+    static const int DEFAULT_LIFETIME = 60 * 60;     // с, если nextUpdate не указан
+    static const int CLOCK_SKEW = 5 * 60;             // с
+};
+
+#endif // REVOCATIONCACHE_H
@@ -1,4 +1,5 @@
 #include "settings.h"
+#include "faviconstore.h"
 #include <QMessageBox>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -319,6 +320,8 @@ void SettingsDialog::clearBrowsingData()
         settings->remove("cookies");
         // Очистка паролей
         settings->remove("passwords");
+        // Очистка иконок сайтов
+        FaviconStore::instance()->clear();
         
         QMessageBox::information(this, "Очистка данных", "Данные браузера успешно очищены.");
     }
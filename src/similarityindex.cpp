@@ -0,0 +1,157 @@
+#include "similarityindex.h"
+#include "bookmarkindex.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// splitmix64: из одного хэша признака получаем независимые хэши для
+// каждой позиции сигнатуры
+quint64 mix(quint64 value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+}
+
+QSet<QString> SimilarityIndex::features(const QString &title, const QString &url)
+{
+    QSet<QString> result;
+    
+    for (const QString &token : BookmarkIndex::urlTokens(url)) {
+        result.insert(QLatin1String("u:") + token);
+    }
+    
+    // Отдельные слова и пары соседних слов заголовка
+    const QStringList words = BookmarkIndex::tokenize(title);
+    for (int i = 0; i < words.size(); ++i) {
+        result.insert(QLatin1String("w:") + words.at(i));
+        if (i + 1 < words.size()) {
+            result.insert(QLatin1String("s:") + words.at(i) + QLatin1Char(' ') + words.at(i + 1));
+        }
+    }
+    return result;
+}
+
+SimilarityIndex::Signature SimilarityIndex::signature(const QString &title, const QString &url)
+{
+    Signature result(SIGNATURE_SIZE, std::numeric_limits<quint32>::max());
+    
+    const QSet<QString> featureSet = features(title, url);
+    for (const QString &feature : featureSet) {
+        const quint64 base = qHash(feature);
+        for (int i = 0; i < SIGNATURE_SIZE; ++i) {
+            const quint32 value = quint32(mix(base + quint64(i) * 0x9E3779B97F4A7C15ULL));
+            if (value < result[i]) {
+                result[i] = value;
+            }
+        }
+    }
+    return result;
+}
+
+double SimilarityIndex::estimateSimilarity(const Signature &a, const Signature &b)
+{
+    if (a.size() != b.size() || a.isEmpty()) {
+        return 0.0;
+    }
+    
+    int equal = 0;
+    for (int i = 0; i < a.size(); ++i) {
+        if (a[i] == b[i]) {
+            ++equal;
+        }
+    }
+    return double(equal) / a.size();
+}
+
+quint64 SimilarityIndex::bandKey(const Signature &signature, int band)
+{
+    quint64 key = mix(quint64(band));
+    for (int row = 0; row < ROWS; ++row) {
+        key = mix(key ^ signature[band * ROWS + row]);
+    }
+    return key;
+}
+
+void SimilarityIndex::insert(const QString &id, const QString &title, const QString &url)
+{
+    remove(id);
+    
+    const Signature sig = signature(title, url);
+    // Пустая сигнатура (нет признаков) совпала бы со всеми такими же
+    if (sig.first() == std::numeric_limits<quint32>::max()) {
+        return;
+    }
+    
+    for (int band = 0; band < BANDS; ++band) {
+        m_buckets[bandKey(sig, band)].insert(id);
+    }
+    m_signatures.insert(id, sig);
+}
+
+void SimilarityIndex::remove(const QString &id)
+{
+    auto it = m_signatures.find(id);
+    if (it == m_signatures.end()) {
+        return;
+    }
+    
+    for (int band = 0; band < BANDS; ++band) {
+        auto bucket = m_buckets.find(bandKey(it.value(), band));
+        if (bucket != m_buckets.end()) {
+            bucket->remove(id);
+            if (bucket->isEmpty()) {
+                m_buckets.erase(bucket);
+            }
+        }
+    }
+    m_signatures.erase(it);
+}
+
+void SimilarityIndex::clear()
+{
+    m_signatures.clear();
+    m_buckets.clear();
+}
+
+QList<QPair<QString, double>> SimilarityIndex::similar(const QString &id, int limit,
+                                                       double minSimilarity) const
+{
+    QList<QPair<QString, double>> result;
+    
+    auto it = m_signatures.constFind(id);
+    if (it == m_signatures.constEnd()) {
+        return result;
+    }
+    const Signature &sig = it.value();
+    
+    // Кандидаты - закладки, совпавшие хотя бы в одной полосе
+    QSet<QString> candidates;
+    for (int band = 0; band < BANDS; ++band) {
+        auto bucket = m_buckets.constFind(bandKey(sig, band));
+        if (bucket != m_buckets.constEnd()) {
+            candidates.unite(bucket.value());
+        }
+    }
+    candidates.remove(id);
+    
+    for (const QString &candidate : std::as_const(candidates)) {
+        const double similarity = estimateSimilarity(sig, m_signatures.value(candidate));
+        if (similarity >= minSimilarity) {
+            result.append(qMakePair(candidate, similarity));
+        }
+    }
+    
+    std::sort(result.begin(), result.end(),
+              [](const QPair<QString, double> &a, const QPair<QString, double> &b) {
+        return a.second > b.second;
+    });
+    if (limit >= 0 && result.size() > limit) {
+        result.erase(result.begin() + limit, result.end());
+    }
+    return result;
+}
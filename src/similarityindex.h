@@ -0,0 +1,44 @@
+#ifndef SIMILARITYINDEX_H
+#define SIMILARITYINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QPair>
+
+// Индекс похожих закладок: MinHash-сигнатура по токенам адреса и
+// шинглам заголовка, разложенная по LSH-корзинам. Кандидаты берутся
+// только из общих корзин, поэтому запрос не сравнивает все пары.
+class SimilarityIndex
+{
+public:
+    typedef QVector<quint32> Signature;
+    
+    void insert(const QString &id, const QString &title, const QString &url);
+    void remove(const QString &id);
+    void clear();
+    bool contains(const QString &id) const { return m_signatures.contains(id); }
+    
+    // Похожие закладки с оценкой сходства Жаккара, по убыванию
+    QList<QPair<QString, double>> similar(const QString &id, int limit,
+                                          double minSimilarity = MIN_SIMILARITY) const;
+    
+    static Signature signature(const QString &title, const QString &url);
+    static double estimateSimilarity(const Signature &a, const Signature &b);
+
+private:
+    static QSet<QString> features(const QString &title, const QString &url);
+    static quint64 bandKey(const Signature &signature, int band);
+    
+    QHash<QString, Signature> m_signatures;          // id -> сигнатура
+    QHash<quint64, QSet<QString>> m_buckets;         // корзина -> id
+    
+    static const int BANDS = 16;
+    static const int ROWS = 4;
+    static const int SIGNATURE_SIZE = BANDS * ROWS;
+    static constexpr double MIN_SIMILARITY = 0.3;
+};
+
+#endif // SIMILARITYINDEX_H
@@ -0,0 +1,251 @@
+#include "syncjournal.h"
+#include <QJsonDocument>
+#include <QSaveFile>
+
+namespace {
+
+QJsonObject changeToJson(const SyncChange &change)
+{
+    QJsonObject record;
+    record["seq"] = QString::number(change.sequence);
+    record["type"] = change.type;
+    record["id"] = change.id;
+    if (change.deleted) {
+        record["deleted"] = true;
+    } else {
+        record["data"] = change.data;
+    }
+    return record;
+}
+
+}
+
+SyncJournal::SyncJournal()
+    : m_sequence(0)
+    , m_acknowledged(0)
+    , m_obsoleteRecords(0)
+{
+}
+
+SyncJournal::~SyncJournal()
+{
+    close();
+}
+
+QString SyncJournal::changeKey(const QString &type, const QString &id)
+{
+    return type + '\n' + id;
+}
+
+bool SyncJournal::open(const QString &filePath)
+{
+    close();
+    m_changes.clear();
+    m_latest.clear();
+    m_sequence = 0;
+    m_acknowledged = 0;
+    m_serverCursor.clear();
+    m_obsoleteRecords = 0;
+    
+    m_file.setFileName(filePath);
+    bool torn = false;
+    if (m_file.open(QIODevice::ReadOnly)) {
+        qint64 records = 0;
+        qint64 validEnd = 0;
+        // Номера храним строкой: double в JSON теряет точность после 2^53
+        while (!m_file.atEnd()) {
+            const QByteArray line = m_file.readLine();
+            const QJsonDocument doc = QJsonDocument::fromJson(line);
+            if (!line.endsWith('\n') || !doc.isObject()) {
+                // Недописанная при сбое последняя строка
+                break;
+            }
+            validEnd = m_file.pos();
+            const QJsonObject record = doc.object();
+            ++records;
+            
+            if (record.contains("ack")) {
+                const quint64 cursor = record["ack"].toString().toULongLong();
+                m_sequence = qMax(m_sequence, cursor);
+                dropAcknowledged(cursor);
+            } else if (record.contains("cursor")) {
+                m_serverCursor = record["cursor"].toString();
+            } else {
+                SyncChange change;
+                change.sequence = record["seq"].toString().toULongLong();
+                change.type = record["type"].toString();
+                change.id = record["id"].toString();
+                change.deleted = record["deleted"].toBool();
+                change.data = record["data"].toObject();
+                m_sequence = qMax(m_sequence, change.sequence);
+                if (change.sequence > m_acknowledged) {
+                    append(change);
+                }
+            }
+        }
+        const qint64 fileSize = m_file.size();
+        m_file.close();
+        m_obsoleteRecords = records - m_changes.size();
+        
+        // Обрезаем обрывок, иначе следующая запись допишется к нему и
+        // при следующем открытии потеряется вместе со всем, что после
+        torn = validEnd < fileSize && !QFile::resize(filePath, validEnd);
+    }
+    
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (torn || m_obsoleteRecords > COMPACT_THRESHOLD) {
+        return compact();
+    }
+    return true;
+}
+
+void SyncJournal::close()
+{
+    if (m_file.isOpen()) {
+        m_file.close();
+    }
+}
+
+quint64 SyncJournal::append(SyncChange change)
+{
+    const QString key = changeKey(change.type, change.id);
+    auto previous = m_latest.constFind(key);
+    if (previous != m_latest.constEnd()) {
+        // Отправлять имеет смысл только последнее состояние объекта
+        m_changes.remove(*previous);
+        ++m_obsoleteRecords;
+    }
+    m_latest.insert(key, change.sequence);
+    const quint64 sequence = change.sequence;
+    m_changes.insert(sequence, std::move(change));
+    return sequence;
+}
+
+quint64 SyncJournal::recordChange(const QString &type, const QString &id, const QJsonObject &data)
+{
+    SyncChange change;
+    change.sequence = m_sequence + 1;
+    change.type = type;
+    change.id = id;
+    change.data = data;
+    if (!writeRecord(changeToJson(change))) {
+        return 0;
+    }
+    m_sequence = change.sequence;
+    return append(change);
+}
+
+quint64 SyncJournal::recordRemoval(const QString &type, const QString &id)
+{
+    SyncChange change;
+    change.sequence = m_sequence + 1;
+    change.type = type;
+    change.id = id;
+    change.deleted = true;
+    if (!writeRecord(changeToJson(change))) {
+        return 0;
+    }
+    m_sequence = change.sequence;
+    return append(change);
+}
+
+QList<SyncChange> SyncJournal::changesSince(quint64 cursor, int limit) const
+{
+    QList<SyncChange> changes;
+    for (auto it = m_changes.upperBound(cursor); it != m_changes.constEnd() && changes.size() < limit; ++it) {
+        changes.append(*it);
+    }
+    return changes;
+}
+
+void SyncJournal::dropAcknowledged(quint64 cursor)
+{
+    m_acknowledged = qMax(m_acknowledged, qMin(cursor, m_sequence));
+    while (!m_changes.isEmpty() && m_changes.firstKey() <= m_acknowledged) {
+        const SyncChange &change = m_changes.first();
+        m_latest.remove(changeKey(change.type, change.id));
+        m_changes.erase(m_changes.begin());
+        ++m_obsoleteRecords;
+    }
+}
+
+bool SyncJournal::acknowledge(quint64 cursor)
+{
+    if (cursor <= m_acknowledged) {
+        return true;
+    }
+    dropAcknowledged(cursor);
+    
+    QJsonObject record;
+    record["ack"] = QString::number(m_acknowledged);
+    if (!writeRecord(record)) {
+        return false;
+    }
+    if (m_obsoleteRecords > COMPACT_THRESHOLD) {
+        return compact();
+    }
+    return true;
+}
+
+bool SyncJournal::setServerCursor(const QString &cursor)
+{
+    if (cursor == m_serverCursor) {
+        return true;
+    }
+    m_serverCursor = cursor;
+    QJsonObject record;
+    record["cursor"] = cursor;
+    ++m_obsoleteRecords;
+    return writeRecord(record);
+}
+
+bool SyncJournal::reset()
+{
+    m_changes.clear();
+    m_latest.clear();
+    m_acknowledged = m_sequence;
+    m_serverCursor.clear();
+    return compact();
+}
+
+bool SyncJournal::writeRecord(const QJsonObject &record)
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    return m_file.write(line) == line.size() && m_file.flush();
+}
+
+bool SyncJournal::compact()
+{
+    // Переписываем только курсоры и неподтверждённые изменения
+    QSaveFile file(m_file.fileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QJsonObject ack;
+    ack["ack"] = QString::number(m_acknowledged);
+    file.write(QJsonDocument(ack).toJson(QJsonDocument::Compact) + '\n');
+    if (!m_serverCursor.isEmpty()) {
+        QJsonObject cursor;
+        cursor["cursor"] = m_serverCursor;
+        file.write(QJsonDocument(cursor).toJson(QJsonDocument::Compact) + '\n');
+    }
+    for (const SyncChange &change : std::as_const(m_changes)) {
+        file.write(QJsonDocument(changeToJson(change)).toJson(QJsonDocument::Compact) + '\n');
+    }
+    
+    m_file.close();
+    const bool committed = file.commit();
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    if (committed) {
+        m_obsoleteRecords = 0;
+    }
+    return committed;
+}
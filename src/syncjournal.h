@@ -0,0 +1,74 @@
+#ifndef SYNCJOURNAL_H
+#define SYNCJOURNAL_H
+
+#include <QString>
+#include <QJsonObject>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+
+// Изменение одного объекта; deleted без data - удаление
+struct SyncChange {
+    quint64 sequence = 0;
+    QString type;       // "bookmarks", "history", "passwords", ...
+    QString id;
+    bool deleted = false;
+    QJsonObject data;
+};
+
+// Локальный журнал изменений для разностной синхронизации. Каждое
+// изменение получает возрастающий номер; на сервер уходят только записи
+// после подтверждённого курсора, а для загрузки хранится курсор сервера.
+// Файл - строки JSON, как журнал закладок; повторное изменение объекта
+// вытесняет ещё не отправленную запись о нём.
+class SyncJournal
+{
+public:
+    SyncJournal();
+    ~SyncJournal();
+    
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    
+    quint64 recordChange(const QString &type, const QString &id, const QJsonObject &data);
+    quint64 recordRemoval(const QString &type, const QString &id);
+    
+    // Неподтверждённые изменения по порядку номеров, не больше limit
+    QList<SyncChange> changesSince(quint64 cursor, int limit) const;
+    QList<SyncChange> pendingChanges(int limit) const { return changesSince(m_acknowledged, limit); }
+    int pendingCount() const { return m_changes.size(); }
+    bool hasPendingChange(const QString &type, const QString &id) const
+    { return m_latest.contains(changeKey(type, id)); }
+    
+    // Сервер принял всё до cursor включительно
+    bool acknowledge(quint64 cursor);
+    quint64 acknowledgedCursor() const { return m_acknowledged; }
+    quint64 lastSequence() const { return m_sequence; }
+    
+    // Непрозрачный курсор сервера для загрузки изменений
+    bool setServerCursor(const QString &cursor);
+    QString serverCursor() const { return m_serverCursor; }
+    
+    // Полный сброс: следующая синхронизация начнётся со снимка
+    bool reset();
+
+private:
+    quint64 append(SyncChange change);
+    void dropAcknowledged(quint64 cursor);
+    bool writeRecord(const QJsonObject &record);
+    bool compact();
+    static QString changeKey(const QString &type, const QString &id);
+    
+    QFile m_file;
+    QMap<quint64, SyncChange> m_changes;   // неподтверждённые, по номеру
+    QHash<QString, quint64> m_latest;      // тип + id -> номер записи
+    quint64 m_sequence;
+    quint64 m_acknowledged;
+    QString m_serverCursor;
+    qint64 m_obsoleteRecords;              // записей в файле сверх m_changes
+    
+    static const int COMPACT_THRESHOLD = 1000;
+};
+
+#endif // SYNCJOURNAL_H
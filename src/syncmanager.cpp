@@ -8,10 +8,17 @@
 #include <QDateTime>
 #include <QCryptographicHash>
 #include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QSysInfo>
 #include <QTimer>
+#include <QDebug>
+#include <QDataStream>
+#include <QSaveFile>
 
 const QString SyncManager::SYNC_FILE = "sync_data.json";
 const QString SyncManager::DEVICE_FILE = "device_info.json";
+const QString SyncManager::JOURNAL_FILE = "sync.journal";
+const QString SyncManager::TREE_FILE = "sync.tree";
 const int SyncManager::SYNC_INTERVAL = 300000; // 5 минут
 
 SyncManager::SyncManager(QObject *parent)
@@ -19,10 +26,33 @@ SyncManager::SyncManager(QObject *parent)
     , m_networkManager(new QNetworkAccessManager(this))
     , m_syncTimer(new QTimer(this))
     , m_isSyncing(false)
+    , m_applyingRemote(false)
+    , m_reconcileRequested(false)
+    , m_reconcileFetched(0)
+    , m_reconcileRequeued(0)
+    , m_uploader(new SyncUploader(m_networkManager, this))
+    , m_uploadCursor(0)
+    , m_uploadAttempts(0)
+    , m_maxSyncSize(DEFAULT_MAX_SYNC_SIZE)
+    , m_quotaUsed(0)
+    , m_quotaLimit(0)
 {
     loadDeviceInfo();
     loadSyncData();
     
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(path);
+    if (!m_journal.open(path + "/" + JOURNAL_FILE)) {
+        qWarning() << "Failed to open sync journal";
+    }
+    loadTrees();
+    
+    connect(m_uploader, &SyncUploader::finished, this, &SyncManager::handleUploadFinished);
+    connect(m_uploader, &SyncUploader::failed, this, &SyncManager::handleUploadFailed);
+    connect(m_uploader, &SyncUploader::progress, this, [this](int acknowledged, int total) {
+        emit syncProgress(total > 0 ? acknowledged * 100 / total : 100);
+    });
+    
     connect(m_syncTimer, &QTimer::timeout, this, &SyncManager::sync);
     
     if (m_settings.autoSync) {
@@ -32,6 +62,8 @@ SyncManager::SyncManager(QObject *parent)
 
 SyncManager::~SyncManager()
 {
+    m_uploader->abort();
+    saveTrees();
     saveSyncData();
     saveDeviceInfo();
 }
@@ -196,108 +228,634 @@ void SyncManager::sync()
     m_isSyncing = true;
     emit syncStarted();
     
-    // Подготавливаем данные для синхронизации
-    QJsonObject syncData;
+    // Первая синхронизация отправляет снимок, дальше - только журнал
+    if (m_journal.serverCursor().isEmpty() && m_journal.lastSequence() == 0) {
+        seedJournal();
+    }
+    
+    // Отправляем изменения после подтверждённого курсора; пакет
+    // уменьшается, пока сжатый размер не уложится в лимит
+    const QList<SyncChange> changes = m_journal.pendingChanges(MAX_CHANGES_PER_SYNC);
+    qsizetype count = changes.size();
+    QJsonObject data;
+    while (true) {
+        QJsonArray changeArray;
+        for (qsizetype i = 0; i < count; ++i) {
+            const SyncChange &change = changes[i];
+            QJsonObject changeObj;
+            changeObj["seq"] = QString::number(change.sequence);
+            changeObj["type"] = change.type;
+            changeObj["id"] = change.id;
+            if (change.deleted) {
+                changeObj["deleted"] = true;
+            } else {
+                changeObj["data"] = change.data;
+            }
+            changeArray.append(changeObj);
+        }
+        
+        // Без отметки времени: те же изменения дают тот же идентификатор
+        // выгрузки, и следующая попытка продолжает прерванную
+        data = QJsonObject();
+        data["deviceId"] = m_deviceInfo.id;
+        data["cursor"] = m_journal.serverCursor();
+        data["changes"] = changeArray;
+        
+        // Пробные пакеты только измеряются: prepare() с другими данными
+        // сбросил бы подтверждённые куски прерванной выгрузки
+        if (count <= 1 || SyncUploader::measure(data) <= m_maxSyncSize) {
+            break;
+        }
+        count /= 2;
+    }
+    m_uploader->prepare(data);
     
-    if (m_settings.syncBookmarks) {
-        syncData["bookmarks"] = prepareBookmarksData();
+    // Квоты проверяются по фактическому сжатому размеру
+    const qint64 uploadSize = m_uploader->compressedSize();
+    if (uploadSize > m_maxSyncSize) {
+        emit quotaExceeded(uploadSize, m_maxSyncSize);
+        m_syncState.lastError = "Sync item exceeds the maximum upload size";
+        emit syncError(m_syncState.lastError);
+        finishSync(false);
+        return;
+    }
+    if (m_quotaLimit > 0 && m_quotaUsed + uploadSize > m_quotaLimit) {
+        emit quotaExceeded(m_quotaUsed + uploadSize, m_quotaLimit);
+        m_syncState.lastError = "Server storage quota exceeded";
+        emit syncError(m_syncState.lastError);
+        finishSync(false);
+        return;
     }
     
-    if (m_settings.syncHistory) {
-        syncData["history"] = prepareHistoryData();
+    m_uploadCursor = count > 0 ? changes[count - 1].sequence : m_journal.acknowledgedCursor();
+    m_uploadAttempts = 0;
+    m_uploader->upload(m_serverUrl);
+}
+
+void SyncManager::handleUploadFinished(const QJsonObject &response)
+{
+    finishSync(processServerResponse(response, m_uploadCursor));
+}
+
+void SyncManager::handleUploadFailed(const QString &error)
+{
+    // Повтор отправляет только куски, которые сервер ещё не подтвердил
+    if (++m_uploadAttempts < MAX_RETRY_ATTEMPTS) {
+        QTimer::singleShot(UPLOAD_RETRY_DELAY * m_uploadAttempts, this, [this]() {
+            if (m_isSyncing) {
+                m_uploader->upload(m_serverUrl);
+            }
+        });
+        return;
+    }
+    
+    m_syncState.lastError = error;
+    emit syncError(m_syncState.lastError);
+    finishSync(false);
+}
+
+void SyncManager::finishSync(bool more)
+{
+    m_isSyncing = false;
+    m_syncState.lastSyncTime = QDateTime::currentDateTime();
+    saveSyncData();
+    saveTrees();
+    
+    emit syncFinished();
+    
+    // Сервер потерял наш курсор - сверяем деревья; иначе, если
+    // изменения не поместились в один обмен, продолжаем сразу
+    if (m_journal.serverCursor().isEmpty() && m_reconcileRequested) {
+        m_reconcileRequested = false;
+        QTimer::singleShot(0, this, &SyncManager::reconcile);
+    } else if (more) {
+        QTimer::singleShot(0, this, &SyncManager::sync);
+    }
+}
+
+void SyncManager::setMaxSyncSize(qint64 size)
+{
+    m_maxSyncSize = size > 0 ? size : qint64(DEFAULT_MAX_SYNC_SIZE);
+}
+
+bool SyncManager::isTypeEnabled(const QString &type) const
+{
+    if (type == "bookmarks") {
+        return m_settings.syncBookmarks;
+    } else if (type == "history") {
+        return m_settings.syncHistory;
+    } else if (type == "passwords") {
+        return m_settings.syncPasswords;
+    } else if (type == "settings") {
+        return m_settings.syncSettings;
+    } else if (type == "extensions") {
+        return m_settings.syncExtensions;
+    }
+    return false;
+}
+
+SyncItemType SyncManager::itemType(const QString &type)
+{
+    if (type == "bookmarks") {
+        return SyncItemType::Bookmark;
+    } else if (type == "history") {
+        return SyncItemType::History;
+    } else if (type == "passwords") {
+        return SyncItemType::Password;
+    } else if (type == "settings") {
+        return SyncItemType::Setting;
+    } else if (type == "extensions") {
+        return SyncItemType::Extension;
+    }
+    return SyncItemType::Custom;
+}
+
+QString SyncManager::typeName(SyncItemType type)
+{
+    switch (type) {
+    case SyncItemType::Bookmark:
+        return "bookmarks";
+    case SyncItemType::History:
+        return "history";
+    case SyncItemType::Password:
+        return "passwords";
+    case SyncItemType::Setting:
+        return "settings";
+    case SyncItemType::Extension:
+        return "extensions";
+    case SyncItemType::Custom:
+        break;
+    }
+    return "custom";
+}
+
+QString SyncManager::calculateChecksum(const SyncItem &item) const
+{
+    // Только id и содержимое: одинаковый объект на разных устройствах
+    // должен давать одну и ту же сумму
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(item.id.toUtf8());
+    hash.addData(QByteArray(1, '\0'));
+    hash.addData(item.data.toJson(QJsonDocument::Compact));
+    return hash.result().toHex();
+}
+
+void SyncManager::trackItem(const QString &type, const QString &id, const QJsonObject &data)
+{
+    SyncItem item;
+    item.id = id;
+    item.type = itemType(type);
+    item.data = QJsonDocument(data);
+    item.deleted = false;
+    m_trees[item.type].insert(id, QByteArray::fromHex(calculateChecksum(item).toLatin1()));
+}
+
+void SyncManager::untrackItem(const QString &type, const QString &id)
+{
+    auto it = m_trees.find(itemType(type));
+    if (it != m_trees.end()) {
+        it->remove(id);
+    }
+}
+
+bool SyncManager::recordChange(const QString &type, const QString &id, const QJsonObject &data)
+{
+    // Изменения, пришедшие с сервера, обратно не отправляются
+    if (m_applyingRemote || !isTypeEnabled(type)) {
+        return false;
+    }
+    trackItem(type, id, data);
+    return m_journal.recordChange(type, id, data) != 0;
+}
+
+bool SyncManager::recordRemoval(const QString &type, const QString &id)
+{
+    if (m_applyingRemote || !isTypeEnabled(type)) {
+        return false;
+    }
+    untrackItem(type, id);
+    return m_journal.recordRemoval(type, id) != 0;
+}
+
+int SyncManager::getPendingChangesCount() const
+{
+    return m_journal.pendingCount();
+}
+
+void SyncManager::resetSyncJournal()
+{
+    m_journal.reset();
+}
+
+QJsonObject SyncManager::snapshotOf(const QString &type) const
+{
+    if (!isTypeEnabled(type)) {
+        return QJsonObject();
+    }
+    if (type == "bookmarks") {
+        return prepareBookmarksData();
+    } else if (type == "history") {
+        return prepareHistoryData();
+    } else if (type == "passwords") {
+        return preparePasswordsData();
+    } else if (type == "settings") {
+        return prepareSettingsData();
+    } else if (type == "extensions") {
+        return prepareExtensionsData();
+    }
+    return QJsonObject();
+}
+
+void SyncManager::seedJournal()
+{
+    for (const QString &type : {"bookmarks", "history", "passwords", "settings", "extensions"}) {
+        const QJsonObject snapshot = snapshotOf(type);
+        for (auto it = snapshot.constBegin(); it != snapshot.constEnd(); ++it) {
+            trackItem(type, it.key(), it.value().toObject());
+            m_journal.recordChange(type, it.key(), it.value().toObject());
+        }
+    }
+}
+
+void SyncManager::applyRemoteChanges(const QJsonArray &changes)
+{
+    // Изменения раскладываются по типам в формате снимков: id -> данные,
+    // null для удалённых объектов
+    QHash<QString, QJsonObject> byType;
+    for (const QJsonValue &val : changes) {
+        const QJsonObject change = val.toObject();
+        const QString type = change["type"].toString();
+        if (!isTypeEnabled(type)) {
+            continue;
+        }
+        const QString id = change["id"].toString();
+        if (change["deleted"].toBool()) {
+            byType[type][id] = QJsonValue(QJsonValue::Null);
+            untrackItem(type, id);
+            m_serverItems[itemType(type)].remove(id);
+        } else {
+            byType[type][id] = change["data"];
+            trackItem(type, id, change["data"].toObject());
+            m_serverItems[itemType(type)].insert(id);
+        }
+    }
+    
+    m_applyingRemote = true;
+    if (byType.contains("bookmarks")) {
+        updateBookmarks(byType["bookmarks"]);
+    }
+    if (byType.contains("history")) {
+        updateHistory(byType["history"]);
+    }
+    if (byType.contains("passwords")) {
+        updatePasswords(byType["passwords"]);
+    }
+    if (byType.contains("settings")) {
+        updateSettings(byType["settings"]);
+    }
+    if (byType.contains("extensions")) {
+        updateExtensions(byType["extensions"]);
+    }
+    m_applyingRemote = false;
+}
+
+void SyncManager::loadTrees()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile file(path + "/" + TREE_FILE);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
     }
     
-    if (m_settings.syncPasswords) {
-        syncData["passwords"] = preparePasswordsData();
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != TREE_MAGIC || version < 1 || version > TREE_VERSION) {
+        return;
+    }
+    for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString type;
+        in >> type;
+        in >> m_trees[itemType(type)];
+        if (version >= 2) {
+            in >> m_serverItems[itemType(type)];
+        }
+    }
+    if (in.status() != QDataStream::Ok) {
+        // Повреждённый файл: пустые деревья приведут к полной сверке
+        m_trees.clear();
+        m_serverItems.clear();
+    }
+}
+
+void SyncManager::saveTrees()
+{
+    QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(path);
+    QSaveFile file(path + "/" + TREE_FILE);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
     }
     
-    if (m_settings.syncSettings) {
-        syncData["settings"] = prepareSettingsData();
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << quint32(TREE_MAGIC) << quint32(TREE_VERSION) << qint32(m_trees.size());
+    for (auto it = m_trees.constBegin(); it != m_trees.constEnd(); ++it) {
+        out << typeName(it.key()) << it.value() << m_serverItems.value(it.key());
+    }
+    file.commit();
+}
+
+bool SyncManager::reconcile()
+{
+    if (m_isSyncing) {
+        return false;
     }
     
-    if (m_settings.syncExtensions) {
-        syncData["extensions"] = prepareExtensionsData();
+    m_isSyncing = true;
+    m_reconcileFetched = 0;
+    m_reconcileRequeued = 0;
+    m_reconcileCursor.clear();
+    emit syncStarted();
+    
+    // Сверка начинается с корней всех включённых типов
+    QJsonObject nodes;
+    for (SyncItemType type : {SyncItemType::Bookmark, SyncItemType::History, SyncItemType::Password,
+                              SyncItemType::Setting, SyncItemType::Extension}) {
+        if (isTypeEnabled(typeName(type))) {
+            nodes[typeName(type)] = QJsonArray{0};
+        }
     }
     
-    // Отправляем данные на сервер
+    QJsonObject query;
+    query["level"] = 0;
+    query["nodes"] = nodes;
+    sendReconcileQuery(query);
+    return true;
+}
+
+void SyncManager::sendReconcileQuery(const QJsonObject &query)
+{
     QNetworkRequest request(m_serverUrl);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
     
     QJsonObject data;
     data["deviceId"] = m_deviceInfo.id;
-    data["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
-    data["data"] = syncData;
-    
-    QNetworkReply *reply = m_networkManager->post(request, 
-                                                QJsonDocument(data).toJson());
+    data["reconcile"] = query;
     
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-        if (reply->error() == QNetworkReply::NoError) {
-            QJsonDocument response = QJsonDocument::fromJson(reply->readAll());
-            if (response.isObject()) {
-                processServerResponse(response.object());
-            }
-        } else {
+    QNetworkReply *reply = m_networkManager->post(request, QJsonDocument(data).toJson(QJsonDocument::Compact));
+    connect(reply, &QNetworkReply::finished, this, [this, reply, query]() {
+        reply->deleteLater();
+        if (reply->error() != QNetworkReply::NoError) {
             m_syncState.lastError = reply->errorString();
             emit syncError(m_syncState.lastError);
+            finishReconcile(false);
+            return;
         }
-        
-        m_isSyncing = false;
-        m_syncState.lastSyncTime = QDateTime::currentDateTime();
-        saveSyncData();
-        
-        emit syncFinished();
-        reply->deleteLater();
+        const QJsonObject response = QJsonDocument::fromJson(reply->readAll()).object();
+        if (response["status"].toString() != "success") {
+            m_syncState.lastError = response["error"].toString();
+            emit syncError(m_syncState.lastError);
+            finishReconcile(false);
+            return;
+        }
+        handleReconcileResponse(query, response);
     });
 }
 
-void SyncManager::processServerResponse(const QJsonObject &response)
+void SyncManager::handleReconcileResponse(const QJsonObject &query, const QJsonObject &response)
 {
-    // Обработка ответа от сервера
-    if (response["status"].toString() == "success") {
-        // Обновляем локальные данные
-        QJsonObject syncedData = response["data"].toObject();
-        
-        if (m_settings.syncBookmarks && syncedData.contains("bookmarks")) {
-            updateBookmarks(syncedData["bookmarks"].toObject());
+    // Курсор соответствует состоянию сервера, с которым идёт сравнение:
+    // всё, что изменится на сервере позже, придёт обычной синхронизацией
+    if (m_reconcileCursor.isEmpty()) {
+        m_reconcileCursor = response["cursor"].toString();
+    }
+    
+    if (query.contains("nodes")) {
+        // Сравниваем присланные хэши узлов и спускаемся только в различающиеся
+        const int level = query["level"].toInt();
+        const QJsonObject nodes = query["nodes"].toObject();
+        const QJsonObject hashes = response["hashes"].toObject();
+        QJsonObject next;
+        for (auto it = nodes.constBegin(); it != nodes.constEnd(); ++it) {
+            QList<int> requested;
+            for (const QJsonValue &val : it.value().toArray()) {
+                requested.append(val.toInt());
+            }
+            QHash<int, QByteArray> remote;
+            const QJsonObject typeHashes = hashes[it.key()].toObject();
+            for (auto hash = typeHashes.constBegin(); hash != typeHashes.constEnd(); ++hash) {
+                remote.insert(hash.key().toInt(), QByteArray::fromBase64(hash.value().toString().toLatin1()));
+            }
+            
+            const QList<int> differing = m_trees[itemType(it.key())].differingNodes(level, requested, remote);
+            QJsonArray array;
+            for (int index : differing) {
+                if (level < MerkleTree::DEPTH) {
+                    for (int child : MerkleTree::children(index)) {
+                        array.append(child);
+                    }
+                } else {
+                    array.append(index);
+                }
+            }
+            if (!array.isEmpty()) {
+                next[it.key()] = array;
+            }
         }
         
-        if (m_settings.syncHistory && syncedData.contains("history")) {
-            updateHistory(syncedData["history"].toObject());
+        if (next.isEmpty()) {
+            finishReconcile(true);
+            return;
         }
-        
-        if (m_settings.syncPasswords && syncedData.contains("passwords")) {
-            updatePasswords(syncedData["passwords"].toObject());
+        QJsonObject nextQuery;
+        if (level < MerkleTree::DEPTH) {
+            nextQuery["level"] = level + 1;
+            nextQuery["nodes"] = next;
+        } else {
+            nextQuery["buckets"] = next;
+        }
+        sendReconcileQuery(nextQuery);
+    } else if (query.contains("buckets")) {
+        // В различающихся корзинах сравниваем суммы объектов
+        const QJsonObject buckets = query["buckets"].toObject();
+        const QJsonObject entries = response["entries"].toObject();
+        QJsonObject fetch;
+        for (auto it = buckets.constBegin(); it != buckets.constEnd(); ++it) {
+            const QString type = it.key();
+            const MerkleTree &tree = m_trees[itemType(type)];
+            QSet<QString> &known = m_serverItems[itemType(type)];
+            const QJsonObject remote = entries[type].toObject();
+            
+            QJsonArray fetchIds;
+            for (auto entry = remote.constBegin(); entry != remote.constEnd(); ++entry) {
+                known.insert(entry.key());
+                // Неотправленная локальная правка новее серверной версии
+                if (tree.checksum(entry.key()) != QByteArray::fromBase64(entry.value().toString().toLatin1()) &&
+                    !m_journal.hasPendingChange(type, entry.key())) {
+                    fetchIds.append(entry.key());
+                }
+            }
+            
+            QStringList localOnly;
+            for (const QJsonValue &bucket : it.value().toArray()) {
+                const QMap<QString, QByteArray> local = tree.bucketEntries(bucket.toInt());
+                for (auto entry = local.constBegin(); entry != local.constEnd(); ++entry) {
+                    if (!remote.contains(entry.key())) {
+                        localOnly.append(entry.key());
+                    }
+                }
+            }
+            requeueLocalItems(type, localOnly);
+            
+            if (!fetchIds.isEmpty()) {
+                fetch[type] = fetchIds;
+            }
         }
         
-        if (m_settings.syncSettings && syncedData.contains("settings")) {
-            updateSettings(syncedData["settings"].toObject());
+        if (fetch.isEmpty()) {
+            finishReconcile(true);
+            return;
         }
+        QJsonObject nextQuery;
+        nextQuery["fetch"] = fetch;
+        sendReconcileQuery(nextQuery);
+    } else {
+        const QJsonArray changes = response["changes"].toArray();
+        m_reconcileFetched += changes.size();
+        applyRemoteChanges(changes);
+        finishReconcile(true);
+    }
+}
+
+void SyncManager::requeueLocalItems(const QString &type, const QStringList &ids)
+{
+    if (ids.isEmpty()) {
+        return;
+    }
+    
+    // Объекта нет на сервере. Если сервер его уже принимал или присылал,
+    // объект удалён на другом устройстве и удаляется здесь; иначе локальная
+    // правка до сервера не дошла и снова попадает в журнал. Пропавшие из
+    // локальных данных убираются из дерева
+    const QJsonObject snapshot = snapshotOf(type);
+    const QSet<QString> &known = m_serverItems[itemType(type)];
+    QJsonArray removed;
+    for (const QString &id : ids) {
+        if (m_journal.hasPendingChange(type, id)) {
+            continue;
+        }
+        if (known.contains(id)) {
+            QJsonObject change;
+            change["type"] = type;
+            change["id"] = id;
+            change["deleted"] = true;
+            removed.append(change);
+        } else if (snapshot.contains(id)) {
+            m_journal.recordChange(type, id, snapshot[id].toObject());
+            ++m_reconcileRequeued;
+        } else {
+            untrackItem(type, id);
+        }
+    }
+    if (!removed.isEmpty()) {
+        applyRemoteChanges(removed);
+    }
+}
+
+void SyncManager::finishReconcile(bool success)
+{
+    m_isSyncing = false;
+    if (success && !m_reconcileCursor.isEmpty()) {
+        m_journal.setServerCursor(m_reconcileCursor);
+    }
+    saveTrees();
+    emit syncFinished();
+    emit reconciliationFinished(success, m_reconcileFetched, m_reconcileRequeued);
+    
+    // Найденные локальные объекты уходят обычной синхронизацией
+    if (success && m_journal.pendingCount() > 0) {
+        QTimer::singleShot(0, this, &SyncManager::sync);
+    }
+}
+
+bool SyncManager::processServerResponse(const QJsonObject &response, quint64 sentCursor)
+{
+    // Обработка ответа от сервера
+    bool more = false;
+    if (response["status"].toString() == "success") {
+        // Сервер подтверждает принятые изменения; без явного ack
+        // считаем принятым всё отправленное
+        const quint64 acknowledged = response.contains("ack")
+            ? response["ack"].toString().toULongLong() : sentCursor;
+        acknowledgeChanges(qMin(acknowledged, sentCursor));
         
-        if (m_settings.syncExtensions && syncedData.contains("extensions")) {
-            updateExtensions(syncedData["extensions"].toObject());
+        // Изменения других устройств после нашего курсора сервера
+        applyRemoteChanges(response["changes"].toArray());
+        if (response.contains("cursor")) {
+            m_journal.setServerCursor(response["cursor"].toString());
         }
         
-        // Обновляем информацию об устройствах
-        QJsonArray devices = response["devices"].toArray();
-        m_connectedDevices.clear();
+        // Занятое место на сервере - для проверки квоты перед выгрузкой
+        const QJsonObject quota = response["quota"].toObject();
+        if (!quota.isEmpty()) {
+            m_quotaUsed = quota["used"].toInteger();
+            m_quotaLimit = quota["limit"].toInteger();
+        }
         
-        for (const QJsonValue &val : devices) {
-            QJsonObject deviceObj = val.toObject();
-            DeviceInfo device;
-            device.id = deviceObj["id"].toString();
-            device.name = deviceObj["name"].toString();
-            device.type = deviceObj["type"].toString();
-            device.lastSync = QDateTime::fromString(
-                deviceObj["lastSync"].toString(), Qt::ISODate);
-            m_connectedDevices[device.id] = device;
+        // Курсор устарел (долгий офлайн, сброс на сервере) - нужна сверка
+        if (response["resync"].toBool()) {
+            m_journal.setServerCursor(QString());
+            m_reconcileRequested = true;
         }
+        more = response["more"].toBool() ||
+               m_journal.pendingChanges(1).value(0).sequence > sentCursor;
         
-        emit devicesUpdated();
+        // Список устройств приходит, только если он изменился
+        if (response.contains("devices")) {
+            QJsonArray devices = response["devices"].toArray();
+            m_connectedDevices.clear();
+            
+            for (const QJsonValue &val : devices) {
+                QJsonObject deviceObj = val.toObject();
+                DeviceInfo device;
+                device.id = deviceObj["id"].toString();
+                device.name = deviceObj["name"].toString();
+                device.type = deviceObj["type"].toString();
+                device.lastSync = QDateTime::fromString(
+                    deviceObj["lastSync"].toString(), Qt::ISODate);
+                m_connectedDevices[device.id] = device;
+            }
+            
+            emit devicesUpdated();
+        }
     } else {
         m_syncState.lastError = response["error"].toString();
         emit syncError(m_syncState.lastError);
     }
+    return more;
+}
+
+void SyncManager::acknowledgeChanges(quint64 cursor)
+{
+    // Принятые сервером объекты запоминаем: если при сверке их на сервере
+    // не окажется, значит, их удалили на другом устройстве
+    const QList<SyncChange> changes = m_journal.pendingChanges(MAX_CHANGES_PER_SYNC);
+    for (const SyncChange &change : changes) {
+        if (change.sequence > cursor) {
+            break;
+        }
+        QSet<QString> &known = m_serverItems[itemType(change.type)];
+        if (change.deleted) {
+            known.remove(change.id);
+        } else {
+            known.insert(change.id);
+        }
+    }
+    m_journal.acknowledge(cursor);
 }
 
 QString SyncManager::generateDeviceId() const
@@ -6,9 +6,16 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include <QTimer>
-#include <QQueue>
-#include <QMutex>
+#include <QUrl>
+#include <QHash>
+#include <QSet>
+#include <QVariant>
+#include "syncjournal.h"
+#include "merkletree.h"
+#include "syncuploader.h"
 
 enum class SyncItemType {
     Bookmark,
@@ -30,6 +37,28 @@ struct SyncItem {
     QHash<QString, QVariant> metadata;
 };
 
+struct DeviceInfo {
+    QString id;
+    QString name;
+    QString type;
+    QDateTime lastSync;
+};
+
+struct SyncSettings {
+    bool autoSync = true;
+    bool syncBookmarks = true;
+    bool syncHistory = true;
+    bool syncPasswords = true;
+    bool syncSettings = true;
+    bool syncExtensions = true;
+};
+
+struct SyncState {
+    QDateTime lastSyncTime;
+    QString lastError;
+    bool syncInProgress = false;
+};
+
 class SyncManager : public QObject
 {
     Q_OBJECT
@@ -38,98 +67,123 @@ public:
     explicit SyncManager(QObject *parent = nullptr);
     ~SyncManager();
 
-    // Управление аккаунтом
-    bool signIn(const QString &username, const QString &password);
-    bool signOut();
-    bool isSignedIn() const;
-    QString getCurrentUser() const;
-    
-    // Основные операции синхронизации
-    bool startSync();
-    bool stopSync();
-    bool forceSyncNow();
-    bool isSyncing() const;
-    
     // Настройка синхронизации
-    void setSyncInterval(int minutes);
-    void enableAutoSync(bool enable);
-    void setSyncTypes(const QList<SyncItemType> &types);
+    void setSyncSettings(const SyncSettings &settings);
+    SyncSettings getSyncSettings() const;
+    void setServerUrl(const QUrl &url);
+    QUrl getServerUrl() const;
+    // Предел сжатого размера одной выгрузки
     void setMaxSyncSize(qint64 size);
     
-    // Управление данными
-    bool addSyncItem(const SyncItem &item);
-    bool removeSyncItem(const QString &id);
-    bool updateSyncItem(const SyncItem &item);
-    SyncItem getSyncItem(const QString &id) const;
+    // Журнал изменений: источники данных сообщают о каждой правке,
+    // синхронизация отправляет только неподтверждённые записи
+    bool recordChange(const QString &type, const QString &id, const QJsonObject &data);
+    bool recordRemoval(const QString &type, const QString &id);
+    int getPendingChangesCount() const;
+    void resetSyncJournal();
     
-    // Конфликты и версионность
-    QList<SyncItem> getConflicts() const;
-    bool resolveConflict(const QString &id, const SyncItem &resolution);
-    QList<SyncItem> getItemHistory(const QString &id) const;
-    bool revertToVersion(const QString &id, const QString &version);
+    // Сверка деревьев хэшей с сервером после потери курсора: обмен
+    // уровнями сверху вниз, загрузка только различающихся объектов
+    bool reconcile();
     
-    // Статистика и мониторинг
-    QDateTime getLastSyncTime() const;
-    int getPendingChangesCount() const;
-    qint64 getTotalSyncSize() const;
-    QHash<SyncItemType, int> getSyncStats() const;
+    // Устройства аккаунта
+    QList<DeviceInfo> getConnectedDevices() const;
+    bool isDeviceConnected(const QString &deviceId) const;
+    void disconnectDevice(const QString &deviceId);
     
-    // Экспорт/Импорт
-    bool exportSyncData(const QString &filename) const;
-    bool importSyncData(const QString &filename);
-    bool mergeSyncData(const QString &filename);
+    SyncState getSyncState() const;
+    bool isSyncing() const;
+
+public slots:
+    void sync();
 
 signals:
     void syncStarted();
-    void syncCompleted(bool success);
+    void syncFinished();
     void syncProgress(int percent);
     void syncError(const QString &error);
-    void itemAdded(const SyncItem &item);
-    void itemRemoved(const QString &id);
-    void itemUpdated(const SyncItem &item);
-    void conflictDetected(const SyncItem &local, const SyncItem &remote);
-    void authenticationRequired();
+    void syncSettingsChanged();
     void quotaExceeded(qint64 current, qint64 limit);
-    void connectionError(const QString &error);
-
-private slots:
-    void performSync();
-    void handleNetworkReply(QNetworkReply *reply);
-    void checkConnectivity();
-    void retryFailedOperations();
-    void processQueue();
+    void devicesUpdated();
+    void deviceDisconnected(const QString &deviceId);
+    void reconciliationFinished(bool success, int fetched, int requeued);
 
 private:
-    bool initializeSync();
-    bool validateToken();
+    void loadDeviceInfo();
+    void saveDeviceInfo();
+    void loadSyncData();
+    void saveSyncData();
     QString generateDeviceId() const;
-    bool uploadChanges();
-    bool downloadChanges();
-    void mergeChanges(const QList<SyncItem> &remoteChanges);
-    bool resolveConflicts(const QList<SyncItem> &conflicts);
-    void updateLocalDatabase(const SyncItem &item);
-    void addToQueue(const SyncItem &item);
-    void saveState();
-    void loadState();
+    
+    // Ответ сервера на выгрузку; true - нужен ещё один обмен
+    bool processServerResponse(const QJsonObject &response, quint64 sentCursor);
+    void acknowledgeChanges(quint64 cursor);
+    void handleUploadFinished(const QJsonObject &response);
+    void handleUploadFailed(const QString &error);
+    void finishSync(bool more);
+    
+    // Снимки локальных данных и применение изменений с сервера
+    QJsonObject prepareBookmarksData() const;
+    QJsonObject prepareHistoryData() const;
+    QJsonObject preparePasswordsData() const;
+    QJsonObject prepareSettingsData() const;
+    QJsonObject prepareExtensionsData() const;
+    void updateBookmarks(const QJsonObject &data);
+    void updateHistory(const QJsonObject &data);
+    void updatePasswords(const QJsonObject &data);
+    void updateSettings(const QJsonObject &data);
+    void updateExtensions(const QJsonObject &data);
+    
     QString calculateChecksum(const SyncItem &item) const;
+    bool isTypeEnabled(const QString &type) const;
+    void seedJournal();
+    void applyRemoteChanges(const QJsonArray &changes);
+    QJsonObject snapshotOf(const QString &type) const;
+    static SyncItemType itemType(const QString &type);
+    static QString typeName(SyncItemType type);
+    void trackItem(const QString &type, const QString &id, const QJsonObject &data);
+    void untrackItem(const QString &type, const QString &id);
+    void loadTrees();
+    void saveTrees();
+    void sendReconcileQuery(const QJsonObject &query);
+    void handleReconcileResponse(const QJsonObject &query, const QJsonObject &response);
+    void requeueLocalItems(const QString &type, const QStringList &ids);
+    void finishReconcile(bool success);
     
-    QNetworkAccessManager *m_network;
-    QString m_authToken;
-    QString m_deviceId;
-    QDateTime m_lastSync;
-    bool m_autoSyncEnabled;
-    int m_syncInterval;
-    QList<SyncItemType> m_syncTypes;
-    qint64 m_maxSyncSize;
-    QQueue<SyncItem> m_syncQueue;
-    QHash<QString, SyncItem> m_pendingChanges;
-    QMutex m_syncMutex;
+    QNetworkAccessManager *m_networkManager;
     QTimer *m_syncTimer;
     bool m_isSyncing;
+    QUrl m_serverUrl;
+    DeviceInfo m_deviceInfo;
+    SyncSettings m_settings;
+    SyncState m_syncState;
+    QHash<QString, DeviceInfo> m_connectedDevices;
+    SyncJournal m_journal;
+    bool m_applyingRemote;   // применяются изменения с сервера
+    QHash<SyncItemType, MerkleTree> m_trees;   // суммы объектов по типам
+    QHash<SyncItemType, QSet<QString>> m_serverItems;   // объекты, которые есть на сервере
+    bool m_reconcileRequested;
+    QString m_reconcileCursor;   // курсор из первого ответа сверки
+    int m_reconcileFetched;
+    int m_reconcileRequeued;
+    SyncUploader *m_uploader;
+    quint64 m_uploadCursor;    // последний номер журнала в текущей выгрузке
+    int m_uploadAttempts;
+    qint64 m_maxSyncSize;
+    qint64 m_quotaUsed;        // по последнему ответу сервера
+    qint64 m_quotaLimit;
     
-    static const QString API_ENDPOINT;
+    static const QString SYNC_FILE;
+    static const QString DEVICE_FILE;
+    static const QString JOURNAL_FILE;
+    static const QString TREE_FILE;
+    static const int SYNC_INTERVAL;
     static const int MAX_RETRY_ATTEMPTS = 3;
-    static const int DEFAULT_SYNC_INTERVAL = 30; // minutes
+    static const int MAX_CHANGES_PER_SYNC = 500;
+    static const int UPLOAD_RETRY_DELAY = 5000;   // мс, растёт с каждой попыткой
+    static const qint64 DEFAULT_MAX_SYNC_SIZE = 16 * 1024 * 1024;
+    static const quint32 TREE_MAGIC = 0x53594e54;   // "SYNT"
+    static const quint32 TREE_VERSION = 2;   // 2 - с объектами сервера
 };
 
-#endif // SYNCMANAGER_H 
\ No newline at end of file
+#endif // SYNCMANAGER_H
@@ -0,0 +1,183 @@
+#include "syncuploader.h"
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QCborValue>
+#include <QCborMap>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+SyncUploader::SyncUploader(QNetworkAccessManager *network, QObject *parent)
+    : QObject(parent)
+    , m_network(network)
+    , m_reply(nullptr)
+    , m_currentChunk(-1)
+    , m_encodedSize(0)
+    , m_compressedSize(0)
+{
+}
+
+QByteArray SyncUploader::encode(const QJsonObject &payload)
+{
+    return QCborValue::fromJsonValue(payload).toCbor();
+}
+
+QList<QByteArray> SyncUploader::compressChunks(const QByteArray &data, int chunkSize)
+{
+    // Куски сжимаются независимо: любой можно переслать или распаковать
+    // отдельно, не держа в памяти весь поток. qCompress пишет перед
+    // потоком zlib свой 4-байтовый размер - на сервер он не уходит
+    QList<QByteArray> chunks;
+    for (qsizetype offset = 0; offset < data.size(); offset += chunkSize) {
+        const QByteArray compressed = qCompress(QByteArray::fromRawData(
+            data.constData() + offset, qMin<qsizetype>(chunkSize, data.size() - offset)));
+        chunks.append(compressed.mid(QT_SIZE_HINT));
+    }
+    return chunks;
+}
+
+QJsonObject SyncUploader::decode(const QList<QByteArray> &chunks, int chunkSize)
+{
+    // qUncompress ждёт размер перед потоком; размер куска - верхняя
+    // оценка, буфер подрезается до фактического
+    QByteArray hint(QT_SIZE_HINT, '\0');
+    qToBigEndian<quint32>(quint32(chunkSize), hint.data());
+    
+    QByteArray data;
+    for (const QByteArray &chunk : chunks) {
+        const QByteArray part = qUncompress(hint + chunk);
+        if (part.isEmpty()) {
+            return QJsonObject();
+        }
+        data += part;
+    }
+    return QCborValue::fromCbor(data).toMap().toJsonObject();
+}
+
+qint64 SyncUploader::measure(const QJsonObject &payload)
+{
+    qint64 size = 0;
+    const QList<QByteArray> chunks = compressChunks(encode(payload));
+    for (const QByteArray &chunk : chunks) {
+        size += chunk.size();
+    }
+    return size;
+}
+
+bool SyncUploader::prepare(const QJsonObject &payload)
+{
+    if (m_reply) {
+        return false;
+    }
+    
+    const QByteArray encoded = encode(payload);
+    const QByteArray uploadId = QCryptographicHash::hash(encoded, QCryptographicHash::Sha256).toHex();
+    if (uploadId == m_uploadId) {
+        return true;
+    }
+    
+    m_uploadId = uploadId;
+    m_chunks = compressChunks(encoded);
+    m_acknowledged.clear();
+    m_encodedSize = encoded.size();
+    m_compressedSize = 0;
+    for (const QByteArray &chunk : std::as_const(m_chunks)) {
+        m_compressedSize += chunk.size();
+    }
+    return !m_chunks.isEmpty();
+}
+
+void SyncUploader::upload(const QUrl &url)
+{
+    if (m_reply || m_chunks.isEmpty()) {
+        return;
+    }
+    m_url = url;
+    sendNextChunk();
+}
+
+void SyncUploader::abort()
+{
+    if (m_reply) {
+        QNetworkReply *reply = m_reply;
+        m_reply = nullptr;
+        reply->abort();
+        reply->deleteLater();
+    }
+}
+
+void SyncUploader::sendNextChunk()
+{
+    // Последний кусок уходит последним: ответ на него - итог выгрузки
+    m_currentChunk = -1;
+    for (int i = 0; i < m_chunks.size(); ++i) {
+        if (!m_acknowledged.contains(i) && (i < m_chunks.size() - 1 || m_acknowledged.size() == i)) {
+            m_currentChunk = i;
+            break;
+        }
+    }
+    if (m_currentChunk < 0) {
+        m_currentChunk = m_chunks.size() - 1;
+    }
+    
+    QNetworkRequest request(m_url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/octet-stream");
+    request.setRawHeader("X-Sync-Upload", m_uploadId);
+    request.setRawHeader("X-Sync-Chunk", QByteArray::number(m_currentChunk) + '/' +
+                                         QByteArray::number(m_chunks.size()));
+    request.setRawHeader("X-Sync-Encoding", "cbor+zlib");
+    
+    m_reply = m_network->post(request, m_chunks[m_currentChunk]);
+    connect(m_reply, &QNetworkReply::finished, this, &SyncUploader::handleChunkReply);
+}
+
+void SyncUploader::handleChunkReply()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || reply != m_reply) {
+        // Отменённый запрос
+        return;
+    }
+    m_reply = nullptr;
+    reply->deleteLater();
+    
+    if (reply->error() != QNetworkReply::NoError) {
+        // Подтверждённые куски остаются подтверждёнными до следующей попытки
+        emit failed(reply->errorString());
+        return;
+    }
+    
+    const QByteArray body = reply->readAll();
+    QJsonObject response;
+    if (reply->header(QNetworkRequest::ContentTypeHeader).toString().startsWith("application/cbor")) {
+        response = QCborValue::fromCbor(body).toMap().toJsonObject();
+    } else if (!body.isEmpty()) {
+        response = QJsonDocument::fromJson(body).object();
+    }
+    
+    m_acknowledged.insert(m_currentChunk);
+    
+    // Сервер может попросить повторить потерянные куски; тогда и
+    // последний кусок отправляется снова, чтобы получить итоговый ответ
+    const QJsonArray missing = response["missing"].toArray();
+    for (const QJsonValue &val : missing) {
+        m_acknowledged.remove(val.toInt());
+    }
+    if (!missing.isEmpty()) {
+        m_acknowledged.remove(m_chunks.size() - 1);
+    }
+    emit progress(m_acknowledged.size(), m_chunks.size());
+    
+    if (m_acknowledged.size() < m_chunks.size()) {
+        sendNextChunk();
+        return;
+    }
+    
+    // Выгрузка завершена; повтор тех же данных начнётся заново
+    m_uploadId.clear();
+    m_chunks.clear();
+    m_acknowledged.clear();
+    emit finished(response);
+}
@@ -0,0 +1,66 @@
+#ifndef SYNCUPLOADER_H
+#define SYNCUPLOADER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QSet>
+#include <QUrl>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+
+// Транспорт выгрузки синхронизации: данные кодируются в CBOR, режутся на
+// куски фиксированного размера, каждый сжимается отдельно в обычный поток
+// zlib (RFC 1950) и отправляется со своим номером. Подтверждённые сервером куски при повторе не
+// отправляются; ответ на последний кусок - ответ синхронизации.
+class SyncUploader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SyncUploader(QNetworkAccessManager *network, QObject *parent = nullptr);
+    
+    // Кодирует и сжимает данные; для тех же данных подтверждения
+    // предыдущей попытки сохраняются
+    bool prepare(const QJsonObject &payload);
+    void upload(const QUrl &url);
+    void abort();
+    
+    bool isUploading() const { return m_reply != nullptr; }
+    QByteArray uploadId() const { return m_uploadId; }
+    int chunkCount() const { return m_chunks.size(); }
+    int acknowledgedCount() const { return m_acknowledged.size(); }
+    qint64 encodedSize() const { return m_encodedSize; }
+    qint64 compressedSize() const { return m_compressedSize; }
+    
+    static QByteArray encode(const QJsonObject &payload);
+    static QList<QByteArray> compressChunks(const QByteArray &data, int chunkSize = CHUNK_SIZE);
+    static QJsonObject decode(const QList<QByteArray> &chunks, int chunkSize = CHUNK_SIZE);
+    // Сжатый размер данных без изменения состояния выгрузки
+    static qint64 measure(const QJsonObject &payload);
+    
+    static const int CHUNK_SIZE = 256 * 1024;   // байт CBOR до сжатия
+
+signals:
+    void progress(int acknowledged, int total);
+    void finished(const QJsonObject &response);
+    void failed(const QString &error);
+
+private:
+    void sendNextChunk();
+    void handleChunkReply();
+    
+    QNetworkAccessManager *m_network;
+    QNetworkReply *m_reply;
+    QUrl m_url;
+    QByteArray m_uploadId;          // SHA-256 данных
+    QList<QByteArray> m_chunks;     // сжатые куски
+    QSet<int> m_acknowledged;
+    int m_currentChunk;
+    qint64 m_encodedSize;
+    qint64 m_compressedSize;
+    
+    static const int QT_SIZE_HINT = 4;   // префикс размера у qCompress
+};
+
+#endif // SYNCUPLOADER_H
@@ -1,5 +1,12 @@
 #include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QSqlDatabase>
+#include <QSqlQuery>
 #include "bookmarkmanager.h"
+#include "linkchecker.h"
+#include "similarityindex.h"
+#include "faviconstore.h"
 
 class BookmarkTest : public QObject
 {
@@ -13,7 +20,19 @@ private slots:
     void testFolders();
     void testTags();
     void testSearch();
+    void testSearchTerms();
     void testMetadata();
+    void testFolderOrder();
+    void testSnapshotReload();
+    void testLegacyJsonMigration();
+    void testJournalReplay();
+    void testJournalCompaction();
+    void testImportNetscape();
+    void testImportBrowserJson();
+    void testImportFirefox();
+    void testLinkChecker();
+    void testSimilarityIndex();
+    void testFaviconStore();
     void cleanupTestCase();
 
 private:
@@ -24,70 +43,86 @@ private:
 
 void BookmarkTest::initTestCase()
 {
+    // Отдельный каталог данных, чтобы прошлые запуски не влияли на счётчики
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
+    
     bookmarks = new BookmarkManager(this);
 }
 
 void BookmarkTest::testAddBookmark()
 {
-    qint64 id = bookmarks->addBookmark(testUrl, testTitle);
-    QVERIFY(id > 0);
+    QString id = bookmarks->addBookmark(testUrl, testTitle);
+    QVERIFY(!id.isEmpty());
     
-    BookmarkItem item = bookmarks->getBookmark(id);
-    QCOMPARE(item.url, testUrl);
-    QCOMPARE(item.title, testTitle);
+    Bookmark bookmark = bookmarks->getBookmark(id);
+    QCOMPARE(bookmark.url, testUrl);
+    QCOMPARE(bookmark.title, testTitle);
+    QCOMPARE(bookmark.folderId, QString("root"));
 }
 
 void BookmarkTest::testRemoveBookmark()
 {
-    qint64 id = bookmarks->addBookmark(testUrl, testTitle);
+    QString id = bookmarks->addBookmark(testUrl, testTitle);
     QVERIFY(bookmarks->removeBookmark(id));
+    QVERIFY(!bookmarks->removeBookmark(id));
     
-    BookmarkItem item = bookmarks->getBookmark(id);
-    QVERIFY(item.id == 0); // Должен вернуть пустой элемент
+    // Должен вернуть пустой элемент
+    QVERIFY(bookmarks->getBookmark(id).id.isEmpty());
 }
 
 void BookmarkTest::testUpdateBookmark()
 {
-    qint64 id = bookmarks->addBookmark(testUrl, testTitle);
-    
-    QHash<QString, QVariant> properties;
-    properties["title"] = "Updated Title";
-    properties["description"] = "Test Description";
+    QString id = bookmarks->addBookmark(testUrl, testTitle);
     
-    QVERIFY(bookmarks->updateBookmark(id, properties));
+    QVERIFY(bookmarks->updateBookmark(id, "https://updated.test", "Updated Title"));
     
-    BookmarkItem item = bookmarks->getBookmark(id);
-    QCOMPARE(item.title, "Updated Title");
-    QCOMPARE(item.description, "Test Description");
+    Bookmark bookmark = bookmarks->getBookmark(id);
+    QCOMPARE(bookmark.title, QString("Updated Title"));
+    QCOMPARE(bookmark.url, QString("https://updated.test"));
 }
 
 void BookmarkTest::testFolders()
 {
-    qint64 folderId = bookmarks->createFolder("Test Folder");
-    QVERIFY(folderId > 0);
+    QString folderId = bookmarks->createFolder("Test Folder");
+    QVERIFY(!folderId.isEmpty());
+    QCOMPARE(bookmarks->getFolder(folderId).name, QString("Test Folder"));
     
-    qint64 bookmarkId = bookmarks->addBookmark(testUrl, testTitle);
-    QVERIFY(bookmarks->moveBookmark(bookmarkId, "Test Folder"));
+    QString bookmarkId = bookmarks->addBookmark(testUrl, testTitle);
+    QVERIFY(bookmarks->moveBookmark(bookmarkId, folderId));
     
-    auto folderBookmarks = bookmarks->getBookmarksByFolder("Test Folder");
+    auto folderBookmarks = bookmarks->getBookmarksInFolder(folderId);
     QCOMPARE(folderBookmarks.size(), 1);
     QCOMPARE(folderBookmarks[0].id, bookmarkId);
+    
+    // Закладка ушла из прежней папки
+    for (const Bookmark &bookmark : bookmarks->getBookmarksInFolder("root")) {
+        QVERIFY(bookmark.id != bookmarkId);
+    }
 }
 
 void BookmarkTest::testTags()
 {
-    qint64 id = bookmarks->addBookmark(testUrl, testTitle);
+    QString id = bookmarks->addBookmark("https://tags.test", "Tagged");
+    
+    QVERIFY(bookmarks->setTags(id, {"test_tag", "another_tag", "test_tag"}));
+    QCOMPARE(bookmarks->getBookmark(id).tags, QStringList({"test_tag", "another_tag"}));
     
-    QVERIFY(bookmarks->addTag(id, "test_tag"));
-    QVERIFY(bookmarks->addTag(id, "another_tag"));
+    auto tagged = bookmarks->searchBookmarks("test_tag");
+    QCOMPARE(tagged.size(), 1);
+    QCOMPARE(tagged[0].id, id);
     
-    auto taggedBookmarks = bookmarks->getBookmarksByTag("test_tag");
-    QCOMPARE(taggedBookmarks.size(), 1);
-    QCOMPARE(taggedBookmarks[0].id, id);
+    QVERIFY(bookmarks->setTags(id, {"another_tag"}));
+    QVERIFY(bookmarks->searchBookmarks("test_tag").isEmpty());
+    QVERIFY(!bookmarks->setTags("missing", {"tag"}));
     
-    QVERIFY(bookmarks->removeTag(id, "test_tag"));
-    taggedBookmarks = bookmarks->getBookmarksByTag("test_tag");
-    QVERIFY(taggedBookmarks.isEmpty());
+    // Составные метки находятся и целиком, и по отдельным словам
+    QVERIFY(bookmarks->setTags(id, {"Machine-Learning", "два слова"}));
+    QCOMPARE(bookmarks->searchBookmarks("machine-learning").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("learning").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("два слова").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("СЛОВА").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("machine слова").size(), 1);
 }
 
 void BookmarkTest::testSearch()
@@ -97,15 +132,502 @@ void BookmarkTest::testSearch()
     
     auto results = bookmarks->searchBookmarks("example");
     QCOMPARE(results.size(), 1);
-    QCOMPARE(results[0].title, "Example Site");
+    QCOMPARE(results[0].title, QString("Example Site"));
+}
+
+void BookmarkTest::testSearchTerms()
+{
+    bookmarks->addBookmark("https://docs.qt.io/qt-6/qstring.html", "QString Class");
+    
+    // Префиксы слов заголовка, метки домена и сегменты пути
+    QCOMPARE(bookmarks->searchBookmarks("qstr").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("DOCS").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("qt-6").size(), 1);
+    
+    // Несколько терминов пересекаются
+    QCOMPARE(bookmarks->searchBookmarks("class docs").size(), 1);
+    QVERIFY(bookmarks->searchBookmarks("class example").isEmpty());
+    
+    // Метка домена с дефисом находится целиком и по частям
+    bookmarks->addBookmark("https://www.my-hyphen-site.com/", "Untitled");
+    QCOMPARE(bookmarks->searchBookmarks("my-hyphen-site").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("hyphen").size(), 1);
+    QCOMPARE(bookmarks->searchBookmarks("hyphen-si").size(), 1);
 }
 
 void BookmarkTest::testMetadata()
 {
-    qint64 id = bookmarks->addBookmark(testUrl, testTitle);
+    QString id = bookmarks->addBookmark(testUrl, testTitle);
     
     QVERIFY(bookmarks->setMetadata(id, "test_key", "test_value"));
-    QCOMPARE(bookmarks->getMetadata(id, "test_key").toString(), "test_value");
+    QCOMPARE(bookmarks->getBookmark(id).metadata.value("test_key").toString(), QString("test_value"));
+    
+    // Пустое значение удаляет ключ
+    QVERIFY(bookmarks->setMetadata(id, "test_key", QVariant()));
+    QVERIFY(!bookmarks->getBookmark(id).metadata.contains("test_key"));
+}
+
+void BookmarkTest::testFolderOrder()
+{
+    QString folderId = bookmarks->createFolder("Ordered Folder");
+    QString nestedId = bookmarks->createFolder("Nested Folder", folderId);
+    QString siblingId = bookmarks->createFolder("Sibling Folder", folderId);
+    
+    QString first = bookmarks->addBookmark("https://first.com", "First", folderId);
+    QString second = bookmarks->addBookmark("https://second.com", "Second", folderId);
+    QString third = bookmarks->addBookmark("https://third.com", "Third", folderId);
+    QString nested = bookmarks->addBookmark("https://nested.com", "Nested", nestedId);
+    
+    // Закладки и подпапки возвращаются в порядке position
+    auto folderBookmarks = bookmarks->getBookmarksInFolder(folderId);
+    QCOMPARE(folderBookmarks.size(), 3);
+    QCOMPARE(folderBookmarks[0].id, first);
+    QCOMPARE(folderBookmarks[1].id, second);
+    QCOMPARE(folderBookmarks[2].id, third);
+    QVERIFY(folderBookmarks[0].position < folderBookmarks[1].position);
+    
+    auto subfolders = bookmarks->getSubfolders(folderId);
+    QCOMPARE(subfolders.size(), 2);
+    QCOMPARE(subfolders[0].id, nestedId);
+    QCOMPARE(subfolders[1].id, siblingId);
+    
+    // Удаление из середины сохраняет порядок, перенос добавляет в конец
+    QVERIFY(bookmarks->removeBookmark(second));
+    QVERIFY(bookmarks->moveBookmark(first, siblingId));
+    QVERIFY(bookmarks->moveBookmark(first, folderId));
+    folderBookmarks = bookmarks->getBookmarksInFolder(folderId);
+    QCOMPARE(folderBookmarks.size(), 2);
+    QCOMPARE(folderBookmarks[0].id, third);
+    QCOMPARE(folderBookmarks[1].id, first);
+    
+    // Папку нельзя перенести внутрь её потомка
+    QVERIFY(!bookmarks->moveFolder(folderId, nestedId));
+    
+    // Удаление папки удаляет всё поддерево и чистит индекс детей
+    QVERIFY(bookmarks->removeFolder(folderId));
+    QVERIFY(bookmarks->getBookmarksInFolder(folderId).isEmpty());
+    QVERIFY(bookmarks->getBookmarksInFolder(nestedId).isEmpty());
+    QVERIFY(bookmarks->getSubfolders(folderId).isEmpty());
+    QVERIFY(bookmarks->getBookmark(first).id.isEmpty());
+    QVERIFY(bookmarks->getBookmark(nested).id.isEmpty());
+    QVERIFY(bookmarks->getFolder(nestedId).id.isEmpty());
+    for (const BookmarkFolder &folder : bookmarks->getSubfolders("root")) {
+        QVERIFY(folder.id != folderId);
+    }
+}
+
+void BookmarkTest::testSnapshotReload()
+{
+    QString folderId = bookmarks->createFolder("Snapshot Folder");
+    QString id = bookmarks->addBookmark("https://snapshot.test", "Snapshot", folderId);
+    QString later = bookmarks->addBookmark("https://snapshot.test/later", "Later", folderId);
+    QVERIFY(bookmarks->setTags(id, {"snap"}));
+    
+    // Закрытие пишет двоичный снимок, новый экземпляр читает его
+    delete bookmarks;
+    bookmarks = new BookmarkManager(this);
+    
+    Bookmark bookmark = bookmarks->getBookmark(id);
+    QCOMPARE(bookmark.url, QString("https://snapshot.test"));
+    QCOMPARE(bookmark.title, QString("Snapshot"));
+    QCOMPARE(bookmark.tags, QStringList({"snap"}));
+    
+    // Индекс детей восстановлен в прежнем порядке
+    auto folderBookmarks = bookmarks->getBookmarksInFolder(folderId);
+    QCOMPARE(folderBookmarks.size(), 2);
+    QCOMPARE(folderBookmarks[0].id, id);
+    QCOMPARE(folderBookmarks[1].id, later);
+    
+    // JSON остаётся форматом экспорта
+    QTemporaryDir dir;
+    QString exportPath = dir.filePath("bookmarks.json");
+    QVERIFY(bookmarks->exportBookmarks(exportPath));
+    QFile exported(exportPath);
+    QVERIFY(exported.open(QIODevice::ReadOnly));
+    QVERIFY(QJsonDocument::fromJson(exported.readAll()).isObject());
+}
+
+void BookmarkTest::testLegacyJsonMigration()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    const QString jsonPath = dataPath + "/bookmarks.json";
+    
+    // Данные прежней версии: только JSON, без снимка
+    QString id = bookmarks->addBookmark("https://legacy.test", "Legacy");
+    QVERIFY(bookmarks->exportBookmarks(jsonPath));
+    delete bookmarks;
+    bookmarks = nullptr;
+    QVERIFY(QFile::remove(dataPath + "/bookmarks.snapshot"));
+    
+    bookmarks = new BookmarkManager(this);
+    QCOMPARE(bookmarks->getBookmark(id).url, QString("https://legacy.test"));
+    
+    // После записи снимка JSON не удаляется, а становится резервной копией
+    delete bookmarks;
+    bookmarks = new BookmarkManager(this);
+    QVERIFY(!QFile::exists(jsonPath));
+    QVERIFY(QFile::exists(jsonPath + ".bak"));
+    QCOMPARE(bookmarks->getBookmark(id).title, QString("Legacy"));
+}
+
+void BookmarkTest::testJournalReplay()
+{
+    // Снимок пишется при закрытии, дальше изменения есть только в журналах
+    delete bookmarks;
+    bookmarks = nullptr;
+    
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    const QString journalPath = dataPath + "/bookmarks.journal";
+    const QString compactingPath = dataPath + "/bookmarks.journal.compacting";
+    
+    // Журнал прерванного уплотнения старше текущего
+    QFile compacting(compactingPath);
+    QVERIFY(compacting.open(QIODevice::WriteOnly));
+    compacting.write("{\"op\":\"putBookmark\",\"bookmark\":{\"id\":\"{replay}\","
+                     "\"url\":\"https://replay.test\",\"title\":\"Old\",\"folderId\":\"root\"}}\n");
+    compacting.close();
+    
+    QFile journal(journalPath);
+    QVERIFY(journal.open(QIODevice::WriteOnly));
+    journal.write("{\"op\":\"putBookmark\",\"bookmark\":{\"id\":\"{replay}\","
+                  "\"url\":\"https://replay.test\",\"title\":\"New\",\"folderId\":\"root\"}}\n");
+    const qint64 validSize = journal.pos();
+    // Запись, оборванная сбоем
+    journal.write("{\"op\":\"putBookmark\",\"bookmark\":{\"id\":\"{torn}\",\"url\":");
+    journal.close();
+    
+    bookmarks = new BookmarkManager(this);
+    
+    QCOMPARE(bookmarks->getBookmark("{replay}").title, QString("New"));
+    QVERIFY(bookmarks->getBookmark("{torn}").id.isEmpty());
+    
+    // Хвост обрезан, новая запись начинается с новой строки
+    QCOMPARE(QFileInfo(journalPath).size(), validSize);
+    QString id = bookmarks->addBookmark("https://after-torn.test", "After");
+    QVERIFY(journal.open(QIODevice::ReadOnly));
+    int records = 0;
+    while (!journal.atEnd()) {
+        QVERIFY(QJsonDocument::fromJson(journal.readLine()).isObject());
+        ++records;
+    }
+    journal.close();
+    QCOMPARE(records, 2);
+    
+    delete bookmarks;
+    bookmarks = new BookmarkManager(this);
+    QCOMPARE(bookmarks->getBookmark(id).url, QString("https://after-torn.test"));
+    QVERIFY(!QFile::exists(compactingPath));
+}
+
+void BookmarkTest::testJournalCompaction()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    const QString journalPath = dataPath + "/bookmarks.journal";
+    const QString compactingPath = dataPath + "/bookmarks.journal.compacting";
+    
+    // Около 700 КБ записей: журнал переходит порог уплотнения
+    const QString folderId = bookmarks->createFolder("Compaction");
+    const QString longTitle(2048, QChar('x'));
+    for (int i = 0; i < 320; ++i) {
+        bookmarks->addBookmark(QString("https://compact.test/%1").arg(i), longTitle, folderId);
+    }
+    
+    // Уплотнение идёт в фоне, по завершении отложенный журнал удаляется
+    QTRY_VERIFY_WITH_TIMEOUT(!QFile::exists(compactingPath), 10000);
+    QVERIFY(QFile::exists(dataPath + "/bookmarks.snapshot"));
+    QVERIFY(QFileInfo(journalPath).size() < 512 * 1024);
+    
+    // Снимок и журнал вместе содержат все закладки
+    delete bookmarks;
+    bookmarks = new BookmarkManager(this);
+    auto folderBookmarks = bookmarks->getBookmarksInFolder(folderId);
+    QCOMPARE(folderBookmarks.size(), 320);
+    QCOMPARE(folderBookmarks.last().url, QString("https://compact.test/319"));
+    QVERIFY(bookmarks->removeFolder(folderId));
+}
+
+void BookmarkTest::testImportNetscape()
+{
+    QTemporaryDir dir;
+    QFile file(dir.filePath("bookmarks.html"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("<!DOCTYPE NETSCAPE-Bookmark-file-1>\n"
+               "<TITLE>Bookmarks</TITLE>\n<H1>Bookmarks</H1>\n"
+               "<DL><p>\n"
+               "    <DT><H3 ADD_DATE=\"1600000000\">Import &amp; Test</H3>\n"
+               "    <DL><p>\n"
+               "        <DT><A HREF=\"https://import.test/one\" ADD_DATE=\"1600000000\">One</A>\n"
+               "        <DT><A HREF=\"https://import.test/two\">Two</A>\n"
+               "        <DT><A HREF=\"https://import.test/one/\">One again</A>\n"
+               "    </DL><p>\n"
+               "    <DT><A HREF=\"place:sort=8\">Recent</A>\n"
+               "</DL><p>\n");
+    file.close();
+    
+    QSignalSpy spy(bookmarks, &BookmarkManager::importCompleted);
+    QVERIFY(bookmarks->importBookmarks(file.fileName(), "html"));
+    QCOMPARE(spy.count(), 1);
+    
+    // Повтор адреса и служебная ссылка place: отброшены
+    QCOMPARE(spy.first().first().toInt(), 2);
+    
+    // Папка файла вложена в папку импорта
+    QList<BookmarkFolder> roots = bookmarks->getSubfolders("root");
+    QVERIFY(!roots.isEmpty());
+    QList<BookmarkFolder> folders = bookmarks->getSubfolders(roots.last().id);
+    QCOMPARE(folders.size(), 1);
+    QCOMPARE(folders[0].name, QString("Import & Test"));
+    
+    QList<Bookmark> imported = bookmarks->getBookmarksInFolder(folders[0].id);
+    QCOMPARE(imported.size(), 2);
+    QCOMPARE(imported[0].title, QString("One"));
+    QCOMPARE(imported[1].url, QString("https://import.test/two"));
+}
+
+void BookmarkTest::testImportBrowserJson()
+{
+    // Формат нашего экспорта: "root" - корень, а не безымянная папка
+    QTemporaryDir dir;
+    QFile file(dir.filePath("export.json"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("{\"bookmarks\": ["
+               "{\"url\": \"https://json.test/top\", \"title\": \"Top\", \"folderId\": \"root\"},"
+               "{\"url\": \"https://json.test/nested\", \"title\": \"Nested\", \"folderId\": \"f1\"}],"
+               "\"folders\": [{\"id\": \"f1\", \"name\": \"Sub\", \"parentId\": \"root\"}]}");
+    file.close();
+    
+    QVERIFY(bookmarks->importBookmarks(file.fileName(), "json"));
+    
+    const BookmarkFolder importRoot = bookmarks->getSubfolders("root").last();
+    QList<Bookmark> top = bookmarks->getBookmarksInFolder(importRoot.id);
+    QCOMPARE(top.size(), 1);
+    QCOMPARE(top[0].title, QString("Top"));
+    
+    QList<BookmarkFolder> folders = bookmarks->getSubfolders(importRoot.id);
+    QCOMPARE(folders.size(), 1);
+    QCOMPARE(folders[0].name, QString("Sub"));
+    QCOMPARE(bookmarks->getBookmarksInFolder(folders[0].id).size(), 1);
+}
+
+void BookmarkTest::testImportFirefox()
+{
+    QTemporaryDir dir;
+    const QString placesPath = dir.filePath("places.sqlite");
+    const QString connectionName = "test_firefox_places";
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(placesPath);
+        QVERIFY(db.open());
+        
+        // Firefox работает в режиме WAL; пока соединение открыто и
+        // контрольная точка не пройдена, данные есть только в -wal
+        QSqlQuery query(db);
+        QVERIFY(query.exec("PRAGMA journal_mode=WAL"));
+        QVERIFY(query.exec("PRAGMA wal_autocheckpoint=0"));
+        QVERIFY(query.exec("CREATE TABLE moz_places (id INTEGER PRIMARY KEY, url TEXT)"));
+        QVERIFY(query.exec("CREATE TABLE moz_bookmarks (id INTEGER PRIMARY KEY, type INTEGER,"
+                           " fk INTEGER, parent INTEGER, position INTEGER, title TEXT,"
+                           " dateAdded INTEGER)"));
+        QVERIFY(query.exec("INSERT INTO moz_places VALUES (1, 'https://firefox.test/'),"
+                           " (2, 'https://firefox.test/tagged')"));
+        // 1 - корень, 2 - меню, 4 - метки; метка "news" с одной закладкой
+        QVERIFY(query.exec("INSERT INTO moz_bookmarks VALUES"
+                           " (1, 2, NULL, 0, 0, '', 0),"
+                           " (2, 2, NULL, 1, 0, 'menu', 0),"
+                           " (4, 2, NULL, 1, 1, 'tags', 0),"
+                           " (10, 2, NULL, 2, 0, 'Firefox Folder', 0),"
+                           " (11, 1, 1, 10, 0, 'Firefox', 1600000000000000),"
+                           " (12, 2, NULL, 4, 0, 'news', 0),"
+                           " (13, 1, 2, 12, 0, NULL, 0)"));
+        QVERIFY(QFileInfo(placesPath + "-wal").size() > 0);
+        
+        QSignalSpy spy(bookmarks, &BookmarkManager::importCompleted);
+        QVERIFY(bookmarks->importBookmarks(placesPath, "firefox"));
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy.first().first().toInt(), 1);
+        
+        // Ни папки меток, ни помеченной через неё закладки
+        const BookmarkFolder importRoot = bookmarks->getSubfolders("root").last();
+        QList<BookmarkFolder> folders = bookmarks->getSubfolders(importRoot.id);
+        QCOMPARE(folders.size(), 1);
+        QCOMPARE(folders[0].name, QString("menu"));
+        QList<BookmarkFolder> nested = bookmarks->getSubfolders(folders[0].id);
+        QCOMPARE(nested.size(), 1);
+        QList<Bookmark> imported = bookmarks->getBookmarksInFolder(nested[0].id);
+        QCOMPARE(imported.size(), 1);
+        QCOMPARE(imported[0].url, QString("https://firefox.test/"));
+        QVERIFY(bookmarks->searchBookmarks("tagged").isEmpty());
+        
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+void BookmarkTest::testLinkChecker()
+{
+    // Локальный сервер: /ok - 200, /nohead - отказ на HEAD, /gone - 404,
+    // /slow - не отвечает. Ответы задерживаются, чтобы запросы пересекались.
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    int inFlight = 0;
+    int peakInFlight = 0;
+    QStringList requests;
+    
+    connect(&server, &QTcpServer::newConnection, this, [&]() {
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, socket, [&, socket]() {
+            QByteArray buffer = socket->property("buffer").toByteArray() + socket->readAll();
+            int end;
+            while ((end = buffer.indexOf("\r\n\r\n")) >= 0) {
+                const QList<QByteArray> requestLine = buffer.left(buffer.indexOf("\r\n")).split(' ');
+                buffer.remove(0, end + 4);
+                const QByteArray method = requestLine.value(0);
+                const QByteArray path = requestLine.value(1);
+                requests.append(QString::fromLatin1(method + ' ' + path));
+                if (path == "/slow") {
+                    continue;
+                }
+                
+                QByteArray status = "200 OK";
+                if (path == "/gone") {
+                    status = "404 Not Found";
+                } else if (path == "/nohead") {
+                    status = method == "HEAD" ? "405 Method Not Allowed" : "206 Partial Content";
+                }
+                
+                peakInFlight = qMax(peakInFlight, ++inFlight);
+                QTimer::singleShot(50, socket, [&, socket, method, status]() {
+                    --inFlight;
+                    socket->write("HTTP/1.1 " + status + "\r\nContent-Length: 1\r\n\r\n");
+                    if (method != "HEAD") {
+                        socket->write("x");
+                    }
+                });
+            }
+            socket->setProperty("buffer", buffer);
+        });
+    });
+    
+    // Закрытый порт изображает недоступный хост
+    QTcpServer closed;
+    QVERIFY(closed.listen(QHostAddress::LocalHost));
+    const quint16 deadPort = closed.serverPort();
+    closed.close();
+    
+    LinkChecker checker;
+    checker.setMaxPerHost(2);
+    checker.setTimeout(500);
+    
+    QHash<QString, LinkCheckResult> results;
+    connect(&checker, &LinkChecker::checked, this, [&results](const LinkCheckResult &result) {
+        results.insert(result.id, result);
+    });
+    QSignalSpy finished(&checker, &LinkChecker::finished);
+    
+    const QString base = QString("http://127.0.0.1:%1").arg(server.serverPort());
+    for (int i = 0; i < 6; ++i) {
+        checker.enqueue(QString("ok%1").arg(i), QUrl(base + "/ok"));
+    }
+    checker.enqueue("nohead", QUrl(base + "/nohead"));
+    checker.enqueue("gone", QUrl(base + "/gone"));
+    checker.enqueue("slow", QUrl(base + "/slow"));
+    checker.enqueue("dead", QUrl(QString("http://127.0.0.1:%1/").arg(deadPort)));
+    
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(results.size(), 10);
+    QVERIFY(peakInFlight <= 2);
+    
+    QCOMPARE(results["ok0"].httpStatus, 200);
+    QVERIFY(!results["ok5"].isBroken());
+    QCOMPARE(results["nohead"].httpStatus, 206);
+    QCOMPARE(results["gone"].httpStatus, 404);
+    QVERIFY(results["gone"].isBroken());
+    QVERIFY(results["slow"].isBroken());
+    QVERIFY(results["dead"].isBroken());
+    QVERIFY(!checker.isRunning());
+    
+    // 404 на HEAD окончательный: GET не отправляется
+    QVERIFY(!requests.contains("GET /gone"));
+    QVERIFY(requests.contains("GET /nohead"));
+    
+    // Периодическая проверка закладок выключена, пока её не включат
+    QVERIFY(!bookmarks->isPeriodicLinkCheckEnabled());
+    bookmarks->setPeriodicLinkCheck(true);
+    QVERIFY(bookmarks->isPeriodicLinkCheckEnabled());
+    bookmarks->setPeriodicLinkCheck(false);
+}
+
+void BookmarkTest::testSimilarityIndex()
+{
+    SimilarityIndex index;
+    index.insert("a", "QString Class | Qt Core 6", "https://doc.qt.io/qt-6/qstring.html");
+    index.insert("b", "QString Class | Qt Core 6", "https://doc.qt.io/qt-6/qstring.html");
+    index.insert("c", "Weather forecast for Moscow", "https://weather.example/moscow");
+    
+    // Одинаковые признаки дают одинаковые сигнатуры и общие корзины
+    QList<QPair<QString, double>> similar = index.similar("a", 10);
+    QCOMPARE(similar.size(), 1);
+    QCOMPARE(similar.first().first, QString("b"));
+    QCOMPARE(similar.first().second, 1.0);
+    QVERIFY(index.similar("c", 10).isEmpty());
+    
+    QVERIFY(SimilarityIndex::estimateSimilarity(
+                SimilarityIndex::signature("QString Class | Qt Core 6", "https://doc.qt.io/qt-6/qstring.html"),
+                SimilarityIndex::signature("Weather forecast", "https://weather.example/")) < 0.3);
+    
+    // Удаление обновляет корзины
+    index.remove("b");
+    QVERIFY(index.similar("a", 10).isEmpty());
+    QVERIFY(!index.contains("b"));
+}
+
+void BookmarkTest::testFaviconStore()
+{
+    FaviconStore *store = FaviconStore::instance();
+    store->clear();
+    const QString storePath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+                              "/favicons/";
+    
+    // Одинаковое изображение двух сайтов хранится один раз
+    const QString shared = store->storeIconData(QUrl("https://icons.test/page"), "icon-a");
+    QCOMPARE(store->storeIconData(QUrl("https://mirror.icons.test/"), "icon-a"), shared);
+    const QString other = store->storeIconData(QUrl("https://other-icons.test/"), "icon-b");
+    QCOMPARE(store->hashForUrl(QUrl("https://icons.test/another")), shared);
+    QVERIFY(QFile::exists(storePath + other + ".png"));
+    
+    QString first = bookmarks->addBookmark("https://icons.test/page", "Icons");
+    QString second = bookmarks->addBookmark("https://icons.test/second", "Icons 2");
+    
+    // Источник ещё используется другой закладкой, other-icons - никем
+    QVERIFY(bookmarks->removeBookmark(first));
+    store->releaseUrl(QUrl("https://other-icons.test/x"));
+    store->removeReleasedIcons();
+    QCOMPARE(store->hashForUrl(QUrl("https://icons.test/")), shared);
+    QVERIFY(store->hashForUrl(QUrl("https://other-icons.test/")).isEmpty());
+    QVERIFY(!QFile::exists(storePath + other + ".png"));
+    
+    // Файл остаётся, пока изображение нужно другому источнику
+    QVERIFY(bookmarks->removeBookmark(second));
+    store->removeReleasedIcons();
+    QVERIFY(store->hashForUrl(QUrl("https://icons.test/")).isEmpty());
+    QCOMPARE(store->hashForUrl(QUrl("https://mirror.icons.test/")), shared);
+    QVERIFY(QFile::exists(storePath + shared + ".png"));
+    
+    // Закладка, перенесённая на другой адрес, освобождает прежний источник
+    const QString moved = store->storeIconData(QUrl("https://moved-icons.test/"), "icon-c");
+    QString edited = bookmarks->addBookmark("https://moved-icons.test/page", "Moved");
+    QVERIFY(bookmarks->updateBookmark(edited, "https://mirror.icons.test/page", "Moved"));
+    store->removeReleasedIcons();
+    QVERIFY(store->hashForUrl(QUrl("https://moved-icons.test/")).isEmpty());
+    QVERIFY(!QFile::exists(storePath + moved + ".png"));
+    QCOMPARE(store->hashForUrl(QUrl("https://mirror.icons.test/")), shared);
+    QVERIFY(bookmarks->removeBookmark(edited));
+    
+    // Очистка данных удаляет всё
+    store->clear();
+    QVERIFY(store->hashForUrl(QUrl("https://mirror.icons.test/")).isEmpty());
+    QVERIFY(!QFile::exists(storePath + shared + ".png"));
 }
 
 void BookmarkTest::cleanupTestCase()
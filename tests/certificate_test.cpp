@@ -1,7 +1,12 @@
 #include <QtTest>
 #include "certificatemanager.h"
+#include "certificateindex.h"
+#include "certificatestore.h"
+#include "revocationcache.h"
 #include <QSslCertificate>
 #include <QSslKey>
+#include <QTcpServer>
+#include <QTcpSocket>
 
 class CertificateTest : public QObject
 {
@@ -18,6 +23,12 @@ private slots:
     void testCertificateChain();
     void testCertificateInfo();
     void testErrorHandling();
+    void testIssuerIndex();
+    void testVerdictCache();
+    void testLazyStore();
+    void testExpiryScheduler();
+    void testBulkImport();
+    void testRevocation();
     void cleanupTestCase();
 
 private:
@@ -182,6 +193,311 @@ void CertificateTest::testErrorHandling()
     QVERIFY(!certManager->getLastError().isEmpty());
 }
 
+void CertificateTest::testIssuerIndex()
+{
+    auto load = [](const QString &name) {
+        const QList<QSslCertificate> certs = QSslCertificate::fromPath(QFINDTESTDATA("certs/" + name));
+        return certs.isEmpty() ? QSslCertificate() : certs.first();
+    };
+    const QSslCertificate root = load("chain_root.pem");
+    const QSslCertificate twin = load("chain_twin.pem");
+    const QSslCertificate intermediate = load("chain_intermediate.pem");
+    const QSslCertificate leaf = load("chain_leaf.pem");
+    QVERIFY(!root.isNull() && !twin.isNull() && !intermediate.isNull() && !leaf.isNull());
+    
+    // Отображаемые имена корней совпадают, ключи - нет
+    QCOMPARE(twin.subjectDisplayName(), root.subjectDisplayName());
+    
+    CertificateIndex index;
+    index.insert(twin);
+    index.insert(root);
+    index.insert(intermediate);
+    QCOMPARE(index.size(), 3);
+    
+    // AKI промежуточного указывает на ключ настоящего корня
+    const CertificateKeys keys = CertificateKeys::fromCertificate(intermediate);
+    QVERIFY(keys.isCa);
+    QCOMPARE(index.findIssuers(keys), QList<QSslCertificate>{root});
+    QVERIFY(CertificateIndex::isIssuedBy(intermediate, root));
+    QVERIFY(!CertificateIndex::isIssuedBy(intermediate, twin));
+    
+    const CertificateKeys leafKeys = CertificateKeys::fromCertificate(leaf);
+    QVERIFY(!leafKeys.isCa);
+    QCOMPARE(index.findIssuers(leafKeys), QList<QSslCertificate>{intermediate});
+    QVERIFY(CertificateIndex::isIssuedBy(leaf, intermediate));
+    
+    index.remove(intermediate);
+    QVERIFY(index.findIssuers(leafKeys).isEmpty());
+}
+
+void CertificateTest::testVerdictCache()
+{
+    const QString rootPath = QFINDTESTDATA("certs/chain_root.pem");
+    const QSslCertificate root = QSslCertificate::fromPath(rootPath).first();
+    const QSslCertificate intermediate = QSslCertificate::fromPath(QFINDTESTDATA("certs/chain_intermediate.pem")).first();
+    const QSslCertificate leaf = QSslCertificate::fromPath(QFINDTESTDATA("certs/chain_leaf.pem")).first();
+    const QString fingerprint = QString(root.digest(QCryptographicHash::Sha256).toHex());
+    
+    CertificateManager manager;
+    manager.removeCertificate(fingerprint);
+    QVERIFY(manager.importCertificate(rootPath, "Test Root"));
+    
+    // Корень ещё не доверенный - цепочка не строится; результат закэширован
+    const QList<QSslCertificate> chain{leaf, intermediate};
+    QVERIFY(!manager.verifyChain(chain));
+    QVERIFY(!manager.verifyChain(chain));
+    
+    // Изменение доверия сбрасывает кэш
+    QVERIFY(manager.trustCertificate(fingerprint));
+    QVERIFY(manager.verifyChain(chain));
+    QVERIFY(!manager.isDomainTrusted("example.test", root));
+    QVERIFY(manager.addTrustedDomain(fingerprint, "example.test"));
+    QVERIFY(manager.isDomainTrusted("EXAMPLE.test", root));
+    QVERIFY(manager.removeTrustedDomain(fingerprint, "example.test"));
+    QVERIFY(!manager.isDomainTrusted("example.test", root));
+    
+    QVERIFY(manager.removeCertificate(fingerprint));
+    QVERIFY(!manager.verifyChain(chain));
+}
+
+void CertificateTest::testLazyStore()
+{
+    const QSslCertificate root = QSslCertificate::fromPath(QFINDTESTDATA("certs/chain_root.pem")).first();
+    const QSslCertificate leaf = QSslCertificate::fromPath(QFINDTESTDATA("certs/chain_leaf.pem")).first();
+    const QString rootFingerprint = QString(root.digest(QCryptographicHash::Sha256).toHex());
+    const QString leafFingerprint = QString(leaf.digest(QCryptographicHash::Sha256).toHex());
+    
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    
+    QHash<QString, CertificateInfo> certificates;
+    CertificateStore store;
+    QVERIFY(!store.open(dir.path(), &certificates));
+    
+    CertificateInfo info;
+    info.certificate = root;
+    info.nickname = "Test Root";
+    info.trusted = true;
+    info.autoTrust = false;
+    info.metadata.insert("note", 42);
+    certificates.insert(rootFingerprint, info);
+    QVERIFY(store.save(certificates, {}));
+    
+    // Повторные добавления и удаления копят мусор до уплотнения
+    for (int i = 0; i < 200; ++i) {
+        CertificateInfo leafInfo = info;
+        leafInfo.certificate = leaf;
+        leafInfo.trusted = false;
+        certificates.insert(leafFingerprint, leafInfo);
+        QVERIFY(store.save(certificates, {}));
+        certificates.remove(leafFingerprint);
+        QVERIFY(store.save(certificates, {}));
+    }
+    
+    // После открытия доступен только индекс, сертификат читается по запросу
+    QHash<QString, CertificateInfo> loaded;
+    CertificateStore reopened;
+    QVERIFY(reopened.open(dir.path(), &loaded));
+    QCOMPARE(loaded.size(), 1);
+    QVERIFY(loaded[rootFingerprint].certificate.isNull());
+    QVERIFY(loaded[rootFingerprint].trusted);
+    QCOMPARE(loaded[rootFingerprint].nickname, QString("Test Root"));
+    QCOMPARE(loaded[rootFingerprint].metadata.value("note").toInt(), 42);
+    QCOMPARE(reopened.record(rootFingerprint)->expiryDate, root.expiryDate());
+    QVERIFY(reopened.record(rootFingerprint)->keys.isCa);
+    QCOMPARE(reopened.certificate(rootFingerprint), root);
+    
+    const QStringList blobs = QDir(dir.path()).entryList({"certificates.*.der"}, QDir::Files);
+    QCOMPARE(blobs.size(), qsizetype(1));
+    QVERIFY(blobs.first() != "certificates.0.der");
+}
+
+void CertificateTest::testExpiryScheduler()
+{
+    const QString rootPath = QFINDTESTDATA("certs/chain_root.pem");
+    const QSslCertificate root = QSslCertificate::fromPath(rootPath).first();
+    const QString fingerprint = QString(root.digest(QCryptographicHash::Sha256).toHex());
+    
+    CertificateManager manager;
+    manager.removeCertificate(fingerprint);
+    QVERIFY(manager.importCertificate(rootPath));
+    
+    // Срок предупреждения ещё не наступил - таймер не срабатывает
+    QSignalSpy spy(&manager, &CertificateManager::certificateExpiring);
+    QTest::qWait(50);
+    auto warned = [&spy, &fingerprint]() {
+        for (const QList<QVariant> &arguments : std::as_const(spy)) {
+            if (arguments.first().toString() == fingerprint) {
+                return true;
+            }
+        }
+        return false;
+    };
+    QVERIFY(!warned());
+    
+    // Расширение периода пересчитывает сроки, предупреждение приходит сразу
+    const int daysLeft = QDateTime::currentDateTime().daysTo(root.expiryDate());
+    manager.setExpiryWarningPeriod(daysLeft + 1);
+    QTRY_VERIFY(warned());
+    
+    // Удалённый сертификат больше не отслеживается
+    spy.clear();
+    QVERIFY(manager.removeCertificate(fingerprint));
+    manager.setExpiryWarningPeriod(daysLeft + 2);
+    QTest::qWait(50);
+    QVERIFY(!warned());
+}
+
+void CertificateTest::testBulkImport()
+{
+    QList<QSslCertificate> certificates;
+    for (const QString &name : {"chain_root.pem", "chain_intermediate.pem", "chain_leaf.pem"}) {
+        certificates += QSslCertificate::fromPath(QFINDTESTDATA(QString("certs/") + name));
+    }
+    QCOMPARE(certificates.size(), qsizetype(3));
+    
+    // Связка из двух сертификатов, отдельный файл в подкаталоге и мусор
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile bundle(dir.filePath("bundle.pem"));
+    QVERIFY(bundle.open(QIODevice::WriteOnly));
+    bundle.write(certificates[0].toPem() + certificates[1].toPem());
+    bundle.close();
+    QDir(dir.path()).mkdir("leaf");
+    QFile leaf(dir.filePath("leaf/leaf.der"));
+    QVERIFY(leaf.open(QIODevice::WriteOnly));
+    leaf.write(certificates[2].toDer());
+    leaf.close();
+    QFile broken(dir.filePath("broken.pem"));
+    QVERIFY(broken.open(QIODevice::WriteOnly));
+    broken.write("not a certificate");
+    broken.close();
+    
+    CertificateManager manager;
+    for (const QSslCertificate &certificate : std::as_const(certificates)) {
+        manager.removeCertificate(QString(certificate.digest(QCryptographicHash::Sha256).toHex()));
+    }
+    
+    QSignalSpy finished(&manager, &CertificateManager::importFinished);
+    QSignalSpy imported(&manager, &CertificateManager::certificateImported);
+    QVERIFY(manager.importCertificates({dir.path()}));
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.first().at(0).toInt(), 3);
+    QCOMPARE(finished.first().at(1).toInt(), 1);
+    QCOMPARE(imported.count(), 3);
+    
+    // Повторный импорт ничего не добавляет
+    QVERIFY(manager.importCertificates({dir.path()}));
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.last().at(0).toInt(), 0);
+    
+    for (const QSslCertificate &certificate : std::as_const(certificates)) {
+        QVERIFY(manager.removeCertificate(QString(certificate.digest(QCryptographicHash::Sha256).toHex())));
+    }
+}
+
+void CertificateTest::testRevocation()
+{
+    auto load = [](const QString &name) {
+        return QSslCertificate::fromPath(QFINDTESTDATA("certs/" + name)).first();
+    };
+    auto read = [](const QString &name) {
+        QFile file(QFINDTESTDATA("certs/" + name));
+        return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+    };
+    const QSslCertificate root = load("chain_root.pem");
+    const QSslCertificate intermediate = load("chain_intermediate.pem");
+    const QSslCertificate leaf = load("chain_leaf.pem");
+    const QSslCertificate revoked = load("chain_revoked.pem");
+    const QByteArray crl = read("chain_intermediate.crl");
+    const QByteArray ocsp = read("chain_leaf.ocsp");
+    QVERIFY(!crl.isEmpty());
+    QVERIFY(!ocsp.isEmpty());
+    const CertificateKeys leafKeys = CertificateKeys::fromCertificate(leaf);
+    const CertificateKeys revokedKeys = CertificateKeys::fromCertificate(revoked);
+    
+    // CRL принимается только с подписью издателя
+    RevocationCache cache;
+    QCOMPARE(cache.status(revokedKeys), RevocationCache::Unknown);
+    QVERIFY(!cache.addCrl(crl, root));
+    QVERIFY(cache.addCrl(crl, intermediate));
+    QCOMPARE(cache.status(revokedKeys), RevocationCache::Revoked);
+    QCOMPARE(cache.status(leafKeys), RevocationCache::Good);
+    QCOMPARE(cache.status(CertificateKeys::fromCertificate(intermediate)), RevocationCache::Unknown);
+    
+    // Ответ OCSP из файла и от заглушки ответчика
+    cache.clear();
+    QVERIFY(!cache.addOcspResponse(ocsp, revoked, intermediate));
+    QVERIFY(!cache.addOcspResponse(ocsp, leaf, root));
+    QVERIFY(cache.addOcspResponse(ocsp, leaf, intermediate));
+    QCOMPARE(cache.status(leafKeys), RevocationCache::Good);
+    
+    // Делегированный ответчик выпущен промежуточным CA, корня в кэше нет
+    const QSslCertificate delegatedIssuer = load("delegated_intermediate.pem");
+    const QSslCertificate delegatedLeaf = load("delegated_leaf.pem");
+    const QByteArray delegatedOcsp = read("delegated_leaf.ocsp");
+    QVERIFY(!delegatedOcsp.isEmpty());
+    QVERIFY(!cache.addOcspResponse(delegatedOcsp, delegatedLeaf, intermediate));
+    QVERIFY(cache.addOcspResponse(delegatedOcsp, delegatedLeaf, delegatedIssuer));
+    QCOMPARE(cache.status(CertificateKeys::fromCertificate(delegatedLeaf)), RevocationCache::Good);
+    
+    cache.clear();
+    QTcpServer responder;
+    QVERIFY(responder.listen(QHostAddress::LocalHost));
+    QByteArray request;
+    connect(&responder, &QTcpServer::newConnection, this, [&]() {
+        QTcpSocket *socket = responder.nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, socket, [&, socket]() {
+            request += socket->readAll();
+            const int headerEnd = request.indexOf("\r\n\r\n");
+            static const QRegularExpression contentLength("content-length:\\s*(\\d+)",
+                                                          QRegularExpression::CaseInsensitiveOption);
+            const QRegularExpressionMatch length = contentLength.match(QString::fromLatin1(request));
+            if (headerEnd < 0 || !length.hasMatch() ||
+                request.size() < headerEnd + 4 + length.captured(1).toInt()) {
+                return;
+            }
+            socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/ocsp-response\r\n"
+                          "Content-Length: " + QByteArray::number(ocsp.size()) +
+                          "\r\nConnection: close\r\n\r\n" + ocsp);
+            socket->disconnectFromHost();
+        });
+    });
+    cache.setResponderUrl(QUrl(QString("http://127.0.0.1:%1/").arg(responder.serverPort())));
+    QSignalSpy updated(&cache, &RevocationCache::updated);
+    cache.refresh(leaf, intermediate);
+    QVERIFY(updated.wait(10000));
+    QVERIFY(request.startsWith("POST "));
+    QVERIFY(request.contains("application/ocsp-request"));
+    QCOMPARE(cache.status(leafKeys), RevocationCache::Good);
+    
+    // Повторный запрос сдерживается
+    request.clear();
+    cache.refresh(leaf, intermediate);
+    QTest::qWait(100);
+    QVERIFY(request.isEmpty());
+    
+    // Проверка цепочки в менеджере видит импортированный CRL
+    CertificateManager manager;
+    const QString rootFingerprint = QString(root.digest(QCryptographicHash::Sha256).toHex());
+    const QString intermediateFingerprint = QString(intermediate.digest(QCryptographicHash::Sha256).toHex());
+    manager.removeCertificate(rootFingerprint);
+    manager.removeCertificate(intermediateFingerprint);
+    QVERIFY(manager.importCertificate(QFINDTESTDATA("certs/chain_root.pem"), "Test Root"));
+    QVERIFY(manager.importCertificate(QFINDTESTDATA("certs/chain_intermediate.pem"), "Test Intermediate"));
+    QVERIFY(manager.trustCertificate(rootFingerprint));
+    
+    QVERIFY(manager.verifyChain({revoked, intermediate}));
+    QVERIFY(manager.importRevocationList(QFINDTESTDATA("certs/chain_intermediate.crl")));
+    QVERIFY(!manager.verifyChain({revoked, intermediate}));
+    QVERIFY(manager.verifyChain({leaf, intermediate}));
+    QVERIFY(manager.addStapledOcspResponse(ocsp, leaf));
+    QVERIFY(manager.verifyChain({leaf, intermediate}));
+    
+    QVERIFY(manager.removeCertificate(intermediateFingerprint));
+    QVERIFY(manager.removeCertificate(rootFingerprint));
+}
+
 void CertificateTest::cleanupTestCase()
 {
     // Удаляем тестовые файлы
@@ -14,6 +14,7 @@ private slots:
     void testMostVisited();
     void testRecentlyVisited();
     void testMetadata();
+    void testRelatedPages();
     void cleanupTestCase();
 
 private:
@@ -110,6 +111,38 @@ void HistoryTest::testMetadata()
     QCOMPARE(history->getMetadata(id, "test_key").toString(), "test_value");
 }
 
+void HistoryTest::testRelatedPages()
+{
+    history->clearHistory();
+    
+    // Страницы одной сессии должны оказаться связанными
+    history->addVisit("https://example.com/a", "Page A");
+    history->addVisit("https://example.com/b", "Page B");
+    history->addVisit("https://other.com", "Other");
+    
+    auto related = history->getRelatedPages("https://example.com/a");
+    QVERIFY(!related.isEmpty());
+    QCOMPARE(related[0].url, QString("https://example.com/b"));
+    
+    // Удаление страницы удаляет её связи в обоих направлениях
+    history->deleteUrl("https://example.com/b");
+    related = history->getRelatedPages("https://example.com/a");
+    for (const HistoryItem &item : std::as_const(related)) {
+        QVERIFY(item.url != QString("https://example.com/b"));
+    }
+    QVERIFY(history->getRelatedPages("https://example.com/b").isEmpty());
+    
+    // Удаление интервала времени убирает и связи, замеченные в нём
+    history->addVisit("https://example.com/c", "Page C");
+    history->addVisit("https://example.com/d", "Page D");
+    QVERIFY(!history->getRelatedPages("https://example.com/c").isEmpty());
+    const QDateTime now = QDateTime::currentDateTime();
+    history->deleteTimeRange(now.addSecs(-60), now.addSecs(60));
+    QVERIFY(history->getRelatedPages("https://example.com/a").isEmpty());
+    QVERIFY(history->getRelatedPages("https://example.com/c").isEmpty());
+    QVERIFY(history->getRecentlyVisited(10).isEmpty());
+}
+
 void HistoryTest::cleanupTestCase()
 {
     history->clearHistory();
@@ -0,0 +1,489 @@
+#include <QtTest>
+#include "passwordvault.h"
+#include "publicsuffix.h"
+#include "passwordmanager.h"
+#include "passwordaudit.h"
+#include "breachcorpus.h"
+#include "csvreader.h"
+
+class PasswordTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testRoundTrip();
+    void testWrongMasterPassword();
+    void testTamperedCiphertext();
+    void testAssociatedData();
+    void testUniqueNonces();
+    void testLock();
+    void testRegistrableDomain_data();
+    void testRegistrableDomain();
+    void testUnlistedSuffix();
+    void testJournalReplay();
+    void testJournalTornTail();
+    void testLegacyMigration();
+    void testClassify_data();
+    void testClassify();
+    void testAudit();
+    void testBreachCorpus();
+    void testCsvReader();
+    void testCsvImport();
+    void benchmarkUnlock();
+    void benchmarkDecrypt();
+
+private:
+    PasswordVault vault;
+    const QString masterPassword = "Master#Passw0rd";
+    const QByteArray testPassword = "S3cret!pass";
+    const QByteArray testEntry = "https://example.com\nuser";
+    
+    // Для функциональных тестов достаточно быстрого KDF
+    static const int TEST_ITERATIONS = 1000;
+};
+
+void PasswordTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    
+    QVERIFY(vault.create(masterPassword, TEST_ITERATIONS));
+    QVERIFY(vault.isUnlocked());
+    QCOMPARE(vault.salt().size(), qsizetype(PasswordVault::SALT_SIZE));
+}
+
+void PasswordTest::testRoundTrip()
+{
+    const QByteArray sealed = vault.encrypt(testPassword, testEntry);
+    QCOMPARE(sealed.size(), PasswordVault::NONCE_SIZE + testPassword.size() + PasswordVault::TAG_SIZE);
+    QVERIFY(!sealed.contains(testPassword));
+    
+    bool ok = false;
+    SecureBuffer plain = vault.decrypt(sealed, testEntry, &ok);
+    QVERIFY(ok);
+    QCOMPARE(plain.toString(), QString::fromUtf8(testPassword));
+}
+
+void PasswordTest::testWrongMasterPassword()
+{
+    PasswordVault other;
+    other.setParameters(vault.salt(), vault.iterations(), vault.checkValue());
+    QVERIFY(!other.unlock("wrong password"));
+    QVERIFY(!other.isUnlocked());
+    QVERIFY(other.unlock(masterPassword));
+    
+    QVERIFY(vault.checkPassword(masterPassword));
+    QVERIFY(!vault.checkPassword("wrong password"));
+}
+
+void PasswordTest::testTamperedCiphertext()
+{
+    QByteArray sealed = vault.encrypt(testPassword, testEntry);
+    
+    // Любой изменённый байт - nonce, шифротекст или тег - отвергается
+    for (int i = 0; i < sealed.size(); ++i) {
+        QByteArray tampered = sealed;
+        tampered[i] = tampered[i] ^ 0x01;
+        bool ok = true;
+        SecureBuffer plain = vault.decrypt(tampered, testEntry, &ok);
+        QVERIFY(!ok);
+        QVERIFY(plain.isEmpty());
+    }
+    
+    bool ok = true;
+    vault.decrypt(sealed.left(PasswordVault::NONCE_SIZE), testEntry, &ok);
+    QVERIFY(!ok);
+}
+
+void PasswordTest::testAssociatedData()
+{
+    // Шифротекст нельзя перенести в запись другого сайта
+    const QByteArray sealed = vault.encrypt(testPassword, testEntry);
+    bool ok = true;
+    vault.decrypt(sealed, "https://evil.example\nuser", &ok);
+    QVERIFY(!ok);
+}
+
+void PasswordTest::testUniqueNonces()
+{
+    QSet<QByteArray> nonces;
+    for (int i = 0; i < 1000; ++i) {
+        nonces.insert(vault.encrypt(testPassword, testEntry).left(PasswordVault::NONCE_SIZE));
+    }
+    QCOMPARE(nonces.size(), qsizetype(1000));
+}
+
+void PasswordTest::testLock()
+{
+    const QByteArray sealed = vault.encrypt(testPassword, testEntry);
+    vault.lock();
+    QVERIFY(!vault.isUnlocked());
+    QVERIFY(vault.encrypt(testPassword, testEntry).isEmpty());
+    
+    bool ok = true;
+    vault.decrypt(sealed, testEntry, &ok);
+    QVERIFY(!ok);
+    
+    QVERIFY(vault.unlock(masterPassword));
+    vault.decrypt(sealed, testEntry, &ok);
+    QVERIFY(ok);
+}
+
+void PasswordTest::testRegistrableDomain_data()
+{
+    QTest::addColumn<QString>("host");
+    QTest::addColumn<QString>("site");
+    QTest::addColumn<bool>("listed");
+    
+    QTest::newRow("simple") << "www.example.com" << "example.com" << true;
+    QTest::newRow("two-level suffix") << "mail.example.co.uk" << "example.co.uk" << true;
+    QTest::newRow("second-level ccTLD") << "bank.co.il" << "bank.co.il" << true;
+    QTest::newRow("suffix itself") << "co.uk" << "co.uk" << true;
+    QTest::newRow("private suffix") << "user.github.io" << "user.github.io" << true;
+    QTest::newRow("wildcard") << "a.b.example.ck" << "b.example.ck" << true;
+    QTest::newRow("exception") << "www.ck" << "www.ck" << true;
+    QTest::newRow("unknown tld") << "a.b.example.zz" << "example.zz" << false;
+    QTest::newRow("ip address") << "192.168.0.1" << "192.168.0.1" << false;
+    QTest::newRow("trailing dot") << "Login.Example.COM." << "example.com" << true;
+}
+
+void PasswordTest::testRegistrableDomain()
+{
+    QFETCH(QString, host);
+    QFETCH(QString, site);
+    QFETCH(bool, listed);
+    
+    const QString listFile = QFINDTESTDATA("../resources/config/public_suffix_list.dat");
+    QVERIFY(!listFile.isEmpty());
+    PublicSuffixList list(listFile);
+    bool matched = !listed;
+    QCOMPARE(list.registrableDomain(host, &matched), site);
+    QCOMPARE(matched, listed);
+}
+
+void PasswordTest::testUnlistedSuffix()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataPath + "/passwords.dat");
+    QFile::remove(dataPath + "/passwords.journal");
+    
+    PasswordManager manager;
+    QVERIFY(manager.setMasterPassword(masterPassword));
+    QVERIFY(manager.savePassword("https://bank.co.il/login", "client", "S3cret!pass"));
+    QVERIFY(manager.savePassword("https://login.example.zz/", "user", "S3cret!pass"));
+    
+    // Соседние регистрируемые домены не делят пароли
+    QVERIFY(manager.findUsernames("https://evil.co.il/").isEmpty());
+    
+    // Суффикс вне списка: только точный источник
+    QVERIFY(manager.findUsernames("https://other.example.zz/").isEmpty());
+    QVERIFY(manager.findUsernames("https://example.zz/").isEmpty());
+    QCOMPARE(manager.findUsernames("https://login.example.zz/form"), QStringList{"user"});
+    QCOMPARE(manager.findPassword("https://login.example.zz/", "user"), QString("S3cret!pass"));
+}
+
+void PasswordTest::testJournalReplay()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataPath + "/passwords.dat");
+    QFile::remove(dataPath + "/passwords.journal");
+    
+    PasswordManager *writer = new PasswordManager(this);
+    QVERIFY(writer->setMasterPassword(masterPassword));
+    QVERIFY(writer->savePassword("https://example.com/login", "user", "S3cret!pass"));
+    
+    // Изменение дописано в журнал, полный снимок не переписывался
+    QVERIFY(QFile::exists(dataPath + "/passwords.journal"));
+    
+    // Второй экземпляр до закрытия первого - как после аварийного завершения
+    PasswordManager reader;
+    QCOMPARE(reader.findUsernames("https://example.com/other"), QStringList{"user"});
+    QVERIFY(reader.unlock(masterPassword));
+    QCOMPARE(reader.findPassword("https://example.com/", "user"), QString("S3cret!pass"));
+    
+    // Закрытие пишет снимок и удаляет журнал
+    delete writer;
+    QVERIFY(QFile::exists(dataPath + "/passwords.dat"));
+    QVERIFY(!QFile::exists(dataPath + "/passwords.journal"));
+}
+
+void PasswordTest::testJournalTornTail()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    const QString journalPath = dataPath + "/passwords.journal";
+    QFile::remove(dataPath + "/passwords.dat");
+    QFile::remove(journalPath);
+    
+    // Копия журнала до закрытия записывающего экземпляра - как после сбоя
+    QByteArray journalData;
+    {
+        PasswordManager writer;
+        QVERIFY(writer.setMasterPassword(masterPassword));
+        QVERIFY(writer.savePassword("https://example.com/login", "first", "S3cret!pass"));
+        QFile journal(journalPath);
+        QVERIFY(journal.open(QIODevice::ReadOnly));
+        journalData = journal.readAll();
+    }
+    QVERIFY(!journalData.isEmpty());
+    
+    QFile journal(journalPath);
+    QVERIFY(journal.open(QIODevice::WriteOnly));
+    journal.write(journalData);
+    journal.write("{\"op\":\"put\",\"entry\":{\"url\":\"https://exa");
+    journal.close();
+    
+    {
+        PasswordManager manager;
+        QVERIFY(manager.unlock(masterPassword));
+        QCOMPARE(QFileInfo(journalPath).size(), qint64(journalData.size()));
+        QVERIFY(manager.savePassword("https://example.com/login", "second", "S3cret!pass"));
+        
+        // Новая запись начинается с новой строки и читается другим экземпляром
+        PasswordManager reader;
+        QVERIFY(reader.unlock(masterPassword));
+        QCOMPARE(reader.findPassword("https://example.com/", "first"), QString("S3cret!pass"));
+        QCOMPARE(reader.findPassword("https://example.com/", "second"), QString("S3cret!pass"));
+    }
+}
+
+void PasswordTest::testLegacyMigration()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataPath + "/passwords.journal");
+    
+    // Данные старой версии: XOR с ключом из настроек
+    QSettings settings(QSettings::IniFormat, QSettings::UserScope, "Browser", "Passwords");
+    settings.clear();
+    settings.setValue("encryptionKey", "legacy-key");
+    settings.sync();
+    
+    QByteArray data = QByteArray("S3cret!pass");
+    const QByteArray key = "legacy-key";
+    for (int i = 0; i < data.size(); ++i) {
+        data[i] = data[i] ^ key[i % key.size()];
+    }
+    QFile file(dataPath + "/passwords.dat");
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("{\"https://legacy.test\": [{\"url\": \"https://legacy.test/login\","
+               " \"username\": \"old\", \"password\": \"" + data.toBase64() + "\"}]}");
+    file.close();
+    
+    {
+        PasswordManager manager;
+        QVERIFY(manager.setMasterPassword(masterPassword));
+        QCOMPARE(manager.findPassword("https://legacy.test/", "old"), QString("S3cret!pass"));
+    }
+    
+    // Ключ старого формата удалён после записи нового, запись читается
+    QSettings reloaded(QSettings::IniFormat, QSettings::UserScope, "Browser", "Passwords");
+    QVERIFY(!reloaded.contains("encryptionKey"));
+    PasswordManager manager;
+    QVERIFY(manager.unlock(masterPassword));
+    QCOMPARE(manager.findPassword("https://legacy.test/", "old"), QString("S3cret!pass"));
+    
+    // Ключ выводится из UTF-8 пароля так же, как раньше
+    const QByteArray salt(PasswordVault::SALT_SIZE, 's');
+    SecureBuffer cyrillic = PasswordVault::deriveKey(QString::fromUtf8("Пароль1!"), salt, 10);
+    QCOMPARE(cyrillic.size(), int(PasswordVault::KEY_SIZE));
+    SecureBuffer again = PasswordVault::deriveKey(QString::fromUtf8("Пароль1!"), salt, 10);
+    QCOMPARE(QByteArray(cyrillic.constData(), cyrillic.size()),
+             QByteArray(again.constData(), again.size()));
+    QVERIFY(PasswordVault::deriveKey(QString(), salt, 10).size() == PasswordVault::KEY_SIZE);
+}
+
+void PasswordTest::testClassify_data()
+{
+    QTest::addColumn<QString>("password");
+    QTest::addColumn<int>("flags");
+    QTest::addColumn<int>("length");
+    
+    QTest::newRow("strong") << "S3cret!pass" << 0 << 11;
+    QTest::newRow("short") << "S3c!t" << int(PasswordAudit::TooShort) << 5;
+    QTest::newRow("lowercase") << "secretpassword" 
+        << int(PasswordAudit::NoUppercase | PasswordAudit::NoDigit | PasswordAudit::NoSpecial) << 14;
+    QTest::newRow("no special") << "Secret12pass" << int(PasswordAudit::NoSpecial) << 12;
+    QTest::newRow("cyrillic") << QString::fromUtf8("Пароль1!") 
+        << int(PasswordAudit::NoLowercase | PasswordAudit::NoUppercase) << 8;
+}
+
+void PasswordTest::testClassify()
+{
+    QFETCH(QString, password);
+    QFETCH(int, flags);
+    QFETCH(int, length);
+    
+    int counted = 0;
+    QCOMPARE(PasswordAudit::classify(password, 8, &counted), flags);
+    QCOMPARE(counted, length);
+}
+
+void PasswordTest::testAudit()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataPath + "/passwords.dat");
+    QFile::remove(dataPath + "/passwords.journal");
+    
+    PasswordManager manager;
+    QVERIFY(manager.setMasterPassword(masterPassword));
+    QVERIFY(manager.savePassword("https://example.com/login", "user", "S3cret!pass"));
+    QVERIFY(manager.savePassword("https://example.org/login", "user", "S3cret!pass"));
+    QVERIFY(manager.savePassword("https://example.net/login", "user", "0ther#Secret"));
+    
+    QSignalSpy spy(&manager, &PasswordManager::auditCompleted);
+    QVERIFY(spy.wait(10000));
+    QCOMPARE(manager.getReusedPasswords().size(), qsizetype(2));
+    QVERIFY(manager.getWeakPasswords().isEmpty());
+    
+    // Смена пароля сбрасывает результат только для своей записи
+    QVERIFY(manager.updatePassword("https://example.org/login", "user", "N3w!Secret"));
+    QVERIFY(manager.getReusedPasswords().isEmpty());
+    QVERIFY(spy.wait(10000));
+    QVERIFY(manager.getReusedPasswords().isEmpty());
+    
+    manager.clearPasswords();
+}
+
+void PasswordTest::testBreachCorpus()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    
+    // Диапазоны в формате k-anonymity: SHA-1("password") начинается с 5BAA6
+    QDir(dir.path()).mkdir("ranges");
+    QFile first(dir.filePath("ranges/00000.txt"));
+    QVERIFY(first.open(QIODevice::WriteOnly));
+    first.write("0005AD76BD555C1D6D771DE417A4B87E4B4:10\r\n"
+                "000A8DAE4228F821FB418F59826079BF368:4\r\n");
+    first.close();
+    QFile second(dir.filePath("ranges/5baa6.txt"));
+    QVERIFY(second.open(QIODevice::WriteOnly));
+    second.write("0018A45C4D1DEF81644B54AB7F969B88D65:1\r\n"
+                 "1E4C9B93F3F0682250B6CF8331B7EE68FD8:9545824\r\n");
+    second.close();
+    
+    const QString corpusFile = dir.filePath("breach.bin");
+    QVERIFY(BreachCorpus::convert(dir.filePath("ranges"), corpusFile));
+    
+    BreachCorpus corpus;
+    QVERIFY(corpus.open(corpusFile));
+    QCOMPARE(corpus.size(), quint64(4));
+    QCOMPARE(corpus.lookup("password", 8), quint32(9545824));
+    QCOMPARE(corpus.lookup(testPassword.constData(), testPassword.size()), quint32(0));
+    
+    // Большой список целиком: поиск должен находить каждую запись
+    QList<QByteArray> hashes;
+    for (int i = 0; i < 5000; ++i) {
+        hashes.append(QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha1));
+    }
+    std::sort(hashes.begin(), hashes.end());
+    QFile full(dir.filePath("full.txt"));
+    QVERIFY(full.open(QIODevice::WriteOnly));
+    for (int i = 0; i < hashes.size(); ++i) {
+        full.write(hashes[i].toHex().toUpper() + ':' + QByteArray::number(i + 1) + '\n');
+    }
+    full.close();
+    
+    corpus.close();
+    QVERIFY(BreachCorpus::convert(full.fileName(), corpusFile));
+    QVERIFY(corpus.open(corpusFile));
+    for (int i = 0; i < hashes.size(); ++i) {
+        QCOMPARE(corpus.lookupHash(hashes[i]), quint32(i + 1));
+    }
+    QCOMPARE(corpus.lookup("not in corpus", 13), quint32(0));
+    
+    // Неотсортированный источник не принимается
+    QVERIFY(full.open(QIODevice::Append));
+    full.write(hashes.first().toHex() + ":1\n");
+    full.close();
+    QVERIFY(!BreachCorpus::convert(full.fileName(), dir.filePath("broken.bin")));
+}
+
+void PasswordTest::testCsvReader()
+{
+    QByteArray data = "a,\"b,c\",\"d \"\"q\"\"\"\r\n"
+                      "\"multi\nline\",,e\n"
+                      "last";
+    QBuffer buffer(&data);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    
+    CsvReader reader(&buffer);
+    QStringList fields;
+    QVERIFY(reader.readRecord(fields));
+    QCOMPARE(fields, (QStringList{"a", "b,c", "d \"q\""}));
+    QVERIFY(reader.readRecord(fields));
+    QCOMPARE(fields, (QStringList{"multi\nline", "", "e"}));
+    QVERIFY(reader.readRecord(fields));
+    QCOMPARE(fields, QStringList{"last"});
+    QVERIFY(!reader.readRecord(fields));
+    QVERIFY(!reader.hasError());
+    
+    // Незакрытая кавычка - ошибка, а не молча обрезанное поле
+    QByteArray broken = "a,\"unterminated\n";
+    QBuffer brokenBuffer(&broken);
+    QVERIFY(brokenBuffer.open(QIODevice::ReadOnly));
+    CsvReader brokenReader(&brokenBuffer);
+    QVERIFY(!brokenReader.readRecord(fields));
+    QVERIFY(brokenReader.hasError());
+}
+
+void PasswordTest::testCsvImport()
+{
+    const QString dataPath = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QFile::remove(dataPath + "/passwords.dat");
+    QFile::remove(dataPath + "/passwords.journal");
+    
+    PasswordManager manager;
+    QVERIFY(manager.setMasterPassword(masterPassword));
+    QVERIFY(manager.savePassword("https://example.com/login", "user", "S3cret!pass"));
+    
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile csv(dir.filePath("logins.csv"));
+    QVERIFY(csv.open(QIODevice::WriteOnly));
+    csv.write("\"url\",\"username\",\"password\",\"httpRealm\",\"formActionOrigin\",\"guid\","
+              "\"timeCreated\",\"timeLastUsed\",\"timePasswordChanged\"\r\n"
+              "\"https://example.com\",\"user\",\"other\",,\"\",\"{1}\",\"1600000000000\",\"1600000000000\",\"1600000000000\"\r\n"
+              "\"https://example.org\",\"user\",\"p,a\"\"ss\",,\"\",\"{2}\",\"1600000000000\",\"1700000000000\",\"1600000000000\"\r\n"
+              "\"https://example.org\",\"user\",\"duplicate\",,\"\",\"{3}\",\"1600000000000\",\"1600000000000\",\"1600000000000\"\r\n");
+    csv.close();
+    
+    QSignalSpy spy(&manager, &PasswordManager::importCompleted);
+    QVERIFY(manager.importFromFirefox(csv.fileName()));
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.first().first().toInt(), 1);
+    
+    // Существующая запись не перезаписана, повтор в файле пропущен
+    QCOMPARE(manager.findPassword("https://example.com/", "user"), QString("S3cret!pass"));
+    QCOMPARE(manager.findPassword("https://example.org/", "user"), QString("p,a\"ss"));
+    QCOMPARE(manager.getPasswords("https://example.org/").first().lastUsed,
+             QDateTime::fromMSecsSinceEpoch(1700000000000));
+    
+    manager.clearPasswords();
+}
+
+void PasswordTest::benchmarkUnlock()
+{
+    // Задержка разблокировки с параметрами по умолчанию
+    PasswordVault defaultVault;
+    QVERIFY(defaultVault.create(masterPassword));
+    defaultVault.lock();
+    
+    QBENCHMARK {
+        defaultVault.unlock(masterPassword);
+    }
+    QVERIFY(defaultVault.isUnlocked());
+}
+
+void PasswordTest::benchmarkDecrypt()
+{
+    const QByteArray sealed = vault.encrypt(testPassword, testEntry);
+    bool ok = false;
+    
+    QBENCHMARK {
+        vault.decrypt(sealed, testEntry, &ok);
+    }
+    QVERIFY(ok);
+}
+
+QTEST_MAIN(PasswordTest)
+#include "password_test.moc"
\ No newline at end of file
@@ -1,7 +1,66 @@
 #include <QtTest>
 #include "syncmanager.h"
+#include "syncjournal.h"
+#include "merkletree.h"
+#include "syncuploader.h"
 #include <QNetworkAccessManager>
+#include <QTcpServer>
+#include <QTcpSocket>
 #include <QJsonDocument>
+#include <QJsonArray>
+#include <QStandardPaths>
+#include <QDir>
+
+// Заглушка сервера синхронизации: отвечает на запросы по очереди
+// заготовленными ответами и запоминает разобранные запросы. Выгрузки
+// (заголовок X-Sync-Chunk) приходят одним куском CBOR, сверка - JSON.
+class SyncStubServer
+{
+public:
+    SyncStubServer()
+    {
+        m_server.listen(QHostAddress::LocalHost);
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this]() {
+            QTcpSocket *socket = m_server.nextPendingConnection();
+            QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+                socket->setProperty("request", request);
+                static const QRegularExpression contentLength("content-length:\\s*(\\d+)",
+                                                              QRegularExpression::CaseInsensitiveOption);
+                const int headerEnd = request.indexOf("\r\n\r\n");
+                const QString headers = QString::fromLatin1(request.left(headerEnd));
+                const QRegularExpressionMatch length = contentLength.match(headers);
+                if (headerEnd < 0 || !length.hasMatch() ||
+                    request.size() < headerEnd + 4 + length.captured(1).toInt()) {
+                    return;
+                }
+                
+                const QByteArray body = request.mid(headerEnd + 4);
+                if (headers.contains("x-sync-chunk", Qt::CaseInsensitive)) {
+                    requests.append(SyncUploader::decode({body}));
+                } else {
+                    requests.append(QJsonDocument::fromJson(body).object());
+                }
+                const QJsonObject response = responses.isEmpty()
+                    ? QJsonObject{{"status", "error"}, {"error", "unexpected request"}}
+                    : responses.takeFirst();
+                const QByteArray reply = QJsonDocument(response).toJson(QJsonDocument::Compact);
+                socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                              "Content-Length: " + QByteArray::number(reply.size()) +
+                              "\r\nConnection: close\r\n\r\n" + reply);
+                socket->disconnectFromHost();
+            });
+        });
+    }
+    
+    QUrl url() const { return QUrl(QString("http://127.0.0.1:%1/sync").arg(m_server.serverPort())); }
+    
+    QList<QJsonObject> requests;
+    QList<QJsonObject> responses;
+
+private:
+    QTcpServer m_server;
+};
 
 class SyncTest : public QObject
 {
@@ -9,189 +68,499 @@ class SyncTest : public QObject
 
 private slots:
     void initTestCase();
-    void testAuthentication();
-    void testSyncOperations();
-    void testDataManagement();
-    void testConflictResolution();
-    void testOfflineMode();
-    void testDeviceManagement();
-    void testEncryption();
-    void testStatistics();
-    void testErrorHandling();
+    void testSettings();
+    void testChangeJournal();
+    void testServerExchange();
+    void testReconcile();
+    void testResumeOversizedUpload();
+    void testMerkleTree();
+    void testChunkedUpload();
     void cleanupTestCase();
 
 private:
     SyncManager *sync;
-    const QString testEmail = "test@example.com";
-    const QString testPassword = "testPassword123";
-    const QString testDeviceId = "test-device-001";
 };
 
 void SyncTest::initTestCase()
 {
+    QStandardPaths::setTestModeEnabled(true);
+    QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).removeRecursively();
     sync = new SyncManager(this);
 }
 
-void SyncTest::testAuthentication()
+void SyncTest::testSettings()
 {
-    // Тестируем вход
-    QVERIFY(sync->signIn(testEmail, testPassword));
-    QVERIFY(sync->isSignedIn());
+    SyncSettings settings = sync->getSyncSettings();
+    QVERIFY(settings.syncBookmarks);
+    settings.autoSync = false;
+    settings.syncHistory = false;
+    sync->setSyncSettings(settings);
+    QVERIFY(!sync->getSyncSettings().autoSync);
     
-    // Тестируем получение токена
-    QString token = sync->getAuthToken();
-    QVERIFY(!token.isEmpty());
+    // Правки отключённых типов в журнал не попадают
+    QVERIFY(!sync->recordChange("history", "visit", QJsonObject{{"url", "https://example.com"}}));
+    QVERIFY(!sync->recordChange("unknown", "x", QJsonObject()));
+    QCOMPARE(sync->getPendingChangesCount(), 0);
     
-    // Тестируем выход
-    sync->signOut();
-    QVERIFY(!sync->isSignedIn());
+    settings.syncHistory = true;
+    sync->setSyncSettings(settings);
+    QVERIFY(sync->getSyncSettings().syncHistory);
 }
 
-void SyncTest::testSyncOperations()
+void SyncTest::testChangeJournal()
 {
-    sync->signIn(testEmail, testPassword);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("sync.journal");
+    
+    QJsonObject first;
+    first["title"] = "First";
+    QJsonObject second;
+    second["title"] = "Second";
+    
+    SyncJournal journal;
+    QVERIFY(journal.open(path));
+    QCOMPARE(journal.recordChange("bookmarks", "a", first), quint64(1));
+    QCOMPARE(journal.recordChange("bookmarks", "b", first), quint64(2));
+    QCOMPARE(journal.recordChange("history", "a", first), quint64(3));
     
-    // Тестируем запуск синхронизации
-    QVERIFY(sync->startSync());
-    QVERIFY(sync->isSyncing());
+    // Повторная правка вытесняет неотправленную запись
+    QCOMPARE(journal.recordChange("bookmarks", "a", second), quint64(4));
+    QCOMPARE(journal.pendingCount(), 3);
+    QList<SyncChange> changes = journal.pendingChanges(10);
+    QCOMPARE(changes.size(), qsizetype(3));
+    QCOMPARE(changes[0].sequence, quint64(2));
+    QCOMPARE(changes[2].id, QString("a"));
+    QCOMPARE(changes[2].data["title"].toString(), QString("Second"));
+    QCOMPARE(journal.pendingChanges(2).size(), qsizetype(2));
     
-    // Тестируем остановку синхронизации
-    sync->stopSync();
-    QVERIFY(!sync->isSyncing());
+    // После подтверждения отправляется только новое
+    QVERIFY(journal.acknowledge(3));
+    QVERIFY(journal.recordRemoval("bookmarks", "b"));
+    QVERIFY(journal.setServerCursor("server-42"));
+    changes = journal.pendingChanges(10);
+    QCOMPARE(changes.size(), qsizetype(2));
+    QCOMPARE(changes[0].sequence, quint64(4));
+    QVERIFY(changes[1].deleted);
     
-    // Тестируем принудительную синхронизацию
-    QVERIFY(sync->forceSync());
+    // Состояние восстанавливается из файла
+    journal.close();
+    SyncJournal reopened;
+    QVERIFY(reopened.open(path));
+    QCOMPARE(reopened.acknowledgedCursor(), quint64(3));
+    QCOMPARE(reopened.lastSequence(), quint64(5));
+    QCOMPARE(reopened.serverCursor(), QString("server-42"));
+    QCOMPARE(reopened.pendingCount(), 2);
+    QVERIFY(reopened.acknowledge(5));
+    QCOMPARE(reopened.pendingCount(), 0);
+    QCOMPARE(reopened.recordChange("bookmarks", "c", first), quint64(6));
     
-    // Тестируем статус синхронизации
-    auto status = sync->getSyncStatus();
-    QVERIFY(status.contains("lastSync"));
-    QVERIFY(status.contains("itemCount"));
+    QVERIFY(reopened.reset());
+    QCOMPARE(reopened.pendingCount(), 0);
+    QVERIFY(reopened.serverCursor().isEmpty());
+    
+    // Обрывок последней строки отрезается, новые записи с ним не склеиваются
+    QCOMPARE(reopened.recordChange("bookmarks", "d", first), quint64(7));
+    reopened.close();
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::Append));
+        file.write("{\"seq\":\"8\",\"type\":\"book");
+    }
+    SyncJournal torn;
+    QVERIFY(torn.open(path));
+    QCOMPARE(torn.lastSequence(), quint64(7));
+    QCOMPARE(torn.pendingCount(), 1);
+    QCOMPARE(torn.recordChange("bookmarks", "e", second), quint64(8));
+    torn.close();
+    SyncJournal repaired;
+    QVERIFY(repaired.open(path));
+    QCOMPARE(repaired.lastSequence(), quint64(8));
+    QCOMPARE(repaired.pendingCount(), 2);
+    QCOMPARE(repaired.pendingChanges(10).last().data["title"].toString(), QString("Second"));
 }
 
-void SyncTest::testDataManagement()
+void SyncTest::testServerExchange()
 {
-    // Тестируем добавление элемента
-    QJsonObject data;
-    data["url"] = "https://example.com";
-    data["title"] = "Test Bookmark";
+    SyncStubServer server;
+    sync->setServerUrl(server.url());
     
-    qint64 itemId = sync->addItem(SyncItemType::Bookmark, data);
-    QVERIFY(itemId > 0);
+    QVERIFY(sync->recordChange("bookmarks", "a", QJsonObject{{"title", "A"}}));
+    QVERIFY(sync->recordChange("bookmarks", "b", QJsonObject{{"title", "B"}}));
+    QCOMPARE(sync->getPendingChangesCount(), 2);
     
-    // Тестируем обновление элемента
-    data["title"] = "Updated Title";
-    QVERIFY(sync->updateItem(itemId, data));
+    // Первый ответ подтверждает обе правки, присылает чужое изменение,
+    // новый курсор и просит продолжить обмен
+    QJsonObject remote;
+    remote["type"] = "bookmarks";
+    remote["id"] = "remote";
+    remote["data"] = QJsonObject{{"title", "Remote"}};
+    server.responses.append(QJsonObject{{"status", "success"}, {"ack", "2"}, {"cursor", "c1"},
+                                        {"changes", QJsonArray{remote}}, {"more", true}});
+    server.responses.append(QJsonObject{{"status", "success"}, {"cursor", "c2"}});
     
-    // Тестируем получение элемента
-    auto item = sync->getItem(itemId);
-    QCOMPARE(item.data["title"].toString(), "Updated Title");
+    QSignalSpy finished(sync, &SyncManager::syncFinished);
+    sync->sync();
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, 10000);
+    QCOMPARE(server.requests.size(), qsizetype(2));
     
-    // Тестируем удаление элемента
-    QVERIFY(sync->removeItem(itemId));
-}
-
-void SyncTest::testConflictResolution()
-{
-    // Создаем конфликтующие элементы
-    QJsonObject localData;
-    localData["title"] = "Local Title";
+    const QJsonArray sent = server.requests[0]["changes"].toArray();
+    QCOMPARE(sent.size(), qsizetype(2));
+    QCOMPARE(sent[0].toObject()["id"].toString(), QString("a"));
+    QCOMPARE(sent[1].toObject()["seq"].toString(), QString("2"));
+    QVERIFY(server.requests[0]["cursor"].toString().isEmpty());
     
-    QJsonObject remoteData;
-    remoteData["title"] = "Remote Title";
+    // Продолжение идёт с новым курсором, принятое с сервера обратно не уходит
+    QCOMPARE(server.requests[1]["cursor"].toString(), QString("c1"));
+    QVERIFY(server.requests[1]["changes"].toArray().isEmpty());
+    QCOMPARE(sync->getPendingChangesCount(), 0);
     
-    // Тестируем разрешение конфликтов
-    auto resolution = sync->resolveConflict(localData, remoteData);
-    QVERIFY(!resolution.isEmpty());
+    // Неподтверждённая правка уходит повторно, курсор переживает перезапуск
+    QVERIFY(sync->recordChange("bookmarks", "c", QJsonObject{{"title", "C"}}));
+    server.requests.clear();
+    server.responses.append(QJsonObject{{"status", "success"}, {"ack", "0"}, {"cursor", "c3"}});
+    sync->sync();
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 3, 10000);
+    QCOMPARE(server.requests.size(), qsizetype(1));
+    QCOMPARE(server.requests[0]["cursor"].toString(), QString("c2"));
+    QCOMPARE(server.requests[0]["changes"].toArray().size(), qsizetype(1));
+    QCOMPARE(sync->getPendingChangesCount(), 1);
     
-    // Тестируем стратегии разрешения конфликтов
-    sync->setConflictResolutionStrategy("remote-wins");
-    QCOMPARE(sync->getConflictResolutionStrategy(), "remote-wins");
+    delete sync;
+    sync = new SyncManager(this);
+    sync->setServerUrl(server.url());
+    QCOMPARE(sync->getPendingChangesCount(), 1);
+    QSignalSpy restarted(sync, &SyncManager::syncFinished);
+    server.requests.clear();
+    server.responses.append(QJsonObject{{"status", "success"}, {"cursor", "c4"}});
+    sync->sync();
+    QTRY_COMPARE_WITH_TIMEOUT(restarted.count(), 1, 10000);
+    QCOMPARE(server.requests[0]["cursor"].toString(), QString("c3"));
+    QCOMPARE(server.requests[0]["changes"].toArray().size(), qsizetype(1));
+    QCOMPARE(sync->getPendingChangesCount(), 0);
 }
 
-void SyncTest::testOfflineMode()
+void SyncTest::testReconcile()
 {
-    // Тестируем переход в оффлайн режим
-    sync->setOfflineMode(true);
-    QVERIFY(sync->isOfflineMode());
+    // После testServerExchange сервер знает a, b, c и remote. Сервер
+    // присылает пустые хэши: все они удалены на других устройствах, а
+    // новый объект x есть только на сервере
+    SyncStubServer server;
+    sync->setServerUrl(server.url());
+    QVERIFY(sync->recordChange("bookmarks", "d", QJsonObject{{"title", "D"}}));
     
-    // Тестируем очередь изменений
-    QJsonObject data;
-    data["title"] = "Offline Item";
-    qint64 itemId = sync->addItem(SyncItemType::Bookmark, data);
+    const int levels = MerkleTree::DEPTH + 1;
+    server.responses.append(QJsonObject{{"status", "success"}, {"cursor", "r1"}, {"hashes", QJsonObject()}});
+    for (int level = 1; level < levels; ++level) {
+        server.responses.append(QJsonObject{{"status", "success"}, {"hashes", QJsonObject()}});
+    }
+    const QString checksum = QString::fromLatin1(QByteArray("remote checksum").toBase64());
+    server.responses.append(QJsonObject{{"status", "success"},
+                                        {"entries", QJsonObject{{"bookmarks", QJsonObject{{"x", checksum}}}}}});
+    QJsonObject fetched;
+    fetched["type"] = "bookmarks";
+    fetched["id"] = "x";
+    fetched["data"] = QJsonObject{{"title", "X"}};
+    server.responses.append(QJsonObject{{"status", "success"}, {"changes", QJsonArray{fetched}}});
+    server.responses.append(QJsonObject{{"status", "success"}});
     
-    auto pendingChanges = sync->getPendingChanges();
-    QVERIFY(!pendingChanges.isEmpty());
+    QSignalSpy reconciled(sync, &SyncManager::reconciliationFinished);
+    QSignalSpy finished(sync, &SyncManager::syncFinished);
+    QVERIFY(sync->reconcile());
+    QVERIFY(reconciled.wait(10000));
+    QCOMPARE(reconciled.first().at(0).toBool(), true);
+    QCOMPARE(reconciled.first().at(1).toInt(), 1);
+    QCOMPARE(reconciled.first().at(2).toInt(), 0);
     
-    // Тестируем синхронизацию после выхода из оффлайн режима
-    sync->setOfflineMode(false);
-    QVERIFY(!sync->isOfflineMode());
+    QCOMPARE(server.requests[0]["reconcile"].toObject()["level"].toInt(), 0);
+    QVERIFY(server.requests[levels]["reconcile"].toObject().contains("buckets"));
+    const QJsonObject fetch = server.requests[levels + 1]["reconcile"].toObject()["fetch"].toObject();
+    QCOMPARE(fetch["bookmarks"].toArray(), QJsonArray{"x"});
+    
+    // Затем обычная синхронизация: курсор из первого ответа сверки,
+    // только неотправленная правка, удалённые на сервере объекты не
+    // возвращаются
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 2, 10000);
+    QCOMPARE(server.requests.size(), qsizetype(levels + 3));
+    const QJsonObject upload = server.requests.last();
+    QCOMPARE(upload["cursor"].toString(), QString("r1"));
+    const QJsonArray changes = upload["changes"].toArray();
+    QCOMPARE(changes.size(), qsizetype(1));
+    QCOMPARE(changes[0].toObject()["id"].toString(), QString("d"));
+    QCOMPARE(sync->getPendingChangesCount(), 0);
 }
 
-void SyncTest::testDeviceManagement()
+void SyncTest::testResumeOversizedUpload()
 {
-    // Тестируем регистрацию устройства
-    QVERIFY(sync->registerDevice(testDeviceId));
+    // 400 правок по ~4 КБ плохо сжимаемых данных: весь пакет больше
+    // предела, половина укладывается и занимает несколько кусков
+    for (int i = 0; i < 400; ++i) {
+        QByteArray hash = QCryptographicHash::hash(QByteArray::number(i), QCryptographicHash::Sha256);
+        QString blob;
+        for (int j = 0; j < 64; ++j) {
+            hash = QCryptographicHash::hash(hash, QCryptographicHash::Sha256);
+            blob += QString::fromLatin1(hash.toHex());
+        }
+        QVERIFY(sync->recordChange("history", QString("entry-%1").arg(i), QJsonObject{{"blob", blob}}));
+    }
+    sync->setMaxSyncSize(700 * 1024);
     
-    // Тестируем получение списка устройств
-    auto devices = sync->getRegisteredDevices();
-    QVERIFY(devices.contains(testDeviceId));
+    // Сервер отвечает ошибкой на второй кусок, пока failing
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    bool failing = true;
+    QList<QPair<QByteArray, int>> received;
+    connect(&server, &QTcpServer::newConnection, this, [&]() {
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, socket, [&, socket]() {
+            QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+            socket->setProperty("request", request);
+            static const QRegularExpression contentLength("content-length:\\s*(\\d+)",
+                                                          QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression chunkHeader("x-sync-chunk:\\s*(\\d+)/(\\d+)",
+                                                        QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression uploadHeader("x-sync-upload:\\s*(\\S+)",
+                                                         QRegularExpression::CaseInsensitiveOption);
+            const int headerEnd = request.indexOf("\r\n\r\n");
+            const QString headers = QString::fromLatin1(request.left(headerEnd));
+            const QRegularExpressionMatch length = contentLength.match(headers);
+            const QRegularExpressionMatch chunk = chunkHeader.match(headers);
+            if (headerEnd < 0 || !length.hasMatch() || !chunk.hasMatch() ||
+                request.size() < headerEnd + 4 + length.captured(1).toInt()) {
+                return;
+            }
+            
+            const int index = chunk.captured(1).toInt();
+            if (failing && index == 1) {
+                socket->write("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n"
+                              "Connection: close\r\n\r\n");
+                socket->disconnectFromHost();
+                return;
+            }
+            received.append({uploadHeader.match(headers).captured(1).toLatin1(), index});
+            const QByteArray body = index == chunk.captured(2).toInt() - 1
+                ? QByteArray("{\"status\":\"success\"}") : QByteArray();
+            socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) +
+                          "\r\nConnection: close\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    });
+    sync->setServerUrl(QUrl(QString("http://127.0.0.1:%1/sync").arg(server.serverPort())));
     
-    // Тестируем удаление устройства
-    QVERIFY(sync->unregisterDevice(testDeviceId));
-}
-
-void SyncTest::testEncryption()
-{
-    // Тестируем включение шифрования
-    QVERIFY(sync->enableEncryption("encryption-password"));
-    QVERIFY(sync->isEncryptionEnabled());
-    
-    // Тестируем шифрование данных
-    QJsonObject data;
-    data["sensitive"] = "secret";
-    auto encrypted = sync->encryptData(data);
-    QVERIFY(!encrypted.isEmpty());
-    
-    // Тестируем расшифровку данных
-    auto decrypted = sync->decryptData(encrypted);
-    QCOMPARE(decrypted["sensitive"].toString(), "secret");
+    // Первый обмен исчерпывает повторы: подтверждён только кусок 0
+    QSignalSpy errors(sync, &SyncManager::syncError);
+    QSignalSpy finished(sync, &SyncManager::syncFinished);
+    sync->sync();
+    QTRY_COMPARE_WITH_TIMEOUT(errors.count(), 1, 60000);
+    QCOMPARE(finished.count(), 1);
+    QCOMPARE(received.size(), qsizetype(1));
+    QCOMPARE(received[0].second, 0);
+    const QByteArray uploadId = received[0].first;
+    QCOMPARE(sync->getPendingChangesCount(), 400);
+    
+    // Второй обмен снова уменьшает пакет до той же половины и продолжает
+    // ту же выгрузку с первого неподтверждённого куска
+    failing = false;
+    received.clear();
+    sync->sync();
+    QTRY_COMPARE_WITH_TIMEOUT(sync->getPendingChangesCount(), 0, 60000);
+    QList<int> resumed;
+    for (const auto &request : std::as_const(received)) {
+        if (request.first == uploadId) {
+            resumed.append(request.second);
+        }
+    }
+    QVERIFY(resumed.size() >= 2);
+    QCOMPARE(resumed.first(), 1);
+    QVERIFY(!resumed.contains(0));
+    QVERIFY(received.size() > resumed.size());
+    
+    sync->setMaxSyncSize(0);
 }
 
-void SyncTest::testStatistics()
+void SyncTest::testMerkleTree()
 {
-    // Тестируем сбор статистики
-    auto stats = sync->getSyncStatistics();
-    QVERIFY(stats.contains("totalSyncs"));
-    QVERIFY(stats.contains("totalItems"));
-    QVERIFY(stats.contains("lastSyncDuration"));
-    
-    // Тестируем сброс статистики
-    sync->resetStatistics();
-    stats = sync->getSyncStatistics();
-    QCOMPARE(stats["totalSyncs"].toInt(), 0);
+    auto checksum = [](const QString &value) {
+        return QCryptographicHash::hash(value.toUtf8(), QCryptographicHash::Sha256);
+    };
+    
+    // Порядок вставки не влияет на хэши
+    MerkleTree local;
+    MerkleTree remote;
+    const int count = 20000;
+    for (int i = 0; i < count; ++i) {
+        local.insert(QString("item-%1").arg(i), checksum(QString::number(i)));
+        remote.insert(QString("item-%1").arg(count - 1 - i), checksum(QString::number(count - 1 - i)));
+    }
+    QCOMPARE(local.size(), count);
+    QCOMPARE(local.rootHash(), remote.rootHash());
+    QVERIFY(!local.rootHash().isEmpty());
+    QVERIFY(MerkleTree().rootHash().isEmpty());
+    
+    // Два изменённых объекта, один удалённый и один новый на сервере
+    remote.insert("item-7", checksum("changed"));
+    remote.insert("item-12345", checksum("changed"));
+    remote.remove("item-500");
+    remote.insert("item-new", checksum("new"));
+    QVERIFY(local.rootHash() != remote.rootHash());
+    
+    // Спуск сверху вниз: сравниваются только потомки различающихся узлов
+    QList<int> nodes{0};
+    int exchanged = 0;
+    for (int level = 0; level <= MerkleTree::DEPTH; ++level) {
+        QHash<int, QByteArray> hashes;
+        for (int index : std::as_const(nodes)) {
+            hashes.insert(index, remote.nodeHash(level, index));
+        }
+        exchanged += hashes.size();
+        const QList<int> differing = local.differingNodes(level, nodes, hashes);
+        QVERIFY(!differing.isEmpty());
+        QVERIFY(differing.size() <= 4);
+        if (level == MerkleTree::DEPTH) {
+            nodes = differing;
+            break;
+        }
+        nodes.clear();
+        for (int index : differing) {
+            nodes += MerkleTree::children(index);
+        }
+    }
+    QVERIFY(exchanged <= 1 + 3 * 4 * MerkleTree::FANOUT);
+    
+    QSet<QString> differingIds;
+    for (int bucket : std::as_const(nodes)) {
+        const QMap<QString, QByteArray> localEntries = local.bucketEntries(bucket);
+        const QMap<QString, QByteArray> remoteEntries = remote.bucketEntries(bucket);
+        for (auto it = remoteEntries.constBegin(); it != remoteEntries.constEnd(); ++it) {
+            if (localEntries.value(it.key()) != it.value()) {
+                differingIds.insert(it.key());
+            }
+        }
+        for (auto it = localEntries.constBegin(); it != localEntries.constEnd(); ++it) {
+            if (!remoteEntries.contains(it.key())) {
+                differingIds.insert(it.key());
+            }
+        }
+    }
+    QCOMPARE(differingIds, (QSet<QString>{"item-7", "item-12345", "item-500", "item-new"}));
+    
+    // После применения различий деревья совпадают; сериализация сохраняет их
+    local.insert("item-7", checksum("changed"));
+    local.insert("item-12345", checksum("changed"));
+    local.remove("item-500");
+    local.insert("item-new", checksum("new"));
+    QCOMPARE(local.rootHash(), remote.rootHash());
+    
+    QByteArray buffer;
+    {
+        QDataStream out(&buffer, QIODevice::WriteOnly);
+        out << local;
+    }
+    MerkleTree restored;
+    QDataStream in(buffer);
+    in >> restored;
+    QCOMPARE(restored.size(), local.size());
+    QCOMPARE(restored.rootHash(), local.rootHash());
 }
 
-void SyncTest::testErrorHandling()
+void SyncTest::testChunkedUpload()
 {
-    // Тестируем обработку ошибок сети
-    sync->simulateNetworkError();
-    QVERIFY(!sync->startSync());
-    QVERIFY(!sync->getLastError().isEmpty());
-    
-    // Тестируем обработку ошибок аутентификации
-    sync->signOut();
-    QVERIFY(!sync->startSync());
-    QVERIFY(sync->getLastError().contains("authentication"));
-    
-    // Тестируем обработку ошибок данных
-    QJsonObject invalidData;
-    QVERIFY(!sync->addItem(SyncItemType::Bookmark, invalidData));
-    QVERIFY(sync->getLastError().contains("invalid data"));
+    // Около мегабайта CBOR - несколько кусков
+    QJsonArray changes;
+    for (int i = 0; i < 20000; ++i) {
+        QJsonObject change;
+        change["type"] = "history";
+        change["id"] = QString("entry-%1").arg(i);
+        change["data"] = QJsonObject{{"url", QString("https://example.com/page/%1").arg(i)},
+                                     {"title", QString("Page number %1").arg(i)}};
+        changes.append(change);
+    }
+    QJsonObject payload;
+    payload["changes"] = changes;
+    
+    const QByteArray encoded = SyncUploader::encode(payload);
+    const QList<QByteArray> chunks = SyncUploader::compressChunks(encoded);
+    QVERIFY(chunks.size() > 2);
+    QCOMPARE(SyncUploader::decode(chunks), payload);
+    
+    // Каждый кусок - обычный поток zlib: заголовок CMF/FLG без префикса Qt
+    for (const QByteArray &chunk : chunks) {
+        const int cmf = uchar(chunk[0]);
+        const int flg = uchar(chunk[1]);
+        QCOMPARE(cmf & 0x0f, 8);
+        QCOMPARE((cmf * 256 + flg) % 31, 0);
+    }
+    
+    // Сервер обрывает соединение на третьем куске первой попытки
+    QTcpServer server;
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+    QList<int> received;
+    bool dropped = false;
+    connect(&server, &QTcpServer::newConnection, this, [&]() {
+        QTcpSocket *socket = server.nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, socket, [&, socket]() {
+            QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+            socket->setProperty("request", request);
+            static const QRegularExpression contentLength("content-length:\\s*(\\d+)",
+                                                          QRegularExpression::CaseInsensitiveOption);
+            static const QRegularExpression chunkHeader("x-sync-chunk:\\s*(\\d+)/(\\d+)",
+                                                        QRegularExpression::CaseInsensitiveOption);
+            const int headerEnd = request.indexOf("\r\n\r\n");
+            const QString headers = QString::fromLatin1(request.left(headerEnd));
+            const QRegularExpressionMatch length = contentLength.match(headers);
+            const QRegularExpressionMatch chunk = chunkHeader.match(headers);
+            if (headerEnd < 0 || !length.hasMatch() || !chunk.hasMatch() ||
+                request.size() < headerEnd + 4 + length.captured(1).toInt()) {
+                return;
+            }
+            
+            const int index = chunk.captured(1).toInt();
+            if (index == 2 && !dropped) {
+                dropped = true;
+                socket->abort();
+                return;
+            }
+            received.append(index);
+            const QByteArray body = index == chunk.captured(2).toInt() - 1
+                ? QByteArray("{\"status\":\"success\"}") : QByteArray();
+            socket->write("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                          "Content-Length: " + QByteArray::number(body.size()) +
+                          "\r\nConnection: close\r\n\r\n" + body);
+            socket->disconnectFromHost();
+        });
+    });
+    
+    QNetworkAccessManager network;
+    SyncUploader uploader(&network);
+    QVERIFY(uploader.prepare(payload));
+    QCOMPARE(qsizetype(uploader.chunkCount()), chunks.size());
+    QCOMPARE(uploader.encodedSize(), qint64(encoded.size()));
+    QVERIFY(uploader.compressedSize() < uploader.encodedSize());
+    
+    const QUrl url(QString("http://127.0.0.1:%1/sync").arg(server.serverPort()));
+    QSignalSpy failed(&uploader, &SyncUploader::failed);
+    QSignalSpy finished(&uploader, &SyncUploader::finished);
+    uploader.upload(url);
+    QVERIFY(failed.wait(10000));
+    QCOMPARE(received, (QList<int>{0, 1}));
+    QCOMPARE(uploader.acknowledgedCount(), 2);
+    
+    // Те же данные: подтверждённые куски не отправляются повторно
+    QVERIFY(uploader.prepare(payload));
+    QCOMPARE(uploader.acknowledgedCount(), 2);
+    uploader.upload(url);
+    QVERIFY(finished.wait(10000));
+    QCOMPARE(finished.first().at(0).toJsonObject()["status"].toString(), QString("success"));
+    QList<int> expected;
+    for (int i = 0; i < chunks.size(); ++i) {
+        expected.append(i);
+    }
+    QCOMPARE(received, expected);
 }
 
 void SyncTest::cleanupTestCase()
 {
-    sync->signOut();
     delete sync;
 }
 